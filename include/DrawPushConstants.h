@@ -0,0 +1,40 @@
+#ifndef DRAWPUSHCONSTANTS_H
+#define DRAWPUSHCONSTANTS_H
+
+#include <glm/glm.hpp>
+
+#include "Engine/VulkanInclude.h"
+
+/*
+per-draw parameters pushed right before a model's draws, so changing them doesn't need another descriptor set. the layout matches the
+push_constant block of the model vertex shaders (std430 packs textureLayerBase into the vec3's padding), 32 bytes in total.
+*/
+struct DrawPushConstants {
+    //added to every vertex of the model, on top of the instance position
+    alignas(16) glm::vec3 modelOffset = glm::vec3(0, 0, 0);
+
+    //added to the layer in the vertices' texture coordinates
+    uint32_t textureLayerBase = 0;
+
+    //multiplied with the vertex color after the screen tint, alpha only matters for transparent models
+    alignas(16) glm::vec4 tint = glm::vec4(1, 1, 1, 1);
+
+    static VkPushConstantRange getPushConstantRange() {
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(DrawPushConstants);
+
+        return pushConstantRange;
+    }
+
+    bool operator==(const DrawPushConstants& other) const {
+        return modelOffset == other.modelOffset && textureLayerBase == other.textureLayerBase && tint == other.tint;
+    }
+
+    bool operator!=(const DrawPushConstants& other) const {
+        return !(*this == other);
+    }
+};
+
+#endif
\ No newline at end of file
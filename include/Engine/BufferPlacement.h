@@ -0,0 +1,10 @@
+#ifndef BUFFERPLACEMENT_H
+#define BUFFERPLACEMENT_H
+
+//where a VulkanVertexBuffer keeps its contents
+enum BUFFER_PLACEMENT {
+    HOST_VISIBLE, //mapped, written directly by the cpu. good for data that changes every frame
+    DEVICE_LOCAL //vram, written through the device's staging ring. good for static geometry
+};
+
+#endif
\ No newline at end of file
@@ -2,10 +2,11 @@
 #define FRAMEBUFFER_ATTACHMENT
 
 #include "VulkanInclude.h"
+#include "VulkanMemoryAllocation.h"
 
 struct FramebufferAttachment {
     VkFormat format;
-    VkDeviceMemory memory;
+    VulkanMemoryAllocation memory;
     VkImage image;
     VkImageView imageView;
 };
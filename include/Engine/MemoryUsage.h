@@ -0,0 +1,12 @@
+#ifndef MEMORYUSAGE_H
+#define MEMORYUSAGE_H
+
+//what a buffer is used for, VulkanMemoryAllocator picks the memory type from this instead of from fixed property flags
+enum MEMORY_USAGE {
+    USAGE_STATIC_GEOMETRY, //written rarely, read by the gpu every frame. vram, mappable only on unified memory devices
+    USAGE_STREAMING, //rewritten by the cpu every frame. host visible, in vram when there is resizable bar / unified memory
+    USAGE_READBACK, //written by the gpu, read by the cpu. host visible, cached if possible
+    USAGE_STAGING //write-once source for transfers. host visible, kept out of vram so the bar heap isn't wasted
+};
+
+#endif
\ No newline at end of file
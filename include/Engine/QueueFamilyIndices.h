@@ -8,6 +8,9 @@ struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
 
+    //a family that can only transfer, optional. uploads run on it next to rendering when it's there
+    std::optional<uint32_t> transferFamily;
+
     bool isComplete() {
         return graphicsFamily.has_value() && presentFamily.has_value();
     }
@@ -0,0 +1,59 @@
+#ifndef VULKANCHUNKCULLER_H
+#define VULKANCHUNKCULLER_H
+
+#include "Vertex.h"
+#include "VulkanGeometryPool.h"
+
+#include <vector>
+#include <span>
+#include <string>
+
+//a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all six planes
+struct VulkanFrustum {
+    glm::vec4 planes[6];
+};
+
+/*
+bounding boxes of the instance positions of an instance set, one per VulkanChunkCuller::CHUNK_SIZE instances. kept as structure of arrays of
+centers and half extents so several chunks can be loaded into one simd register.
+*/
+struct VulkanChunkBounds {
+    std::vector<float> centerX = std::vector<float>();
+    std::vector<float> centerY = std::vector<float>();
+    std::vector<float> centerZ = std::vector<float>();
+    std::vector<float> extentX = std::vector<float>();
+    std::vector<float> extentY = std::vector<float>();
+    std::vector<float> extentZ = std::vector<float>();
+
+    uint32_t chunkCount = 0;
+
+    void calculate(std::span<const InstanceData> instances);
+
+    //the instances at offset were overwritten. the old positions aren't known anymore, so the touched boxes can only grow
+    void grow(uint32_t offset, std::span<const InstanceData> instances);
+
+    void clear();
+};
+
+/*
+cpu frustum culling for machines where the compute pass of VulkanInstanceCuller isn't an option. boxes are tested 4 at a time with SSE or NEON,
+which every x86-64 and arm64 target has, or one at a time if the compiler targets neither.
+*/
+class VulkanChunkCuller {
+    public:
+        const static uint32_t CHUNK_SIZE = 256;
+
+        //the frustum of viewProjection for positions the vertex shaders negate before transforming them
+        static VulkanFrustum extractFrustum(const glm::mat4x4& viewProjection);
+
+        //sets visible[i] to 1 or 0 for every chunk in [firstChunk, lastChunk). a chunk's box is its instance bounds grown by the model's bounds
+        static void cullChunks(const VulkanFrustum& frustum, const VulkanChunkBounds& chunks, glm::vec3 modelMin, glm::vec3 modelMax, uint32_t firstChunk, uint32_t lastChunk, uint8_t* visible);
+
+        //turns chunk visibility into instance ranges relative to the start of the set, neighbouring visible chunks become one range
+        static void collectVisibleRanges(const uint8_t* visible, uint32_t chunkCount, uint32_t instanceCount, std::vector<VulkanGeometryRange>& ranges);
+
+        //the simd path cullChunks was compiled with
+        static std::string getInstructionSet();
+};
+
+#endif
\ No newline at end of file
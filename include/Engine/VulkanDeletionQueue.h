@@ -0,0 +1,53 @@
+#ifndef VULKANDELETIONQUEUE_H
+#define VULKANDELETIONQUEUE_H
+
+#include <deque>
+#include <functional>
+#include <cstdint>
+
+/*
+defers destroying objects the gpu might still be using. every graphics submission of a frame gets the next value of a monotonically increasing
+timeline, and an object retired while a submission is being recorded is tagged with that submission's value. the renderer reports the highest
+value it knows to be finished (from the frame's in flight fence) and everything tagged with it or lower is destroyed in one go. values only grow,
+so the pending objects are always sorted by them and completing only ever looks at the front of the queue.
+not thread safe, only retire and complete from the render thread.
+*/
+class VulkanDeletionQueue {
+    public:
+        VulkanDeletionQueue();
+
+        //destroyFunction runs once the submission that is being recorded now, and every one before it, has finished on the gpu
+        void retire(std::function<void()> destroyFunction);
+
+        //the value of the submission that is being recorded, what retire tags objects with
+        uint64_t getRecordingValue();
+
+        //the submission recorded so far goes to the gpu. returns its value, everything retired afterwards waits for the next one
+        uint64_t submit();
+
+        //every submission up to and including value has finished, destroys what was waiting for them
+        void complete(uint64_t value);
+
+        bool hasCompleted(uint64_t value);
+
+        //destroys everything that is pending, only once the device is idle
+        void destroyAll();
+
+        size_t getPendingCount();
+
+    private:
+        struct RetiredObject {
+            uint64_t value = 0;
+
+            std::function<void()> destroy;
+        };
+
+        std::deque<RetiredObject> retiredObjects = std::deque<RetiredObject>();
+
+        //0 is never a submission, so it counts as completed from the start
+        uint64_t recordingValue = 1;
+
+        uint64_t completedValue = 0;
+};
+
+#endif
\ No newline at end of file
@@ -6,6 +6,10 @@
 #include "SwapChainSupportDetails.h"
 #include "VulkanInstance.h"
 #include "VulkanDisplay.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanStagingRing.h"
+#include "VulkanDeletionQueue.h"
+#include "VulkanUploadService.h"
 
 #include <vector>
 #include <set>
@@ -35,9 +39,48 @@ class VulkanDevice {
 
         QueueFamilyIndices getDeviceQueueFamilies(std::shared_ptr<VulkanDisplay> display);
 
+        //drawCount > 1 in a single vkCmdDrawIndirect
+        bool supportsMultiDrawIndirect();
+
+        //firstInstance != 0 in indirect draws
+        bool supportsDrawIndirectFirstInstance();
+
+        //vkCmdDrawIndirectCountKHR, or nullptr if VK_KHR_draw_indirect_count isn't there
+        PFN_vkCmdDrawIndirectCount getDrawIndirectCountFunction();
+
+        //vkCmdWriteTimestamp works on the graphics queue
+        bool supportsTimestamps();
+
+        //nanoseconds per timestamp tick
+        float getTimestampPeriod();
+
+        //bits of a timestamp that are valid on the graphics queue, the rest have to be masked off before subtracting
+        uint32_t getTimestampValidBits();
+
+        //queue family of the graphics queue and of getInternalCommandPool, for creating more pools
+        uint32_t getGraphicsQueueFamilyIndex();
+
         VkQueue& getInternalGraphicsQueue();
 
         VkQueue& getInternalPresentQueue();
+
+        //whether the device has a transfer only queue family, which getInternalTransferQueue is from
+        bool hasTransferQueue();
+
+        uint32_t getTransferQueueFamilyIndex();
+
+        //VK_NULL_HANDLE without hasTransferQueue
+        VkQueue& getInternalTransferQueue();
+
+        std::shared_ptr<VulkanMemoryAllocator> getMemoryAllocator();
+
+        std::shared_ptr<VulkanStagingRing> getStagingRing();
+
+        //where buffers and images that frames in flight might still use go instead of being destroyed
+        std::shared_ptr<VulkanDeletionQueue> getDeletionQueue();
+
+        //asset uploads that don't wait, on the transfer queue if there is one
+        std::shared_ptr<VulkanUploadService> getUploadService();
     private:
         void createPhysicalDevice(std::shared_ptr<VulkanInstance> instance, std::shared_ptr<VulkanDisplay> display);
 
@@ -51,6 +94,8 @@ class VulkanDevice {
 
         bool checkDeviceExtensionSupport(VkPhysicalDevice device);
 
+        static bool isDeviceExtensionSupported(VkPhysicalDevice device, std::string extensionName);
+
         SwapChainSupportDetails getDeviceSwapChainSupport(VkPhysicalDevice device, std::shared_ptr<VulkanDisplay> display);
 
         VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
@@ -63,10 +108,34 @@ class VulkanDevice {
 
         VkQueue presentQueue;
 
+        VkQueue transferQueue = VK_NULL_HANDLE;
+
         VkCommandPool graphicsCommandPool;
 
+        std::shared_ptr<VulkanMemoryAllocator> memoryAllocator = std::make_shared<VulkanMemoryAllocator>();
+
+        std::shared_ptr<VulkanStagingRing> stagingRing = std::make_shared<VulkanStagingRing>();
+
+        VkDeviceSize stagingRingSize = 16 * 1024 * 1024;
+
+        std::shared_ptr<VulkanDeletionQueue> deletionQueue = std::make_shared<VulkanDeletionQueue>();
+
+        std::shared_ptr<VulkanUploadService> uploadService = std::make_shared<VulkanUploadService>();
+
         std::vector<const char*> deviceExtensions;
 
+        bool memoryBudgetSupported = false;
+
+        bool multiDrawIndirectSupported = false;
+
+        bool drawIndirectFirstInstanceSupported = false;
+
+        PFN_vkCmdDrawIndirectCount cmdDrawIndirectCount = nullptr;
+
+        float timestampPeriod = 0;
+
+        uint32_t timestampValidBits = 0;
+
         bool hasBeenCreated = false;
 };
 
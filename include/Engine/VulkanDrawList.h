@@ -0,0 +1,127 @@
+#ifndef VULKANDRAWLIST_H
+#define VULKANDRAWLIST_H
+
+#include "VulkanInclude.h"
+#include "DrawPushConstants.h"
+
+#include <vector>
+#include <unordered_map>
+
+//the pipeline state a draw needs. descriptorPipeline is the pipeline whose descriptor set gets bound, the wireframe pipeline borrows the opaque one's
+struct VulkanDrawState {
+    uint32_t subpass = 0;
+    uint32_t pipeline = 0;
+    uint32_t descriptorPipeline = 0;
+};
+
+//one vkCmdDraw and the vertex buffers it reads
+struct VulkanDrawItem {
+    uint64_t key = 0;
+
+    VulkanDrawState state;
+
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;
+    VkBuffer instanceBuffer = VK_NULL_HANDLE;
+
+    uint32_t vertexCount = 0;
+    uint32_t instanceCount = 0;
+    uint32_t firstVertex = 0;
+    uint32_t firstInstance = 0;
+
+    DrawPushConstants pushConstants;
+
+    //draws in the same group are timed together, e.g. the draws of one model
+    uint32_t timingGroup = NO_TIMING_GROUP;
+
+    //timestamps written before / after the draw, relative to VulkanDrawBindings::firstQuery. set by assignTimestamps
+    uint32_t beginTimestamp = NO_TIMESTAMP;
+    uint32_t endTimestamp = NO_TIMESTAMP;
+
+    const static uint32_t NO_TIMING_GROUP = 0xFFFFFFFF;
+    const static uint32_t NO_TIMESTAMP = 0xFFFFFFFF;
+};
+
+//consecutive draws of one timing group, timed from the first one's beginTimestamp to the last one's endTimestamp (beginQuery + 1)
+struct VulkanTimestampRun {
+    uint32_t timingGroup = 0;
+    uint32_t beginQuery = 0;
+};
+
+//the binds that went into a command buffer, and the ones that were left out because the state was already bound
+struct VulkanBindCounts {
+    uint32_t pipelineBinds = 0;
+    uint32_t descriptorSetBinds = 0;
+    uint32_t vertexBufferBinds = 0;
+    uint32_t skippedBinds = 0;
+    uint32_t pushConstantUpdates = 0;
+    uint32_t draws = 0;
+
+    void add(const VulkanBindCounts& other);
+};
+
+//what VulkanDrawList::record binds for one swapchain image, indexed by pipeline index
+struct VulkanDrawBindings {
+    std::vector<VkPipeline> pipelines = std::vector<VkPipeline>();
+    std::vector<VkPipelineLayout> pipelineLayouts = std::vector<VkPipelineLayout>();
+    std::vector<VkDescriptorSet> descriptorSets = std::vector<VkDescriptorSet>();
+
+    uint32_t dynamicOffset = 0;
+
+    //where the draws' timestamps go, none are written without a pool
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    uint32_t firstQuery = 0;
+};
+
+/*
+the draws of the non-indirect path, sorted by a 64 bit key so that draws sharing state end up next to each other. from the most significant bits
+down the key is subpass (4 bits), pipeline (4), descriptor set (4), vertex buffer (24) and instance buffer (24). buffers are numbered in the order
+they are first added, which is all the grouping needs. the sort is stable, so draws of one model stay together and share their push constants.
+the list is rebuilt and sorted when the scene changes, and record leaves out every bind of state that is already bound and every push of values
+that are already pushed. with a query pool in the bindings, record also writes the timestamps assignTimestamps gave the draws.
+*/
+class VulkanDrawList {
+    public:
+        void clear();
+
+        void addDraw(VulkanDrawState state, VkBuffer vertexBuffer, VkBuffer instanceBuffer, uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance, const DrawPushConstants& pushConstants, uint32_t timingGroup = VulkanDrawItem::NO_TIMING_GROUP);
+
+        //radix sort of the keys, a byte at a time starting at the least significant one. bytes that are the same for every draw are skipped
+        void sort();
+
+        std::vector<VulkanDrawItem>& getDraws();
+
+        /*
+        hands out a begin / end query pair, starting at firstQuery, to every run of consecutive draws that share a timing group. call after sort. runs
+        past queryCount aren't timed, a queryCount of 0 takes the timestamps out again
+        */
+        void assignTimestamps(uint32_t firstQuery, uint32_t queryCount);
+
+        std::vector<VulkanTimestampRun>& getTimestampRuns();
+
+        /*
+        records draws [first, last), which all have to be in the same subpass, into a secondary that has nothing bound yet. safe to call from several
+        threads at once as long as the list isn't changed. counts gets what was recorded and what was skipped
+        */
+        void record(VkCommandBuffer commandBuffer, size_t first, size_t last, const VulkanDrawBindings& bindings, VulkanBindCounts& counts);
+
+    private:
+        struct SortEntry {
+            uint64_t key;
+            uint32_t index;
+        };
+
+        uint32_t getBufferNumber(VkBuffer buffer);
+
+        std::vector<VulkanDrawItem> draws = std::vector<VulkanDrawItem>();
+
+        //reused between sorts
+        std::vector<VulkanDrawItem> sortedDraws = std::vector<VulkanDrawItem>();
+        std::vector<SortEntry> entries = std::vector<SortEntry>();
+        std::vector<SortEntry> scratchEntries = std::vector<SortEntry>();
+
+        std::unordered_map<VkBuffer, uint32_t> bufferNumbers = std::unordered_map<VkBuffer, uint32_t>();
+
+        std::vector<VulkanTimestampRun> timestampRuns = std::vector<VulkanTimestampRun>();
+};
+
+#endif
\ No newline at end of file
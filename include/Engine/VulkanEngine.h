@@ -9,6 +9,7 @@
 #include "VulkanSwapchain.h"
 #include "VulkanGraphicsPipeline.h"
 #include "VulkanRenderSyncObjects.h"
+#include "VulkanFrameTimer.h"
 
 #include <vector>
 #include "QueueFamilyIndices.h"
@@ -56,14 +57,22 @@ class VulkanEngine {
 
         std::shared_ptr<TextureLoader> getTextureLoader();
 
+        //cpu time of each phase of the last frames, filled in by whoever renders them
+        std::shared_ptr<VulkanFrameTimer> getFrameTimer();
+
         void recreateSwapchain();
 
         //helper functions
-        static void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory, std::shared_ptr<VulkanDevice>  device);
+
+        //memory for buffers and images comes out of the device's VulkanMemoryAllocator. release it with device->getMemoryAllocator()->free(), never vkFreeMemory
+        static void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VulkanMemoryAllocation& bufferMemory, std::shared_ptr<VulkanDevice>  device, VulkanMemoryTag tag = VulkanMemoryTag());
+
+        //lets the allocator pick the memory type, see MEMORY_USAGE
+        static void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, MEMORY_USAGE memoryUsage, VkBuffer& buffer, VulkanMemoryAllocation& bufferMemory, std::shared_ptr<VulkanDevice>  device, VulkanMemoryTag tag = VulkanMemoryTag());
         
         static uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, std::shared_ptr<VulkanDevice>  device);
 
-        static void createImage(uint32_t width, uint32_t height, uint32_t layers, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory, std::shared_ptr<VulkanDevice> device);
+        static void createImage(uint32_t width, uint32_t height, uint32_t layers, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VulkanMemoryAllocation& imageMemory, std::shared_ptr<VulkanDevice> device, VulkanMemoryTag tag = VulkanMemoryTag());
 
         static VkCommandBuffer beginSingleTimeCommands(std::shared_ptr<VulkanDevice> device);
 
@@ -90,6 +99,8 @@ class VulkanEngine {
 
         std::shared_ptr<TextureLoader> textureLoader;
 
+        std::shared_ptr<VulkanFrameTimer> frameTimer = std::make_shared<VulkanFrameTimer>();
+
         bool hasInstance = false;
         bool hasDisplay = false;
         bool hasDevice = false;
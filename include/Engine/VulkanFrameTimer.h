@@ -0,0 +1,96 @@
+#ifndef VULKANFRAMETIMER_H
+#define VULKANFRAMETIMER_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+//the parts of a frame that get timed. the cpu ones by renderFrame itself, the gpu ones by VulkanGpuProfiler a few frames later
+enum FRAME_PHASE {
+    PHASE_FENCE_WAIT, //waiting for the frame's in flight fence
+    PHASE_DELETION, //destroying retired objects and handing back the frame's command pool and staging space
+    PHASE_ACQUIRE, //vkAcquireNextImageKHR
+    PHASE_IMAGE_WAIT, //waiting for the last frame that used the acquired image
+    PHASE_UNIFORM_UPDATE, //updateUniformBuffer
+    PHASE_RECORDING, //re-recording stale secondaries and recording the primary
+    PHASE_SUBMIT, //vkQueueSubmit
+    PHASE_PRESENT, //vkQueuePresentKHR
+    PHASE_SWAPCHAIN_RECREATE, //only when the swapchain went out of date
+    PHASE_FRAME, //all of renderFrame
+    PHASE_GPU_PRE_PASS, //staging uploads and instance culling before the render pass
+    PHASE_GPU_OPAQUE, //opaque, wireframe and the opaque part of transparent models
+    PHASE_GPU_TRANSPARENT, //transparent accumulation
+    PHASE_GPU_COMPOSITE,
+    PHASE_GPU_OVERLAY,
+    PHASE_GPU_FRAME, //the whole command buffer
+    FRAME_PHASE_COUNT
+};
+
+//in milliseconds, over the last samples of a phase
+struct VulkanPhaseStats {
+    double min = 0;
+    double average = 0;
+    double p99 = 0;
+    double max = 0;
+
+    uint32_t samples = 0;
+};
+
+struct VulkanFrameStats {
+    std::array<VulkanPhaseStats, FRAME_PHASE_COUNT> phases = std::array<VulkanPhaseStats, FRAME_PHASE_COUNT>();
+};
+
+/*
+keeps the last WINDOW_SIZE durations of every FRAME_PHASE in fixed size rings, so timing a frame never allocates. cpu durations come from steady_clock,
+gpu ones from timestamp queries, both in nanoseconds. getFrameStats works on a copy of one ring at a time in another fixed array, so it doesn't
+allocate either. not thread safe, only add samples on the render thread.
+*/
+class VulkanFrameTimer {
+    public:
+        //about 4 seconds at 60 fps
+        const static uint32_t WINDOW_SIZE = 256;
+
+        //records the time from construction to destruction as one sample of phase
+        class ScopedTimer {
+            public:
+                ScopedTimer(VulkanFrameTimer& timer, FRAME_PHASE phase);
+
+                ~ScopedTimer();
+
+                ScopedTimer(const ScopedTimer&) = delete;
+
+                ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+            private:
+                VulkanFrameTimer& timer;
+
+                FRAME_PHASE phase;
+
+                std::chrono::steady_clock::time_point start;
+        };
+
+        VulkanFrameTimer();
+
+        void addSample(FRAME_PHASE phase, uint64_t nanoseconds);
+
+        VulkanFrameStats getFrameStats();
+
+        void reset();
+
+        static const char* getPhaseName(FRAME_PHASE phase);
+
+    private:
+        struct PhaseRing {
+            std::array<uint64_t, WINDOW_SIZE> nanoseconds;
+
+            uint32_t next = 0;
+            uint32_t count = 0;
+        };
+
+        std::array<PhaseRing, FRAME_PHASE_COUNT> rings = std::array<PhaseRing, FRAME_PHASE_COUNT>();
+
+        //sorted for the percentile
+        std::array<uint64_t, WINDOW_SIZE> scratch = std::array<uint64_t, WINDOW_SIZE>();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,144 @@
+#ifndef VULKANGEOMETRYPOOL_H
+#define VULKANGEOMETRYPOOL_H
+
+#include "VulkanVertexBuffer.h"
+
+#include <map>
+#include <vector>
+#include <deque>
+
+//a run of elements inside a VulkanGeometryPool, first is what goes into firstVertex / firstInstance
+struct VulkanGeometryRange {
+    uint32_t first = 0;
+    uint32_t count = 0;
+};
+
+/*
+one VulkanVertexBuffer shared by many models or instance sets, each of which gets a range of it. everything in the pool is drawn with a single
+vertex buffer bind and firstVertex / firstInstance offsets instead of one bind per buffer.
+ranges are handed out first-fit from a free list, and the buffer grows (keeping its contents) when nothing fits. freed ranges may still be read by
+frames in flight, so they only go back on the free list once the deletion queue has completed the submission they were freed in.
+*/
+template<typename VertexType>
+class VulkanGeometryPool {
+    public:
+        VulkanGeometryPool(BUFFER_PLACEMENT placement, VulkanMemoryTag tag) : buffer(placement) {
+            buffer.setKeepCPUCopy(false);
+            buffer.setMemoryTag(tag);
+        }
+
+        VulkanGeometryRange allocate(std::shared_ptr<VulkanDevice> device, uint32_t count, VulkanDeletionQueue* deletionQueue) {
+            reclaimRanges(device->getDeletionQueue().get());
+
+            VulkanGeometryRange range;
+            range.count = count;
+
+            if(count == 0) {
+                return range;
+            }
+
+            for(std::map<uint32_t, uint32_t>::iterator it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+                if(it->second < count) {
+                    continue;
+                }
+
+                range.first = it->first;
+
+                if(it->second > count) {
+                    freeRanges[it->first + count] = it->second - count;
+                }
+
+                freeRanges.erase(it);
+
+                return range;
+            }
+
+            //nothing fits, so append. a free range at the end of the buffer gets extended instead of leaving a hole
+            range.first = buffer.getBufferSize();
+
+            if(!freeRanges.empty() && std::prev(freeRanges.end())->first + std::prev(freeRanges.end())->second == buffer.getBufferSize()) {
+                range.first = std::prev(freeRanges.end())->first;
+                freeRanges.erase(std::prev(freeRanges.end()));
+            }
+
+            buffer.resizePreservingContents(device, range.first + count, deletionQueue);
+
+            return range;
+        }
+
+        //the range stays untouched until deletionQueue completes the submission being recorded. nullptr frees it right away, only do that if the gpu isn't using it
+        void free(VulkanGeometryRange range, VulkanDeletionQueue* deletionQueue) {
+            if(range.count == 0) {
+                return;
+            }
+
+            if(deletionQueue == nullptr) {
+                addFreeRange(range);
+            }else {
+                retiringRanges.push_back(std::make_pair(range, deletionQueue->getRecordingValue()));
+            }
+        }
+
+        void write(std::shared_ptr<VulkanDevice> device, VulkanGeometryRange range, uint32_t offset, std::span<const VertexType> data) {
+            if(offset + data.size() > range.count) {
+                throw std::runtime_error("geometry pool write is out of the range's bounds!");
+            }
+
+            buffer.updateVertexRange(device, range.first + offset, data);
+        }
+
+        //see VulkanVertexBuffer::beginRangeWrite
+        std::span<VertexType> beginWrite(std::shared_ptr<VulkanDevice> device, VulkanGeometryRange range) {
+            return buffer.beginRangeWrite(device, range.first, range.count);
+        }
+
+        VulkanVertexBuffer<VertexType>& getVertexBuffer() {
+            return buffer;
+        }
+
+        void destroy(std::shared_ptr<VulkanDevice> device, VulkanDeletionQueue* deletionQueue) {
+            buffer.destroy(device, deletionQueue);
+            freeRanges.clear();
+            retiringRanges.clear();
+        }
+
+    private:
+        VulkanVertexBuffer<VertexType> buffer;
+
+        //first -> count, kept coalesced
+        std::map<uint32_t, uint32_t> freeRanges = std::map<uint32_t, uint32_t>();
+
+        //freed ranges and the deletion queue value they wait for, in the order they were freed so the values never go down
+        std::deque<std::pair<VulkanGeometryRange, uint64_t>> retiringRanges = std::deque<std::pair<VulkanGeometryRange, uint64_t>>();
+
+        void reclaimRanges(VulkanDeletionQueue* deletionQueue) {
+            while(!retiringRanges.empty() && deletionQueue->hasCompleted(retiringRanges.front().second)) {
+                addFreeRange(retiringRanges.front().first);
+                retiringRanges.pop_front();
+            }
+        }
+
+        void addFreeRange(VulkanGeometryRange range) {
+            uint32_t first = range.first;
+            uint32_t count = range.count;
+
+            std::map<uint32_t, uint32_t>::iterator next = freeRanges.lower_bound(first);
+            if(next != freeRanges.end() && next->first == first + count) {
+                count = count + next->second;
+                next = freeRanges.erase(next);
+            }
+
+            if(next != freeRanges.begin()) {
+                std::map<uint32_t, uint32_t>::iterator previous = std::prev(next);
+                if(previous->first + previous->second == first) {
+                    first = previous->first;
+                    count = count + previous->second;
+                    freeRanges.erase(previous);
+                }
+            }
+
+            freeRanges[first] = count;
+        }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,86 @@
+#ifndef VULKANGPUPROFILER_H
+#define VULKANGPUPROFILER_H
+
+#include "VulkanInclude.h"
+#include "VulkanDevice.h"
+#include "VulkanFrameTimer.h"
+
+#include <vector>
+#include <memory>
+
+/*
+timestamp queries for the gpu side of a frame. every swapchain image has its own range of one query pool, since the image's secondaries are reused
+and write the same queries every time they run. the frame's primary resets the range before anything writes to it, and the range is read once the
+image's fence has been waited on the next time the image is acquired, so reading never stalls. the first SUBPASS_QUERY_COUNT queries of a range
+are the boundaries between the parts of the frame, the rest are begin / end pairs for runs of draws.
+*/
+class VulkanGpuProfiler {
+    public:
+        //written at BOTTOM_OF_PIPE, so each one marks the point where everything recorded before it has finished
+        const static uint32_t FRAME_BEGIN_QUERY = 0;
+        const static uint32_t OPAQUE_BEGIN_QUERY = 1;
+        const static uint32_t TRANSPARENT_BEGIN_QUERY = 2;
+        const static uint32_t COMPOSITE_BEGIN_QUERY = 3;
+        const static uint32_t OVERLAY_BEGIN_QUERY = 4;
+        const static uint32_t FRAME_END_QUERY = 5;
+        const static uint32_t SUBPASS_QUERY_COUNT = 6;
+
+        VulkanGpuProfiler();
+
+        //drawQueryCount extra queries per image for draw runs, two per run
+        void create(std::shared_ptr<VulkanDevice> device, uint32_t imageCount, uint32_t drawQueryCount);
+
+        //the gpu must be done with every query
+        void destroyGpuProfiler(std::shared_ptr<VulkanDevice> device);
+
+        bool isCreated();
+
+        uint32_t getImageCount();
+
+        uint32_t getDrawQueryCount();
+
+        VkQueryPool getQueryPool();
+
+        //the query pool index of query 0 of imageIndex's range
+        uint32_t getFirstQuery(uint32_t imageIndex);
+
+        //resets imageIndex's range. has to be recorded outside of a render pass, before any timestamp of the range
+        void recordReset(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+
+        void writeTimestamp(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t query, VkPipelineStageFlagBits stage);
+
+        /*
+        reads what the last submission of imageIndex wrote, which has to be finished, and adds the gpu phases to timer. returns false if the range
+        wasn't written since the last read
+        */
+        bool readImage(std::shared_ptr<VulkanDevice> device, uint32_t imageIndex, VulkanFrameTimer& timer);
+
+        //the time between a draw run's begin query and the one after it, as of the last successful readImage. 0 if either wasn't written
+        double getDrawRunMilliseconds(uint32_t beginQuery);
+
+    private:
+        //0 if either query wasn't written
+        uint64_t getElapsedNanoseconds(uint32_t beginQuery, uint32_t endQuery);
+
+        VkQueryPool queryPool = VK_NULL_HANDLE;
+
+        uint32_t imageCount = 0;
+
+        uint32_t drawQueryCount = 0;
+
+        uint32_t queriesPerImage = 0;
+
+        double nanosecondsPerTick = 0;
+
+        uint64_t timestampMask = 0;
+
+        //(timestamp, availability) pairs of the range read last, sized once in create
+        std::vector<uint64_t> results = std::vector<uint64_t>();
+
+        //images whose range was reset and written by a submission that hasn't been read yet
+        std::vector<bool> pendingImages = std::vector<bool>();
+
+        bool hasBeenCreated = false;
+};
+
+#endif
\ No newline at end of file
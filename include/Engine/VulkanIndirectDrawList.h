@@ -0,0 +1,198 @@
+#ifndef VULKANINDIRECTDRAWLIST_H
+#define VULKANINDIRECTDRAWLIST_H
+
+#include "VulkanVertexBuffer.h"
+
+#include <unordered_map>
+#include <vector>
+
+//model space bounding box of a draw, for culling its instances on the gpu. vec4 so the layout matches std430
+struct VulkanDrawBounds {
+    glm::vec4 min = glm::vec4(0);
+    glm::vec4 max = glm::vec4(0);
+};
+
+/*
+a VkDrawIndirectCommand buffer plus a draw count buffer for vkCmdDrawIndirectCount, with one command per key (usually a model handle in the high 32
+bits and an instance set handle in the low 32, see makeKey). the commands are kept packed: removing
+one moves the last command into its slot, so every change only uploads the slots that actually changed and the count.
+every slot also has a VulkanDrawBounds in a parallel buffer for VulkanInstanceCuller. all the buffers are DEVICE_LOCAL and get updated through
+the staging ring like any other vertex buffer.
+*/
+class VulkanIndirectDrawList {
+    public:
+        VulkanIndirectDrawList() {
+            commands.setKeepCPUCopy(false);
+            commands.setExtraUsage(VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+            drawCount.setKeepCPUCopy(false);
+            drawCount.setExtraUsage(VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+
+            bounds.setKeepCPUCopy(false);
+            bounds.setExtraUsage(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        }
+
+        void setMemoryTag(VulkanMemoryTag tag) {
+            commands.setMemoryTag(tag);
+            drawCount.setMemoryTag(tag);
+            bounds.setMemoryTag(tag);
+        }
+
+        static uint64_t makeKey(uint32_t high, uint32_t low) {
+            return (static_cast<uint64_t>(high) << 32) | low;
+        }
+
+        //adds or replaces the command for key. a command that draws nothing is removed instead
+        void setDraw(std::shared_ptr<VulkanDevice> device, uint64_t key, VkDrawIndirectCommand command, VulkanDrawBounds drawBounds, VulkanDeletionQueue* deletionQueue) {
+            if(command.vertexCount == 0 || command.instanceCount == 0) {
+                removeDraw(device, key);
+                return;
+            }
+
+            std::unordered_map<uint64_t, uint32_t>::iterator slot = slots.find(key);
+
+            if(slot != slots.end()) {
+                VkDrawIndirectCommand& current = draws[slot->second];
+
+                if(current.vertexCount != command.vertexCount || current.instanceCount != command.instanceCount || current.firstVertex != command.firstVertex || current.firstInstance != command.firstInstance) {
+                    current = command;
+                    commands.updateVertexRange(device, slot->second, std::span<const VkDrawIndirectCommand>(&current, 1));
+                }
+
+                VulkanDrawBounds& currentBounds = drawBoundsList[slot->second];
+
+                if(currentBounds.min != drawBounds.min || currentBounds.max != drawBounds.max) {
+                    currentBounds = drawBounds;
+                    bounds.updateVertexRange(device, slot->second, std::span<const VulkanDrawBounds>(&currentBounds, 1));
+                }
+
+                return;
+            }
+
+            uint32_t index = static_cast<uint32_t>(draws.size());
+
+            slots[key] = index;
+            slotKeys.push_back(key);
+            draws.push_back(command);
+            drawBoundsList.push_back(drawBounds);
+
+            commands.resizePreservingContents(device, index + 1, deletionQueue);
+            commands.updateVertexRange(device, index, std::span<const VkDrawIndirectCommand>(&draws[index], 1));
+
+            bounds.resizePreservingContents(device, index + 1, deletionQueue);
+            bounds.updateVertexRange(device, index, std::span<const VulkanDrawBounds>(&drawBoundsList[index], 1));
+
+            uploadDrawCount(device);
+        }
+
+        void removeDraw(std::shared_ptr<VulkanDevice> device, uint64_t key) {
+            std::unordered_map<uint64_t, uint32_t>::iterator slot = slots.find(key);
+
+            if(slot == slots.end()) {
+                return;
+            }
+
+            uint32_t index = slot->second;
+            uint32_t last = static_cast<uint32_t>(draws.size()) - 1;
+
+            slots.erase(slot);
+
+            if(index != last) {
+                draws[index] = draws[last];
+                drawBoundsList[index] = drawBoundsList[last];
+                slotKeys[index] = slotKeys[last];
+                slots[slotKeys[index]] = index;
+
+                commands.updateVertexRange(device, index, std::span<const VkDrawIndirectCommand>(&draws[index], 1));
+                bounds.updateVertexRange(device, index, std::span<const VulkanDrawBounds>(&drawBoundsList[index], 1));
+            }
+
+            draws.pop_back();
+            drawBoundsList.pop_back();
+            slotKeys.pop_back();
+
+            //the buffers keep their capacity, only the count goes down
+            commands.resizePreservingContents(device, last, nullptr);
+            bounds.resizePreservingContents(device, last, nullptr);
+
+            uploadDrawCount(device);
+        }
+
+        bool hasDraw(uint64_t key) {
+            return slots.count(key) > 0;
+        }
+
+        //number of commands, for vkCmdDrawIndirect without the count buffer
+        uint32_t getDrawCount() {
+            return static_cast<uint32_t>(draws.size());
+        }
+
+        //upper bound for vkCmdDrawIndirectCount, the command buffer has room for this many commands
+        uint32_t getMaxDrawCount() {
+            return commands.getCapacity();
+        }
+
+        VkBuffer getCommandBuffer() {
+            return commands.getVertexBuffer();
+        }
+
+        VkBuffer getCountBuffer() {
+            return drawCount.getVertexBuffer();
+        }
+
+        VkBuffer getBoundsBuffer() {
+            return bounds.getVertexBuffer();
+        }
+
+        //the underlying buffers, for relocating them while defragmenting
+        VulkanVertexBuffer<VkDrawIndirectCommand>& getCommandVertexBuffer() {
+            return commands;
+        }
+
+        VulkanVertexBuffer<uint32_t>& getCountVertexBuffer() {
+            return drawCount;
+        }
+
+        VulkanVertexBuffer<VulkanDrawBounds>& getBoundsVertexBuffer() {
+            return bounds;
+        }
+
+        void destroy(std::shared_ptr<VulkanDevice> device, VulkanDeletionQueue* deletionQueue) {
+            commands.destroy(device, deletionQueue);
+            drawCount.destroy(device, deletionQueue);
+            bounds.destroy(device, deletionQueue);
+
+            slots.clear();
+            slotKeys.clear();
+            draws.clear();
+            drawBoundsList.clear();
+        }
+
+    private:
+        void uploadDrawCount(std::shared_ptr<VulkanDevice> device) {
+            uint32_t count = static_cast<uint32_t>(draws.size());
+
+            if(drawCount.getBufferSize() == 0) {
+                drawCount.setVertexData(device, std::span<const uint32_t>(&count, 1));
+            }else {
+                drawCount.updateVertexRange(device, 0, std::span<const uint32_t>(&count, 1));
+            }
+        }
+
+        VulkanVertexBuffer<VkDrawIndirectCommand> commands = VulkanVertexBuffer<VkDrawIndirectCommand>(DEVICE_LOCAL);
+
+        VulkanVertexBuffer<uint32_t> drawCount = VulkanVertexBuffer<uint32_t>(DEVICE_LOCAL);
+
+        VulkanVertexBuffer<VulkanDrawBounds> bounds = VulkanVertexBuffer<VulkanDrawBounds>(DEVICE_LOCAL);
+
+        std::unordered_map<uint64_t, uint32_t> slots = std::unordered_map<uint64_t, uint32_t>();
+
+        //cpu side copy of the commands and which key owns each slot, needed to move the last command into a freed slot
+        std::vector<uint64_t> slotKeys = std::vector<uint64_t>();
+
+        std::vector<VkDrawIndirectCommand> draws = std::vector<VkDrawIndirectCommand>();
+
+        std::vector<VulkanDrawBounds> drawBoundsList = std::vector<VulkanDrawBounds>();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,83 @@
+#ifndef VULKANINSTANCECULLER_H
+#define VULKANINSTANCECULLER_H
+
+#include "VulkanInclude.h"
+#include "VulkanDevice.h"
+#include "VulkanVertexBuffer.h"
+#include "VulkanIndirectDrawList.h"
+
+#include <vector>
+#include <memory>
+
+/*
+frustum culls the instances of VulkanIndirectDrawLists with a compute pass before the render pass. every draw's instances are tested against the
+frustum of the UniformBuffer, the visible ones are packed into an output buffer laid out like the instance pool, and a copy of the draw list's
+commands gets the visible instance counts. the outputs are per swapchain image since every image's command buffer is recorded once and reused.
+*/
+class VulkanInstanceCuller {
+    public:
+        VulkanInstanceCuller();
+
+        //culls drawListCount draw lists for each of imageCount swapchain images
+        void create(std::shared_ptr<VulkanDevice> device, uint32_t imageCount, uint32_t drawListCount);
+
+        //the gpu has to be done with every image
+        void destroyInstanceCuller(std::shared_ptr<VulkanDevice> device);
+
+        bool isCreated();
+
+        uint32_t getImageCount();
+
+        /*
+        grows imageIndex's outputs to fit drawLists and rewrites its descriptor sets, so imageIndex's last frame has to be finished. needed whenever
+        the draw lists or instances changed, before anything reads the outputs. old outputs are retired into deletionQueue
+        */
+        void prepareImage(std::shared_ptr<VulkanDevice> device, uint32_t imageIndex, VkBuffer uniformBuffer, VkDeviceSize uniformRange, VulkanVertexBuffer<InstanceData>& instances, std::vector<VulkanIndirectDrawList*>& drawLists, VulkanDeletionQueue* deletionQueue);
+
+        /*
+        records the culling of drawLists into commandBuffer, outside of the render pass, followed by a barrier for the indirect draws and vertex input
+        that read the results. drawLists have to be the ones imageIndex was last prepared with. the UniformBuffer is read at the dynamic offset uniformOffset
+        */
+        void recordCulling(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t uniformOffset, std::vector<VulkanIndirectDrawList*>& drawLists);
+
+        //imageIndex's visible instances. every set's survivors are packed at the start of its range in the instance pool
+        VkBuffer getVisibleInstanceBuffer(uint32_t imageIndex);
+
+        //drawLists[drawListIndex]'s commands with the visible instance counts, for imageIndex
+        VkBuffer getCulledCommandBuffer(uint32_t imageIndex, uint32_t drawListIndex);
+
+    private:
+        struct ImageOutputs {
+            VulkanVertexBuffer<InstanceData> visibleInstances = VulkanVertexBuffer<InstanceData>(DEVICE_LOCAL);
+
+            //one per draw list
+            std::vector<VulkanVertexBuffer<VkDrawIndirectCommand>> culledCommands;
+
+            std::vector<VkDescriptorSet> descriptorSets;
+        };
+
+        template<typename ElementType>
+        static void growOutput(std::shared_ptr<VulkanDevice> device, VulkanVertexBuffer<ElementType>& output, uint32_t count, VulkanDeletionQueue* deletionQueue);
+
+        std::vector<char> readFile(const std::string& filename);
+
+        VkShaderModule createShaderModule(const std::vector<char>& shaderCode, std::shared_ptr<VulkanDevice> device);
+
+        std::string computeShader = "shaders/output/comp_cull_instances.spv";
+
+        VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+
+        VkPipeline computePipeline = VK_NULL_HANDLE;
+
+        VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+
+        std::vector<ImageOutputs> images = std::vector<ImageOutputs>();
+
+        uint32_t drawListCount = 0;
+
+        bool hasBeenCreated = false;
+};
+
+#endif
\ No newline at end of file
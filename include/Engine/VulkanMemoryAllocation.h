@@ -0,0 +1,58 @@
+#ifndef VULKANMEMORYALLOCATION_H
+#define VULKANMEMORYALLOCATION_H
+
+#include "VulkanInclude.h"
+
+#include <string>
+#include <functional>
+
+//what an allocation is for, VulkanMemoryAllocator keeps live/peak numbers per category
+enum MEMORY_CATEGORY {
+    CATEGORY_OTHER,
+    CATEGORY_MODEL,
+    CATEGORY_INSTANCE_SET,
+    CATEGORY_OVERLAY,
+    CATEGORY_TEXTURE,
+    CATEGORY_TEXTURE_ARRAY,
+    CATEGORY_UNIFORM,
+    CATEGORY_STAGING,
+    CATEGORY_ATTACHMENT,
+    CATEGORY_COUNT
+};
+
+//category + owner of an allocation. owners are usually a model, instance set or texture id run through ownerIDFromName, 0 means no owner
+struct VulkanMemoryTag {
+    MEMORY_CATEGORY category = CATEGORY_OTHER;
+    uint64_t ownerID = 0;
+
+    VulkanMemoryTag() = default;
+
+    VulkanMemoryTag(MEMORY_CATEGORY _category, uint64_t _ownerID = 0) : category(_category), ownerID(_ownerID) {
+
+    }
+
+    VulkanMemoryTag(MEMORY_CATEGORY _category, const std::string& ownerName) : category(_category), ownerID(ownerIDFromName(ownerName)) {
+
+    }
+
+    static uint64_t ownerIDFromName(const std::string& ownerName) {
+        return (ownerName.empty()) ? 0 : std::hash<std::string>()(ownerName);
+    }
+};
+
+//a piece of a VkDeviceMemory page handed out by VulkanMemoryAllocator. bind resources at memory + offset, never vkFreeMemory/vkMapMemory it directly
+struct VulkanMemoryAllocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+
+    //only valid for HOST_VISIBLE memory types, already offset to the start of the allocation. the page stays mapped for its whole lifetime
+    void* mappedData = nullptr;
+
+    uint32_t memoryTypeIndex = 0;
+    uint64_t pageID = 0;
+
+    VulkanMemoryTag tag;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,247 @@
+#ifndef VULKANMEMORYALLOCATOR_H
+#define VULKANMEMORYALLOCATOR_H
+
+#include "VulkanInclude.h"
+#include "VulkanMemoryAllocation.h"
+#include "MemoryUsage.h"
+
+#include <map>
+#include <vector>
+#include <array>
+#include <mutex>
+#include <functional>
+
+struct VulkanMemoryPageInfo {
+    uint64_t pageID;
+    uint32_t memoryTypeIndex;
+    bool linear;
+    bool dedicated;
+    bool evacuating;
+    VkDeviceSize size;
+    VkDeviceSize usedBytes;
+    uint32_t allocationCount;
+    uint32_t freeBlockCount;
+    VkDeviceSize largestFreeBlock;
+};
+
+struct VulkanMemoryStats {
+    uint32_t pageCount = 0;
+    uint32_t dedicatedPageCount = 0;
+    uint32_t allocationCount = 0;
+
+    //bytes actually requested from the driver with vkAllocateMemory
+    VkDeviceSize reservedBytes = 0;
+    VkDeviceSize usedBytes = 0;
+    VkDeviceSize freeBytes = 0;
+
+    uint32_t freeBlockCount = 0;
+    VkDeviceSize largestFreeBlock = 0;
+
+    //fraction of the free bytes that isn't part of its page's largest free block. 0 means every page has one contiguous hole
+    float fragmentation = 0;
+};
+
+//live numbers for one category / owner, or for everything when it comes from getUsageStats
+struct VulkanMemoryUsageStats {
+    VkDeviceSize liveBytes = 0;
+    VkDeviceSize peakBytes = 0;
+    uint32_t allocationCount = 0;
+
+    //including allocations that have been freed since
+    uint64_t totalAllocationCount = 0;
+};
+
+struct VulkanHeapBudget {
+    uint32_t heapIndex = 0;
+    bool deviceLocal = false;
+    VkDeviceSize heapSize = 0;
+
+    //from VK_EXT_memory_budget when the device has it, otherwise 80% of the heap. setHeapBudget overrides either one
+    VkDeviceSize budget = 0;
+
+    //usage of the whole process according to the driver when VK_EXT_memory_budget is there, otherwise only the pages of this allocator
+    VkDeviceSize usage = 0;
+
+    //bytes of this heap held in pages of this allocator
+    VkDeviceSize allocatorBytes = 0;
+};
+
+/*
+splits large VkDeviceMemory pages into sub-allocations with a first-fit free list per page so we don't run into maxMemoryAllocationCount with thousands of instance sets.
+buffers and linear images never share a page with optimal images, so bufferImageGranularity can't be violated no matter how the free list packs things.
+host visible pages are mapped once when they are created and stay mapped until they are released.
+
+defragmentation works by evacuating pages: beginDefragmentation marks sparsely used pages, new allocations stop going into them, and the owners of
+whatever is left in them move it elsewhere (see VulkanVertexBuffer::relocate). a marked page is released as soon as its last allocation is freed.
+*/
+class VulkanMemoryAllocator {
+    public:
+        VulkanMemoryAllocator();
+
+        //memoryBudgetExtension should only be true if VK_EXT_memory_budget was enabled on logicalDevice
+        void create(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, bool memoryBudgetExtension = false);
+
+        //frees every page, including ones with live allocations. only call this once the device is idle and nothing references the memory anymore
+        void destroyMemoryAllocator();
+
+        //linearResource should be true for buffers and VK_IMAGE_TILING_LINEAR images
+        VulkanMemoryAllocation allocate(VkMemoryRequirements requirements, VkMemoryPropertyFlags properties, bool linearResource, VulkanMemoryTag tag = VulkanMemoryTag());
+
+        //same as above but the memory type comes from findMemoryTypeForUsage
+        VulkanMemoryAllocation allocate(VkMemoryRequirements requirements, MEMORY_USAGE usage, bool linearResource, VulkanMemoryTag tag = VulkanMemoryTag());
+
+        //safe to call from the delete threads. freeing a default constructed allocation does nothing
+        void free(VulkanMemoryAllocation allocation);
+
+        //first type that has all of properties, like the vulkan tutorial version but without querying the device every time
+        uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+        //scores every allowed type against what usage wants / wants to avoid, bigger heaps win ties
+        uint32_t findMemoryTypeForUsage(uint32_t typeFilter, MEMORY_USAGE usage);
+
+        //integrated gpus and software rasterizers like lavapipe, where device local memory is also host visible
+        bool isUnifiedMemory();
+
+        //a big (> 256MB) device local + host visible heap, so the cpu can write straight into vram
+        bool hasResizableBAR();
+
+        const VkPhysicalDeviceMemoryProperties& getMemoryProperties();
+
+        //requests larger than half of this get their own dedicated page
+        void setPreferredPageSize(VkDeviceSize size);
+
+        VulkanMemoryStats getStats();
+
+        std::vector<VulkanMemoryPageInfo> getPageUsage();
+
+        void printStats();
+
+        //accounting by VulkanMemoryTag. sizes are what the resources asked for, not what their pages reserve
+
+        VulkanMemoryUsageStats getUsageStats();
+
+        VulkanMemoryUsageStats getCategoryStats(MEMORY_CATEGORY category);
+
+        //owners are forgotten once their last allocation is freed, so this is all zeros for unknown or fully freed owners
+        VulkanMemoryUsageStats getOwnerStats(uint64_t ownerID);
+
+        VulkanMemoryUsageStats getOwnerStats(const std::string& ownerName);
+
+        //defragmentation
+
+        /*
+        marks pages that are less than maxOccupancy full for evacuation, as long as what they hold fits into the free space of the pages that stay.
+        returns how many pages were marked. does nothing while a previous pass is still going
+        */
+        uint32_t beginDefragmentation(float maxOccupancy);
+
+        //unmarks the pages that couldn't be emptied, they go back to being normal pages
+        void endDefragmentation();
+
+        bool isDefragmenting();
+
+        //true if allocation sits in a page that is being evacuated and should be moved
+        bool shouldRelocate(const VulkanMemoryAllocation& allocation);
+
+        //budgets
+
+        bool hasMemoryBudgetExtension();
+
+        std::vector<VulkanHeapBudget> getHeapBudgets();
+
+        //re-reads the driver numbers from VK_EXT_memory_budget and checks every heap against its budget. meant to be called once per frame
+        void updateBudget();
+
+        //0 goes back to the default budget for the heap
+        void setHeapBudget(uint32_t heapIndex, VkDeviceSize budget);
+
+        //called once when a heap goes over its budget, and again only after it has dropped back under. never called with the allocator locked
+        void setBudgetExceededCallback(std::function<void(const VulkanHeapBudget&)> callback);
+
+    private:
+        struct MemoryPage {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkDeviceSize size = 0;
+            void* mappedData = nullptr;
+            uint32_t memoryTypeIndex = 0;
+            bool linear = true;
+            bool dedicated = false;
+
+            //set by beginDefragmentation, nothing new is allocated from the page and it is released once it is empty
+            bool evacuating = false;
+
+            VkDeviceSize usedBytes = 0;
+            uint32_t allocationCount = 0;
+
+            //offset -> size, kept coalesced
+            std::map<VkDeviceSize, VkDeviceSize> freeBlocks;
+        };
+
+        VkDeviceSize getPageSizeForType(uint32_t memoryTypeIndex);
+
+        uint64_t createPage(uint32_t memoryTypeIndex, VkDeviceSize size, bool linear, bool dedicated);
+
+        void releasePage(uint64_t pageID);
+
+        VulkanMemoryAllocation allocateFromType(VkMemoryRequirements requirements, uint32_t memoryTypeIndex, bool linearResource);
+
+        void detectMemoryArchitecture();
+
+        VulkanMemoryAllocation allocateAndRecord(VkMemoryRequirements requirements, uint32_t memoryTypeIndex, bool linearResource, VulkanMemoryTag tag);
+
+        void recordAllocation(const VulkanMemoryAllocation& allocation);
+
+        void recordFree(const VulkanMemoryAllocation& allocation);
+
+        VulkanHeapBudget getHeapBudget(uint32_t heapIndex);
+
+        void checkBudgets();
+
+        bool allocateFromPage(MemoryPage& page, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+
+        static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment);
+
+        VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+
+        VkDevice logicalDevice = VK_NULL_HANDLE;
+
+        VkPhysicalDeviceMemoryProperties memoryProperties{};
+
+        bool unifiedMemory = false;
+
+        bool resizableBAR = false;
+
+        VkDeviceSize preferredPageSize = 64 * 1024 * 1024;
+
+        std::map<uint64_t, MemoryPage> pages = std::map<uint64_t, MemoryPage>();
+
+        //0 is reserved for "not allocated"
+        uint64_t nextPageID = 1;
+
+        VulkanMemoryUsageStats totalUsage;
+
+        std::array<VulkanMemoryUsageStats, CATEGORY_COUNT> categoryUsage = std::array<VulkanMemoryUsageStats, CATEGORY_COUNT>();
+
+        std::map<uint64_t, VulkanMemoryUsageStats> ownerUsage = std::map<uint64_t, VulkanMemoryUsageStats>();
+
+        bool memoryBudgetExtension = false;
+
+        std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> heapAllocatorBytes{};
+
+        //driver numbers from the last updateBudget, and how much of the heap this allocator held at that point
+        std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> heapDriverBudget{};
+        std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> heapDriverUsage{};
+        std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> heapAllocatorBytesAtUpdate{};
+
+        std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> heapBudgetOverride{};
+
+        std::array<bool, VK_MAX_MEMORY_HEAPS> heapOverBudget{};
+
+        std::function<void(const VulkanHeapBudget&)> budgetExceededCallback;
+
+        std::mutex allocatorMutex;
+
+        bool hasBeenCreated = false;
+};
+
+#endif
\ No newline at end of file
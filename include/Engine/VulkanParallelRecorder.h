@@ -0,0 +1,111 @@
+#ifndef VULKANPARALLELRECORDER_H
+#define VULKANPARALLELRECORDER_H
+
+#include "VulkanInclude.h"
+#include "VulkanDevice.h"
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+
+//one secondary command buffer worth of recording. the buffer is already begun for subpass of the render pass and gets ended afterwards
+struct VulkanRecordJob {
+    uint32_t subpass = 0;
+    std::function<void(VkCommandBuffer)> record;
+};
+
+/*
+records secondary command buffers on a fixed set of worker threads. every thread has its own command pool per swapchain image, since pools can't be
+used from two threads at once, and secondaries are reused from those pools instead of being freed. the calling thread works on the jobs too, so a
+thread count of 1 records everything inline without any workers.
+*/
+class VulkanParallelRecorder {
+    public:
+        VulkanParallelRecorder();
+
+        //threadCount includes the thread that calls record
+        void create(std::shared_ptr<VulkanDevice> device, uint32_t threadCount, uint32_t imageCount);
+
+        //joins the workers and destroys the pools. the gpu must be done with every secondary
+        void destroyParallelRecorder();
+
+        bool isCreated();
+
+        uint32_t getThreadCount();
+
+        uint32_t getImageCount();
+
+        //resets every pool of imageIndex, so the last primary that executed its secondaries has to be finished
+        void resetImage(uint32_t imageIndex);
+
+        //records every job into a secondary of imageIndex's pools and returns them in job order. blocks until all of them are done, rethrows the first error
+        std::vector<VkCommandBuffer> record(uint32_t imageIndex, VkRenderPass renderPass, VkFramebuffer framebuffer, std::vector<VulkanRecordJob>& jobs);
+
+        //runs plain cpu work that recording depends on, like culling, on the same threads. blocks until all of it is done, rethrows the first error
+        void runTasks(std::vector<std::function<void()>>& tasks);
+
+    private:
+        struct ThreadPools {
+            //one per swapchain image
+            std::vector<VkCommandPool> pools;
+            std::vector<std::vector<VkCommandBuffer>> buffers;
+            std::vector<size_t> usedBuffers;
+        };
+
+        void workerLoop(uint32_t threadIndex);
+
+        void runJobs(uint32_t threadIndex);
+
+        //wakes the workers for a batch of count jobs or tasks, works on it too and waits for everyone to finish
+        void runBatch(size_t count);
+
+        VkCommandBuffer acquireBuffer(uint32_t threadIndex);
+
+        VkDevice logicalDevice = VK_NULL_HANDLE;
+
+        uint32_t imageCount = 0;
+
+        std::vector<ThreadPools> threadPools = std::vector<ThreadPools>();
+
+        std::vector<std::thread> workers = std::vector<std::thread>();
+
+        std::mutex workMutex;
+
+        std::condition_variable workAvailable;
+
+        std::condition_variable workFinished;
+
+        //bumped for every record call, workers wake up when it changes
+        uint64_t workGeneration = 0;
+
+        uint32_t busyWorkers = 0;
+
+        bool stopWorkers = false;
+
+        std::atomic<size_t> nextJob = 0;
+
+        //the batch record is currently working on
+        std::vector<VulkanRecordJob>* currentJobs = nullptr;
+
+        std::vector<VkCommandBuffer>* currentResults = nullptr;
+
+        //set instead of currentJobs while runTasks is working
+        std::vector<std::function<void()>>* currentTasks = nullptr;
+
+        uint32_t currentImage = 0;
+
+        VkRenderPass currentRenderPass = VK_NULL_HANDLE;
+
+        VkFramebuffer currentFramebuffer = VK_NULL_HANDLE;
+
+        std::exception_ptr firstError = nullptr;
+
+        bool hasBeenCreated = false;
+};
+
+#endif
\ No newline at end of file
@@ -19,13 +19,34 @@ class VulkanRenderSyncObjects {
 
         std::vector<VkFence>& getInternalImagesInFlight();
 
-        constexpr static const int getMaxFramesInFlight() {
-            return MAX_FRAMES_IN_FLIGHT;
-        };
+        /*
+        every frame in flight has its own transient command pool. resetFrameCommandPool resets all of a frame's buffers at once with vkResetCommandPool,
+        so it may only be called once the frame's in flight fence has been waited on. the buffers stay allocated and get handed out again afterwards
+        */
+        void resetFrameCommandPool(std::shared_ptr<VulkanDevice> device, size_t frame);
+
+        //a buffer out of frame's pool that hasn't been handed out since the last reset. pools aren't thread safe, only use this from the render thread
+        VkCommandBuffer acquireFrameCommandBuffer(std::shared_ptr<VulkanDevice> device, size_t frame, VkCommandBufferLevel level);
+
+        //the deletion queue value of the last submission that signals frame's in flight fence, 0 before the frame was ever submitted
+        uint64_t getFrameTimelineValue(size_t frame);
+
+        void setFrameTimelineValue(size_t frame, uint64_t value);
+
+        int getMaxFramesInFlight();
+
+        /*
+        how many frames the cpu may get ahead of the gpu, 1 for the lowest latency and 3 for the most overlap. the frame objects are recreated right away
+        if they exist, so nothing may be in flight anymore (wait for the device to go idle first). imagesInFlight gets cleared, as it holds the old fences
+        */
+        void setMaxFramesInFlight(std::shared_ptr<VulkanDevice> device, int framesInFlight);
 
         bool isCreated();
 
     private:
+        void createFrameObjects(std::shared_ptr<VulkanDevice> device);
+
+        void destroyFrameObjects(std::shared_ptr<VulkanDevice> device);
 
         std::vector<VkSemaphore> imageAvailableSemaphores;
 
@@ -35,7 +56,21 @@ class VulkanRenderSyncObjects {
 
         std::vector<VkFence> imagesInFlight;
 
-        static const int MAX_FRAMES_IN_FLIGHT = 2;
+        struct FrameCommandPool {
+            VkCommandPool pool = VK_NULL_HANDLE;
+
+            //indexed by VkCommandBufferLevel
+            std::vector<VkCommandBuffer> buffers[2];
+            size_t usedBuffers[2] = {0, 0};
+        };
+
+        std::vector<FrameCommandPool> frameCommandPools;
+
+        std::vector<uint64_t> frameTimelineValues;
+
+        const static int DEFAULT_MAX_FRAMES_IN_FLIGHT = 2;
+
+        int maxFramesInFlight = DEFAULT_MAX_FRAMES_IN_FLIGHT;
 
         bool hasBeenCreated = false;
 };
@@ -0,0 +1,182 @@
+#ifndef VULKANSLOTMAP_H
+#define VULKANSLOTMAP_H
+
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+
+/*
+a 32 bit reference into a VulkanSlotMap. the low 20 bits are the slot and the high 12 bits the generation the slot had when the handle was made,
+so a handle to an erased value stops resolving even after its slot is reused (until the generation wraps after 4095 reuses of that slot). Tag only
+exists to make handles of different registries different types. 0 is never handed out, a default constructed handle never resolves.
+*/
+template<typename Tag>
+struct VulkanHandle {
+    const static uint32_t INDEX_BITS = 20;
+
+    const static uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+
+    const static uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+    uint32_t value = 0;
+
+    static VulkanHandle create(uint32_t index, uint32_t generation) {
+        VulkanHandle handle;
+        handle.value = (generation << INDEX_BITS) | index;
+        return handle;
+    }
+
+    uint32_t getIndex() const {
+        return value & INDEX_MASK;
+    }
+
+    uint32_t getGeneration() const {
+        return value >> INDEX_BITS;
+    }
+
+    bool isNull() const {
+        return value == 0;
+    }
+
+    bool operator==(const VulkanHandle& other) const {
+        return value == other.value;
+    }
+
+    bool operator!=(const VulkanHandle& other) const {
+        return value != other.value;
+    }
+};
+
+/*
+values are kept packed in one vector so iterating them is a linear walk, and handles go through a slot table to find them in O(1). erasing moves
+the last value into the hole, so references and the order of getValues() only stay valid until the next insert or erase.
+two maps that always see the same sequence of inserts and erases hand out the same handles.
+*/
+template<typename ValueType, typename HandleType>
+class VulkanSlotMap {
+    public:
+        HandleType insert(ValueType&& value) {
+            uint32_t slot = 0;
+
+            if(!freeSlots.empty()) {
+                slot = freeSlots.back();
+                freeSlots.pop_back();
+            }else {
+                if(slots.size() > HandleType::INDEX_MASK) {
+                    throw std::runtime_error("slot map is full, handles can't address more slots!");
+                }
+
+                slot = static_cast<uint32_t>(slots.size());
+                slots.push_back(Slot());
+            }
+
+            slots[slot].denseIndex = static_cast<uint32_t>(values.size());
+
+            values.push_back(std::move(value));
+            denseSlots.push_back(slot);
+
+            return HandleType::create(slot, slots[slot].generation);
+        }
+
+        //does nothing for handles that don't resolve
+        void erase(HandleType handle) {
+            if(!contains(handle)) {
+                return;
+            }
+
+            uint32_t slot = handle.getIndex();
+            uint32_t denseIndex = slots[slot].denseIndex;
+            uint32_t last = static_cast<uint32_t>(values.size()) - 1;
+
+            if(denseIndex != last) {
+                values[denseIndex] = std::move(values[last]);
+                denseSlots[denseIndex] = denseSlots[last];
+                slots[denseSlots[denseIndex]].denseIndex = denseIndex;
+            }
+
+            values.pop_back();
+            denseSlots.pop_back();
+
+            retireSlot(slot);
+        }
+
+        bool contains(HandleType handle) const {
+            uint32_t slot = handle.getIndex();
+
+            return !handle.isNull() && slot < slots.size() && slots[slot].generation == handle.getGeneration() && slots[slot].denseIndex != FREE;
+        }
+
+        //nullptr for handles that don't resolve
+        ValueType* find(HandleType handle) {
+            if(!contains(handle)) {
+                return nullptr;
+            }
+
+            return &values[slots[handle.getIndex()].denseIndex];
+        }
+
+        ValueType& at(HandleType handle) {
+            if(!contains(handle)) {
+                throw std::runtime_error("handle doesn't refer to anything, it was erased or never handed out by this map!");
+            }
+
+            return values[slots[handle.getIndex()].denseIndex];
+        }
+
+        //the handle of getValues()[denseIndex]
+        HandleType getHandle(size_t denseIndex) const {
+            uint32_t slot = denseSlots[denseIndex];
+
+            return HandleType::create(slot, slots[slot].generation);
+        }
+
+        std::vector<ValueType>& getValues() {
+            return values;
+        }
+
+        size_t size() const {
+            return values.size();
+        }
+
+        bool empty() const {
+            return values.empty();
+        }
+
+        //every handle handed out so far stops resolving
+        void clear() {
+            for(uint32_t slot : denseSlots) {
+                retireSlot(slot);
+            }
+
+            values.clear();
+            denseSlots.clear();
+        }
+
+    private:
+        const static uint32_t FREE = UINT32_MAX;
+
+        struct Slot {
+            uint32_t denseIndex = FREE;
+
+            //starts at 1 so that no handle is 0
+            uint32_t generation = 1;
+        };
+
+        void retireSlot(uint32_t slot) {
+            slots[slot].denseIndex = FREE;
+            slots[slot].generation = (slots[slot].generation == HandleType::GENERATION_MASK) ? 1 : slots[slot].generation + 1;
+
+            freeSlots.push_back(slot);
+        }
+
+        std::vector<ValueType> values = std::vector<ValueType>();
+
+        //which slot every value belongs to, parallel to values
+        std::vector<uint32_t> denseSlots = std::vector<uint32_t>();
+
+        std::vector<Slot> slots = std::vector<Slot>();
+
+        std::vector<uint32_t> freeSlots = std::vector<uint32_t>();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,113 @@
+#ifndef VULKANSTAGINGRING_H
+#define VULKANSTAGINGRING_H
+
+#include "VulkanInclude.h"
+#include "VulkanMemoryAllocator.h"
+
+#include <map>
+#include <vector>
+#include <deque>
+#include <memory>
+
+/*
+one persistently mapped host visible buffer that uploads to DEVICE_LOCAL buffers are written into. copies are queued up and recorded at the start of
+each frame's command buffer (recordUploads), in front of that frame's draw commands, so there's no single-time command + queue wait per buffer.
+space in the ring is handed back once the submission that consumed it has finished (releaseSubmissions). if the ring fills up before the next frame it falls back to
+flushing everything immediately, and uploads larger than the whole ring grow it.
+*/
+class VulkanStagingRing {
+    public:
+        VulkanStagingRing();
+
+        void create(VkDevice logicalDevice, std::shared_ptr<VulkanMemoryAllocator> allocator, VkCommandPool commandPool, VkQueue queue, VkDeviceSize capacity);
+
+        //the device must be idle
+        void destroyStagingRing();
+
+        /*
+        copies size bytes of data into the ring and queues a copy into dstBuffer at dstOffset. dstBuffer needs VK_BUFFER_USAGE_TRANSFER_DST_BIT.
+        a later stage of the same bytes replaces the earlier one, and ranges that are adjacent in both the ring and dstBuffer are merged into one copy region
+        */
+        void stage(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+
+        //like stage, but returns the ring memory so the caller can write the data itself. the pointer is only valid until the next stage call
+        void* stageInPlace(VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size);
+
+        //drops queued copies into a buffer that is about to be destroyed
+        void cancelUploads(VkBuffer dstBuffer);
+
+        /*
+        queues a gpu side copy of the first size bytes of srcBuffer into dstBuffer, used to move buffers around when defragmenting. moves are recorded before
+        the staged copies of the same batch, so anything staged into dstBuffer afterwards still ends up on top. both buffers need the matching TRANSFER usage bit
+        */
+        void moveBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+
+        //queued copies into oldBuffer go into newBuffer instead. used when a buffer has been replaced by a moved copy of itself
+        void retargetUploads(VkBuffer oldBuffer, VkBuffer newBuffer);
+
+        /*
+        records every queued copy into commandBuffer, which has to be outside of a render pass and goes to the gpu with the submission whose
+        deletion queue value is submission. does nothing if nothing is queued
+        */
+        void recordUploads(VkCommandBuffer commandBuffer, uint64_t submission);
+
+        //hands back the space of every submission up to and including completedSubmission, which has to have finished on the gpu
+        void releaseSubmissions(uint64_t completedSubmission);
+
+        //submits every queued copy and waits for the queue to go idle
+        void flushImmediately();
+
+        bool hasPendingUploads();
+
+        VkDeviceSize getCapacity();
+
+    private:
+        void createRingBuffer(VkDeviceSize size);
+
+        void destroyRingBuffer();
+
+        bool reserve(VkDeviceSize size, VkDeviceSize& offset);
+
+        void recordCopies(VkCommandBuffer commandBuffer);
+
+        void addCopyRegion(std::map<VkDeviceSize, VkBufferCopy>& regions, VkBufferCopy region);
+
+        VkDevice logicalDevice = VK_NULL_HANDLE;
+
+        std::shared_ptr<VulkanMemoryAllocator> allocator = nullptr;
+
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+
+        VkQueue queue = VK_NULL_HANDLE;
+
+        VkBuffer ringBuffer = VK_NULL_HANDLE;
+
+        VulkanMemoryAllocation ringMemory;
+
+        VkDeviceSize capacity = 0;
+
+        //every field in the vertex formats is 4 bytes, so this keeps consecutive element updates contiguous in the ring
+        const static VkDeviceSize RING_ALIGNMENT = 4;
+
+        //monotonic byte positions, the ring offset is position % capacity. [tail, head) is still in use by the gpu or waiting to be recorded
+        uint64_t head = 0;
+        uint64_t tail = 0;
+
+        //dst buffer -> (dstOffset -> region), regions for one buffer never overlap
+        std::map<VkBuffer, std::map<VkDeviceSize, VkBufferCopy>> pendingCopies = std::map<VkBuffer, std::map<VkDeviceSize, VkBufferCopy>>();
+
+        struct BufferMove {
+            VkBuffer srcBuffer;
+            VkBuffer dstBuffer;
+            VkDeviceSize size;
+        };
+
+        std::vector<BufferMove> pendingMoves = std::vector<BufferMove>();
+
+        //(submission, head after that submission's uploads) in submission order
+        std::deque<std::pair<uint64_t, uint64_t>> submissionMarkers = std::deque<std::pair<uint64_t, uint64_t>>();
+
+        bool hasBeenCreated = false;
+};
+
+#endif
\ No newline at end of file
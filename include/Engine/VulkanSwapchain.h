@@ -32,8 +32,6 @@ class VulkanSwapchain {
 
         std::vector<VkFramebuffer>& getInternalFramebuffers();
 
-        std::vector<VkCommandBuffer>& getInternalCommandBuffers();
-
         VkRenderPass& getInternalRenderPass();
 
         std::vector<FramebufferAttachment>& getFramebufferAttachment(int index);
@@ -63,8 +61,6 @@ class VulkanSwapchain {
 
         void createFramebuffers(std::shared_ptr<VulkanDevice> device);
 
-        void createCommandBuffers(std::shared_ptr<VulkanDevice> device);
-
         void createUserDefinedAttachments(std::shared_ptr<VulkanDevice> device);
         
         VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, std::shared_ptr<VulkanDisplay> vkDisplay);
@@ -81,8 +77,6 @@ class VulkanSwapchain {
 
         std::vector<VkFramebuffer> swapChainFramebuffers;
 
-        std::vector<VkCommandBuffer> commandBuffers;
-
         VkRenderPass renderPass;
         
         bool hasBeenCreated = false;
@@ -0,0 +1,61 @@
+#ifndef VULKANUNIFORMRING_H
+#define VULKANUNIFORMRING_H
+
+#include "VulkanInclude.h"
+#include "VulkanDevice.h"
+
+#include <memory>
+
+/*
+one persistently mapped uniform buffer split into equally sized regions, one per swapchain image. descriptors point at the whole buffer with
+VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC and the region / slot is picked with the dynamic offset when the descriptor set gets bound, so the
+descriptors never have to be rewritten when the data changes. every offset handed out is aligned to minUniformBufferOffsetAlignment.
+*/
+class VulkanUniformRing {
+    public:
+        VulkanUniformRing();
+
+        void create(std::shared_ptr<VulkanDevice> device, VkDeviceSize regionSize, uint32_t regionCount);
+
+        void destroyUniformRing(std::shared_ptr<VulkanDevice> device);
+
+        bool isCreated();
+
+        //copies data to an offset that was returned by getRegionOffset / alignSize arithmetic or by push
+        void write(uint32_t offset, const void* data, VkDeviceSize size);
+
+        //starts handing out push slots from reservedBytes into region again. only call once the gpu is done with the region
+        void beginRegion(uint32_t region, VkDeviceSize reservedBytes);
+
+        //copies data into the next free slot of the current region and returns its dynamic offset, for per draw uniform data
+        uint32_t push(const void* data, VkDeviceSize size);
+
+        uint32_t getRegionOffset(uint32_t region);
+
+        VkDeviceSize alignSize(VkDeviceSize size);
+
+        VkBuffer getUniformBuffer();
+
+        uint32_t getRegionCount();
+
+        VkDeviceSize getRegionSize();
+
+    private:
+        VkBuffer uniformBuffer = VK_NULL_HANDLE;
+
+        VulkanMemoryAllocation uniformBufferMemory;
+
+        VkDeviceSize alignment = 256;
+
+        VkDeviceSize regionSize = 0;
+
+        uint32_t regionCount = 0;
+
+        uint32_t currentRegion = 0;
+
+        VkDeviceSize regionCursor = 0;
+
+        bool hasBeenCreated = false;
+};
+
+#endif
\ No newline at end of file
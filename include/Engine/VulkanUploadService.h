@@ -0,0 +1,131 @@
+#ifndef VULKANUPLOADSERVICE_H
+#define VULKANUPLOADSERVICE_H
+
+#include "VulkanInclude.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanDeletionQueue.h"
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <optional>
+
+//identifies one upload of VulkanUploadService, 0 is never handed out and always counts as complete
+using VulkanUploadToken = uint64_t;
+
+/*
+copies asset data into images and DEVICE_LOCAL buffers without waiting for it. every upload gets its own staging buffer and command buffer and is
+submitted on its own, to the dedicated transfer queue when the device has one, so the copy runs next to rendering instead of in front of it.
+nothing is waited on when submitting, callers get a token they can poll or wait on instead.
+
+with a transfer queue the resources are EXCLUSIVE to one queue family at a time, so the upload ends with a release to the graphics family and the next
+frame's command buffer records the matching acquire (recordAcquires). that frame waits on a semaphore the upload signals, on the gpu only, so the cpu
+never blocks on an upload. without a transfer queue the upload goes to the graphics queue and ends in the final layout right away.
+
+whole images are copied at offset 0, which every queue family supports whatever its minImageTransferGranularity.
+not thread safe, only upload and record acquires from the render thread.
+*/
+class VulkanUploadService {
+    public:
+        VulkanUploadService();
+
+        //transferFamily / transferQueue are only used if transferFamily has a value
+        void create(VkDevice logicalDevice, std::shared_ptr<VulkanMemoryAllocator> allocator, std::shared_ptr<VulkanDeletionQueue> deletionQueue, uint32_t graphicsFamily, VkQueue graphicsQueue, std::optional<uint32_t> transferFamily, VkQueue transferQueue);
+
+        //the device must be idle
+        void destroyUploadService();
+
+        /*
+        copies layers.size() layers of layerSize bytes each into image, which has to have a single mip level, be in VK_IMAGE_LAYOUT_UNDEFINED and have
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT. the image ends up in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL. the layer data is copied before this returns
+        */
+        VulkanUploadToken uploadImage(VkImage image, uint32_t width, uint32_t height, const std::vector<const void*>& layers, VkDeviceSize layerSize);
+
+        //copies size bytes of data into dstBuffer at dstOffset. dstBuffer needs VK_BUFFER_USAGE_TRANSFER_DST_BIT and mustn't be used by the gpu until the frame after
+        VulkanUploadToken uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+
+        //whether the copy of token has finished on the gpu, never blocks
+        bool isComplete(VulkanUploadToken token);
+
+        //blocks until the copy of token has finished
+        void wait(VulkanUploadToken token);
+
+        /*
+        records the graphics side of the ownership transfers of every upload submitted since the last call into commandBuffer, which has to be outside of a
+        render pass. the submission of commandBuffer has to wait on the semaphores appended to waitSemaphores at the matching waitStages, they are destroyed
+        once the submission whose deletion queue value is being recorded has finished. does nothing without a transfer queue
+        */
+        void recordAcquires(VkCommandBuffer commandBuffer, std::vector<VkSemaphore>& waitSemaphores, std::vector<VkPipelineStageFlags>& waitStages);
+
+        //hands back the staging buffers and command buffers of finished uploads, never blocks
+        void collect();
+
+        bool usesTransferQueue();
+
+        size_t getPendingCount();
+
+    private:
+        struct Upload {
+            VulkanUploadToken token = 0;
+
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+
+            VkFence fence = VK_NULL_HANDLE;
+
+            VkBuffer stagingBuffer = VK_NULL_HANDLE;
+
+            VulkanMemoryAllocation stagingMemory;
+        };
+
+        //creates the staging buffer and begins the command buffer of a new upload
+        Upload beginUpload(VkDeviceSize size);
+
+        //ends, submits and tracks upload, signalling a semaphore for the acquire if there is a transfer queue
+        VulkanUploadToken submitUpload(Upload& upload);
+
+        void finishUpload(Upload& upload);
+
+        VkFence getFence();
+
+        VkDevice logicalDevice = VK_NULL_HANDLE;
+
+        std::shared_ptr<VulkanMemoryAllocator> allocator = nullptr;
+
+        std::shared_ptr<VulkanDeletionQueue> deletionQueue = nullptr;
+
+        uint32_t graphicsFamily = 0;
+
+        //the family and queue uploads are submitted to, the transfer ones if there are any
+        uint32_t uploadFamily = 0;
+
+        VkQueue uploadQueue = VK_NULL_HANDLE;
+
+        bool transferQueueUsed = false;
+
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+
+        //every stage the uploaded resources can be used in, the frame waits for the upload semaphores right before them
+        constexpr static VkPipelineStageFlags ACQUIRE_STAGES = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                                                               VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+        //in token order, which is also submission order on the one queue, so the finished ones are at the front
+        std::deque<Upload> inFlightUploads = std::deque<Upload>();
+
+        std::vector<VkFence> freeFences = std::vector<VkFence>();
+
+        //released but not yet acquired by a frame
+        std::vector<VkSemaphore> acquireSemaphores = std::vector<VkSemaphore>();
+
+        std::vector<VkImageMemoryBarrier> acquireImageBarriers = std::vector<VkImageMemoryBarrier>();
+
+        std::vector<VkBufferMemoryBarrier> acquireBufferBarriers = std::vector<VkBufferMemoryBarrier>();
+
+        VulkanUploadToken nextToken = 1;
+
+        //every token up to and including this one is complete
+        VulkanUploadToken completedToken = 0;
+
+        bool hasBeenCreated = false;
+};
+
+#endif
\ No newline at end of file
@@ -4,153 +4,359 @@
 #include "Vertex.h"
 
 #include "Engine/VulkanEngine.h"
+#include "Engine/BufferPlacement.h"
 
 #include <cstring>
-
-#include "DeleteThread/DeleteThread.h"
+#include <algorithm>
+#include <span>
 
 template <class VertexType>
 class VulkanVertexBuffer {
     public:
         VulkanVertexBuffer() = default;
 
+        VulkanVertexBuffer(BUFFER_PLACEMENT _placement) : placement(_placement) {
+
+        }
+
         ~VulkanVertexBuffer() = default;
 
-        static void createMemoryHandler(std::shared_ptr<VulkanDevice> device) {
-            if(createMemoryHandlers) {
-                bufferDeleteFunction = std::bind(&VulkanVertexBuffer::vkBufferDelete, device, std::placeholders::_1);
-                bufferDeleteThread = std::make_shared<DeleteThread<VkBuffer>>(bufferDeleteFunction);
+        //spelled out because the destructor above would otherwise turn moves into copies of the cpu side data
+        VulkanVertexBuffer(const VulkanVertexBuffer&) = default;
 
-                memoryFreeFunction = std::bind(&VulkanVertexBuffer::vkMemoryDelete, device, std::placeholders::_1);
-                memoryDeleteThread = std::make_shared<DeleteThread<VkDeviceMemory>>(memoryFreeFunction);
+        VulkanVertexBuffer(VulkanVertexBuffer&&) = default;
 
-                createMemoryHandlers = false;
+        VulkanVertexBuffer& operator=(const VulkanVertexBuffer&) = default;
+
+        VulkanVertexBuffer& operator=(VulkanVertexBuffer&&) = default;
+
+        void create(std::shared_ptr<VulkanDevice> device) {
+            if(placement == DEVICE_LOCAL) {
+                VulkanEngine::createBuffer(sizeof(VertexType) * capacity, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | extraUsage, USAGE_STATIC_GEOMETRY, vertexBuffer, vertexBufferMemory, device, memoryTag);
+            }else {
+                VulkanEngine::createBuffer(sizeof(VertexType) * capacity, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | extraUsage, USAGE_STREAMING, vertexBuffer, vertexBufferMemory, device, memoryTag);
             }
+
+            //on unified memory devices static geometry lands in mappable memory too, in which case it gets written directly instead of going through the staging ring
+            bufferMap = vertexBufferMemory.mappedData;
         }
 
-        void create(std::shared_ptr<VulkanDevice> device) {
-            if(createMemoryHandlers) {
-                bufferDeleteFunction = std::bind(&VulkanVertexBuffer::vkBufferDelete, device, std::placeholders::_1);
-                bufferDeleteThread = std::make_shared<DeleteThread<VkBuffer>>(bufferDeleteFunction);
+        /*
+        the buffer keeps room for capacity elements and only gets reallocated when the new data doesn't fit or uses less than 1/SHRINK_DIVISOR of it.
+        a replaced buffer is retired into deletionQueue so frames in flight can finish with it. without one we fall back to waiting for the whole
+        device to go idle.
+        */
+        void setVertexData(std::shared_ptr<VulkanDevice> device, std::span<const VertexType> newVertices, VulkanDeletionQueue* deletionQueue = nullptr) {
+            resize(device, newVertices.size(), deletionQueue);
+
+            if(keepCPUCopy) {
+                vertices.assign(newVertices.begin(), newVertices.end());
+            }
+
+            writeVertices(device, 0, newVertices.data(), newVertices.size());
+        }
+
+        //same as above, but the vector becomes the cpu copy instead of being copied into it
+        void setVertexData(std::shared_ptr<VulkanDevice> device, std::vector<VertexType>&& newVertices, VulkanDeletionQueue* deletionQueue = nullptr) {
+            resize(device, newVertices.size(), deletionQueue);
 
-                memoryFreeFunction = std::bind(&VulkanVertexBuffer::vkMemoryDelete, device, std::placeholders::_1);
-                memoryDeleteThread = std::make_shared<DeleteThread<VkDeviceMemory>>(memoryFreeFunction);
+            writeVertices(device, 0, newVertices.data(), newVertices.size());
 
-                createMemoryHandlers = false;
+            if(keepCPUCopy) {
+                vertices = std::move(newVertices);
+            }
+        }
+
+        /*
+        resizes the buffer to count elements and returns memory to fill them in place: the mapped buffer if it is mappable, a piece of the staging ring if
+        it isn't, or the cpu copy if one is kept. call finishWrite once everything has been written and don't set any other buffer's data in between
+        */
+        std::span<VertexType> beginWrite(std::shared_ptr<VulkanDevice> device, uint32_t count, VulkanDeletionQueue* deletionQueue = nullptr) {
+            resize(device, count, deletionQueue);
+
+            if(count == 0) {
+                return std::span<VertexType>();
             }
 
-            VulkanEngine::createBuffer(sizeof(VertexType) * vertices.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, vertexBuffer, vertexBufferMemory, device);
-            vkMapMemory(device->getInternalLogicalDevice(), vertexBufferMemory, 0, sizeof(VertexType) * vertices.size(), 0, &bufferMap);
+            if(keepCPUCopy) {
+                vertices.resize(count);
+                return std::span<VertexType>(vertices.data(), count);
+            }
+
+            if(bufferMap == nullptr) {
+                return std::span<VertexType>(static_cast<VertexType*>(device->getStagingRing()->stageInPlace(vertexBuffer, 0, sizeof(VertexType) * count)), count);
+            }
 
-            std::memcpy(bufferMap, vertices.data(), (size_t) sizeof(VertexType) * vertices.size());
+            return std::span<VertexType>(static_cast<VertexType*>(bufferMap), count);
         }
 
-        void setVertexData(std::shared_ptr<VulkanDevice> device, std::vector<VertexType> newVertices) {
-            vertices = newVertices;
+        void finishWrite(std::shared_ptr<VulkanDevice> device) {
+            //without a cpu copy the data is already where it needs to be
+            if(keepCPUCopy) {
+                writeVertices(device, 0, vertices.data(), vertices.size());
+            }
+        }
 
-            if(sizeOfCurrentBuffer == 0) {
-                if(vertices.size() > 0) {
-                    create(device);
-                    sizeOfCurrentBuffer = vertices.size();
-                    return;
-                }else {
-                    return; //can't allocate empty buffer. trust me, i tried
-                }
+        //overwrites newVertices.size() elements starting at offset without touching the rest of the buffer. the range has to be inside the current size
+        void updateVertexRange(std::shared_ptr<VulkanDevice> device, uint32_t offset, std::span<const VertexType> newVertices) {
+            if(newVertices.size() == 0) {
+                return;
             }
 
-            if(sizeOfCurrentBuffer != vertices.size()) {
-                vkDeviceWaitIdle(device->getInternalLogicalDevice());
-                bool temp = true;
-                destroy(device, &temp); //ok because ptr isn't stored
-                create(device);
-            }else {
-                memcpy(bufferMap, vertices.data(), (size_t) sizeof(VertexType) * vertices.size());
+            if(offset + newVertices.size() > sizeOfCurrentBuffer) {
+                throw std::runtime_error("vertex range update is out of the buffer's bounds!");
             }
 
-            sizeOfCurrentBuffer = vertices.size();
+            if(keepCPUCopy) {
+                std::copy(newVertices.begin(), newVertices.end(), vertices.begin() + offset);
+            }
+
+            writeVertices(device, offset, newVertices.data(), newVertices.size());
         }
 
-        void destroy(std::shared_ptr<VulkanDevice> device, bool* deleteOldBufferBool) {
-            if(vertexBufferMemory != VK_NULL_HANDLE && vertexBuffer != VK_NULL_HANDLE) {
-                vkUnmapMemory(device->getInternalLogicalDevice(), vertexBufferMemory);
+        /*
+        the cpu copy is never read back by the renderer, it only exists for getVertices. turning it off means only the gpu buffer holds the data,
+        which roughly halves peak memory for big instance sets
+        */
+        void setKeepCPUCopy(bool keep) {
+            keepCPUCopy = keep;
 
-                if(*deleteOldBufferBool) {
-                    vkDestroyBuffer(device->getInternalLogicalDevice(), vertexBuffer, nullptr);
-                    vkFreeMemory(device->getInternalLogicalDevice(), vertexBufferMemory, nullptr);
-                }else {
-                    bufferDeleteThread->addObjectToDelete(vertexBuffer, deleteOldBufferBool);
-                    memoryDeleteThread->addObjectToDelete(vertexBufferMemory, deleteOldBufferBool);
-                }
+            if(!keepCPUCopy) {
+                std::vector<VertexType>().swap(vertices);
+            }
+        }
+
+        bool keepsCPUCopy() {
+            return keepCPUCopy;
+        }
+
+        //empty when the cpu copy is turned off
+        const std::vector<VertexType>& getVertices() {
+            return vertices;
+        }
+
+        //whether the allocator wants this buffer's memory back, see VulkanMemoryAllocator::beginDefragmentation
+        bool shouldRelocate(std::shared_ptr<VulkanDevice> device) {
+            return device->getMemoryAllocator()->shouldRelocate(vertexBufferMemory);
+        }
+
+        /*
+        moves the contents into a newly allocated buffer of the same capacity. mapped buffers are copied right away, the rest with a gpu copy in the next
+        upload batch. the old buffer is retired into deletionQueue since frames in flight may still draw from it. returns the number of bytes moved
+        */
+        VkDeviceSize relocate(std::shared_ptr<VulkanDevice> device, VulkanDeletionQueue* deletionQueue) {
+            if(vertexBuffer == VK_NULL_HANDLE) {
+                return 0;
+            }
+
+            return moveToNewBuffer(device, capacity, deletionQueue);
+        }
+
+        /*
+        sets the size to count elements but, unlike setVertexData, keeps the contents of the first min(count, size) elements. growing moves the buffer
+        the same way relocate does. used by VulkanGeometryPool, which hands out ranges of one buffer
+        */
+        void resizePreservingContents(std::shared_ptr<VulkanDevice> device, uint32_t count, VulkanDeletionQueue* deletionQueue) {
+            if(count > capacity) {
+                moveToNewBuffer(device, std::max<uint32_t>(count, capacity * GROWTH_FACTOR), deletionQueue);
+            }
+
+            sizeOfCurrentBuffer = count;
+        }
+
+        //like beginWrite for elements [offset, offset + count) of the current size, without resizing anything. only for buffers that don't keep a cpu copy
+        std::span<VertexType> beginRangeWrite(std::shared_ptr<VulkanDevice> device, uint32_t offset, uint32_t count) {
+            if(keepCPUCopy) {
+                throw std::runtime_error("beginRangeWrite can't be used on a vertex buffer that keeps a cpu copy!");
+            }
+
+            if(offset + count > sizeOfCurrentBuffer) {
+                throw std::runtime_error("vertex range write is out of the buffer's bounds!");
+            }
+
+            if(count == 0) {
+                return std::span<VertexType>();
+            }
+
+            if(bufferMap == nullptr) {
+                return std::span<VertexType>(static_cast<VertexType*>(device->getStagingRing()->stageInPlace(vertexBuffer, sizeof(VertexType) * offset, sizeof(VertexType) * count)), count);
+            }
+
+            return std::span<VertexType>(static_cast<VertexType*>(bufferMap) + offset, count);
+        }
+
+        //the buffer goes into deletionQueue, or is destroyed right away with nullptr. only do that if the gpu isn't using it
+        void destroy(std::shared_ptr<VulkanDevice> device, VulkanDeletionQueue* deletionQueue) {
+            if(vertexBufferMemory.memory != VK_NULL_HANDLE && vertexBuffer != VK_NULL_HANDLE) {
+                device->getStagingRing()->cancelUploads(vertexBuffer);
+
+                destroyBuffer(device, vertexBuffer, vertexBufferMemory, deletionQueue);
             }else {
-                if(vertices.size() != 0) {
+                if(sizeOfCurrentBuffer != 0) {
                     std::cout << "invalid vkbuffer or vkbuffermemory pointers used when trying to delete vulkanvertexbuffer" << std::endl;
                 }else {
-                    //nothing to delete b/c the handles are NULL. this is ok when vertices.size() == 0 b/c it just means that there was never any geometry set in the buffer so it was never created
+                    //nothing to delete b/c the handles are NULL. this is ok when sizeOfCurrentBuffer == 0 b/c it just means that there was never any geometry set in the buffer so it was never created
                 }
             }
+
+            vertexBuffer = VK_NULL_HANDLE;
+            vertexBufferMemory = VulkanMemoryAllocation();
+            bufferMap = nullptr;
+            vertices.clear();
+            capacity = 0;
+            sizeOfCurrentBuffer = 0;
+        }
+
+        //only affects buffers created after this is called, so set it before the first setVertexData
+        void setPlacement(BUFFER_PLACEMENT newPlacement) {
+            placement = newPlacement;
+        }
+
+        //what the allocator books this buffer's memory under. like the placement, it only applies once the buffer is (re)allocated
+        void setMemoryTag(VulkanMemoryTag tag) {
+            memoryTag = tag;
+        }
+
+        //usage bits on top of VERTEX_BUFFER (and the transfer bits for DEVICE_LOCAL), e.g. INDIRECT_BUFFER. same rules as setPlacement
+        void setExtraUsage(VkBufferUsageFlags usage) {
+            extraUsage = usage;
+        }
+
+        BUFFER_PLACEMENT getPlacement() {
+            return placement;
         }
 
         VkBuffer getVertexBuffer() {
             return vertexBuffer;
         }
 
+        //number of elements that have been set, use this for draw counts
         uint32_t getBufferSize() {
             return sizeOfCurrentBuffer;
         }
 
-        static void forceJoinDeleteThreads() {
-            if(bufferDeleteThread != nullptr) {
-                bufferDeleteThread->forceJoin();
-            }
-           
-            if(memoryDeleteThread != nullptr) {
-                memoryDeleteThread->forceJoin();
-            }   
-        }
-
-        static std::pair<std::mutex*, std::mutex*> getDeleteFunctionMutexes() {
-            return std::make_pair<std::mutex*, std::mutex*>(bufferDeleteThread->getMutexPointer(), memoryDeleteThread->getMutexPointer());
+        //number of elements the current VkBuffer has room for
+        uint32_t getCapacity() {
+            return capacity;
         }
 
     private:
-        static bool createMemoryHandlers;
         VkBuffer vertexBuffer{nullptr};
-        VkDeviceMemory vertexBufferMemory;
+        VulkanMemoryAllocation vertexBufferMemory;
         std::vector<VertexType> vertices;
-        void* bufferMap;
+        void* bufferMap = nullptr;
         uint32_t sizeOfCurrentBuffer = 0;
+        uint32_t capacity = 0;
+        BUFFER_PLACEMENT placement = HOST_VISIBLE;
 
-        static void vkBufferDelete(std::shared_ptr<VulkanDevice> device, VkBuffer buffer) {
-            vkDestroyBuffer(device->getInternalLogicalDevice(), buffer, nullptr);
+        VulkanMemoryTag memoryTag = VulkanMemoryTag();
+
+        VkBufferUsageFlags extraUsage = 0;
+
+        const static uint32_t GROWTH_FACTOR = 2;
+        const static uint32_t SHRINK_DIVISOR = 4;
+
+        bool keepCPUCopy = true;
+
+        //picks a new capacity if count doesn't fit or wastes too much of the current one. the contents are undefined afterwards and have to be rewritten
+        void resize(std::shared_ptr<VulkanDevice> device, uint32_t count, VulkanDeletionQueue* deletionQueue) {
+            if(count > capacity) {
+                //static geometry gets an exact fit, anything that has to grow again gets headroom
+                reallocate(device, (capacity == 0) ? count : std::max<uint32_t>(count, capacity * GROWTH_FACTOR), deletionQueue);
+            }else if(count * SHRINK_DIVISOR < capacity) {
+                reallocate(device, count * GROWTH_FACTOR, deletionQueue);
+            }
+
+            sizeOfCurrentBuffer = count;
         }
 
-        static void vkMemoryDelete(std::shared_ptr<VulkanDevice> device, VkDeviceMemory memory) {
-            vkFreeMemory(device->getInternalLogicalDevice(), memory, nullptr);
+        void reallocate(std::shared_ptr<VulkanDevice> device, uint32_t newCapacity, VulkanDeletionQueue* deletionQueue) {
+            if(vertexBuffer != VK_NULL_HANDLE) {
+                if(deletionQueue == nullptr) {
+                    vkDeviceWaitIdle(device->getInternalLogicalDevice());
+                }
+
+                destroy(device, deletionQueue);
+            }
+
+            capacity = newCapacity;
+
+            if(capacity > 0) { //can't allocate empty buffer. trust me, i tried
+                create(device);
+            }
         }
 
-        static std::function<void(VkBuffer)> bufferDeleteFunction;
+        //the first sizeOfCurrentBuffer elements are carried over into a buffer with room for newCapacity
+        VkDeviceSize moveToNewBuffer(std::shared_ptr<VulkanDevice> device, uint32_t newCapacity, VulkanDeletionQueue* deletionQueue) {
+            VkBuffer oldBuffer = vertexBuffer;
+            VulkanMemoryAllocation oldBufferMemory = vertexBufferMemory;
+            void* oldBufferMap = bufferMap;
+
+            capacity = newCapacity;
 
-        static std::function<void(VkDeviceMemory)> memoryFreeFunction;
+            if(oldBuffer == VK_NULL_HANDLE) {
+                if(capacity > 0) {
+                    create(device);
+                }
 
-        static std::shared_ptr<DeleteThread<VkBuffer>> bufferDeleteThread;
+                return 0;
+            }
 
-        static std::shared_ptr<DeleteThread<VkDeviceMemory>> memoryDeleteThread;
-};
+            if(deletionQueue == nullptr) {
+                vkDeviceWaitIdle(device->getInternalLogicalDevice());
+            }
 
-template <class VertexType>
-bool VulkanVertexBuffer<VertexType>::createMemoryHandlers = true;
+            create(device);
 
-//set to nullptr for now to get rid of compile errors. so long as it isn't used before at least one VulkanVertexBuffer has create() called on it this is fine
-template <class VertexType>
-std::function<void(VkBuffer)> VulkanVertexBuffer<VertexType>::bufferDeleteFunction = nullptr;
+            VkDeviceSize size = sizeof(VertexType) * sizeOfCurrentBuffer;
 
-template <class VertexType>
-std::function<void(VkDeviceMemory)> VulkanVertexBuffer<VertexType>::memoryFreeFunction = nullptr;
+            if(oldBufferMap != nullptr && bufferMap != nullptr) {
+                std::memcpy(bufferMap, oldBufferMap, size);
+            }else {
+                device->getStagingRing()->moveBuffer(oldBuffer, vertexBuffer, size);
+            }
 
-template <class VertexType>
-std::shared_ptr<DeleteThread<VkBuffer>> VulkanVertexBuffer<VertexType>::bufferDeleteThread = nullptr; 
+            device->getStagingRing()->retargetUploads(oldBuffer, vertexBuffer);
 
-template <class VertexType>
-std::shared_ptr<DeleteThread<VkDeviceMemory>> VulkanVertexBuffer<VertexType>::memoryDeleteThread = nullptr;
+            if(deletionQueue == nullptr) {
+                //the copy out of the old buffer has to happen before it goes away
+                device->getStagingRing()->flushImmediately();
+            }
+
+            destroyBuffer(device, oldBuffer, oldBufferMemory, deletionQueue);
+
+            return size;
+        }
+
+        void writeVertices(std::shared_ptr<VulkanDevice> device, size_t first, const VertexType* data, size_t count) {
+            if(count == 0) {
+                return;
+            }
+
+            if(bufferMap == nullptr) {
+                //goes out with the next frame's upload batch
+                device->getStagingRing()->stage(vertexBuffer, sizeof(VertexType) * first, data, sizeof(VertexType) * count);
+            }else {
+                std::memcpy(static_cast<char*>(bufferMap) + sizeof(VertexType) * first, data, sizeof(VertexType) * count);
+            }
+        }
+
+        //captures the handle and the allocator instead of the device, which owns the queue
+        static void destroyBuffer(std::shared_ptr<VulkanDevice> device, VkBuffer buffer, VulkanMemoryAllocation memory, VulkanDeletionQueue* deletionQueue) {
+            VkDevice logicalDevice = device->getInternalLogicalDevice();
+            std::shared_ptr<VulkanMemoryAllocator> allocator = device->getMemoryAllocator();
+
+            if(deletionQueue == nullptr) {
+                vkDestroyBuffer(logicalDevice, buffer, nullptr);
+                allocator->free(memory);
+                return;
+            }
+
+            deletionQueue->retire([logicalDevice, allocator, buffer, memory]() {
+                vkDestroyBuffer(logicalDevice, buffer, nullptr);
+                allocator->free(memory);
+            });
+        }
+};
 
 #endif
\ No newline at end of file
@@ -2,77 +2,358 @@
 #define INSTANCEDRENDERINGMODEL_H
 
 #include "Engine/VulkanVertexBuffer.h"
-#include <map>
+#include "Engine/VulkanGeometryPool.h"
+#include "Engine/VulkanChunkCuller.h"
+#include "Engine/VulkanSlotMap.h"
+#include <unordered_map>
 
 #include "Vertex.h"
 
+using InstanceSetHandle = VulkanHandle<struct InstanceSetTag>;
+
 struct InstanceSetData {
+    //the name the set was created with and its handle in the model, for draw keys and memory tags
+    std::string id = "";
+
+    InstanceSetHandle handle;
+
     VulkanVertexBuffer<InstanceData> data;
+
+    //where the set lives in the instance pool, only used by pooled models
+    VulkanGeometryRange range;
+
+    //for cpu culling, always kept up to date since the instances may not be readable later
+    VulkanChunkBounds chunks;
+
+    std::vector<uint8_t> visibleChunks = std::vector<uint8_t>();
+
+    //what survived the last cpu culling, relative to the start of the set
+    std::vector<VulkanGeometryRange> visibleRanges = std::vector<VulkanGeometryRange>();
+
+    //the span beginInstanceWrite handed out, read back for the chunk bounds in finishInstanceWrite
+    std::span<InstanceData> writeSpan = std::span<InstanceData>();
 };
 
 
 template<typename VertexType>
 class InstancedRenderingModel {
     public:
-        InstancedRenderingModel(std::shared_ptr<VulkanDevice> _device, std::vector<VertexType>& _verts) {
+        InstancedRenderingModel(std::shared_ptr<VulkanDevice> _device, std::span<const VertexType> _verts, BUFFER_PLACEMENT modelPlacement = HOST_VISIBLE, BUFFER_PLACEMENT _instancePlacement = HOST_VISIBLE, bool _keepCPUCopies = true, std::string _ownerName = "") : model(modelPlacement), instancePlacement(_instancePlacement), keepCPUCopies(_keepCPUCopies), ownerName(_ownerName) {
+            model.setKeepCPUCopy(keepCPUCopies);
+            model.setMemoryTag(VulkanMemoryTag(CATEGORY_MODEL, ownerName));
+            calculateBounds(_verts, false);
             model.setVertexData(_device, _verts);
         }
 
-        void destroy(std::shared_ptr<VulkanDevice> _device, bool* shouldBeDestroyed) {
-            model.destroy(_device, shouldBeDestroyed);
+        InstancedRenderingModel(std::shared_ptr<VulkanDevice> _device, std::vector<VertexType>&& _verts, BUFFER_PLACEMENT modelPlacement = HOST_VISIBLE, BUFFER_PLACEMENT _instancePlacement = HOST_VISIBLE, bool _keepCPUCopies = true, std::string _ownerName = "") : model(modelPlacement), instancePlacement(_instancePlacement), keepCPUCopies(_keepCPUCopies), ownerName(_ownerName) {
+            model.setKeepCPUCopy(keepCPUCopies);
+            model.setMemoryTag(VulkanMemoryTag(CATEGORY_MODEL, ownerName));
+            calculateBounds(std::span<const VertexType>(_verts), false);
+            model.setVertexData(_device, std::move(_verts));
+        }
+
+        //pooled model: the vertices and every instance set get a range of modelPool / instancePool instead of a VkBuffer of their own
+        InstancedRenderingModel(std::shared_ptr<VulkanDevice> _device, std::span<const VertexType> _verts, std::shared_ptr<VulkanGeometryPool<VertexType>> _modelPool, std::shared_ptr<VulkanGeometryPool<InstanceData>> _instancePool, VulkanDeletionQueue* deletionQueue) : modelPool(_modelPool), instancePool(_instancePool) {
+            setModel(_device, _verts, deletionQueue);
+        }
 
-            for(std::pair<const std::string, InstanceSetData>& instanceData : instanceSets) {
-                instanceData.second.data.destroy(_device, shouldBeDestroyed);
+        void destroy(std::shared_ptr<VulkanDevice> _device, VulkanDeletionQueue* deletionQueue) {
+            if(isPooled()) {
+                modelPool->free(modelRange, deletionQueue);
+                modelRange = VulkanGeometryRange();
+            }else {
+                model.destroy(_device, deletionQueue);
+            }
+
+            for(InstanceSetData& instanceData : instanceSets.getValues()) {
+                destroyInstanceSet(_device, instanceData, deletionQueue);
             }
         }
 
-        void clearInstances(std::shared_ptr<VulkanDevice> _device, bool* shouldBeDestroyed) {
-            for(std::pair<const std::string, InstanceSetData>& instanceData : instanceSets) {
-                instanceData.second.data.destroy(_device, shouldBeDestroyed);
+        void clearInstances(std::shared_ptr<VulkanDevice> _device, VulkanDeletionQueue* deletionQueue) {
+            for(InstanceSetData& instanceData : instanceSets.getValues()) {
+                destroyInstanceSet(_device, instanceData, deletionQueue);
             }
             instanceSets.clear();
+            instanceSetHandles.clear();
+        }
+
+        bool isPooled() {
+            return modelPool != nullptr;
+        }
+
+        //draw with firstVertex = getModelRange().first, only meaningful for pooled models
+        VulkanGeometryRange getModelRange() {
+            return modelRange;
+        }
+
+        uint32_t getModelVertexCount() {
+            return (isPooled()) ? modelRange.count : model.getBufferSize();
+        }
+
+        //bounding box of the model's vertex positions, before the instance offset is added
+        glm::vec3 getBoundsMin() {
+            return boundsMin;
+        }
+
+        glm::vec3 getBoundsMax() {
+            return boundsMax;
         }
 
         VulkanVertexBuffer<VertexType>& getModel() {
             return model;
         }
 
-        std::map<std::string, InstanceSetData>& getInstanceSets() {
-            return instanceSets;
+        //packed, in no particular order
+        std::vector<InstanceSetData>& getInstanceSets() {
+            return instanceSets.getValues();
+        }
+
+        void setModel(std::shared_ptr<VulkanDevice> _device, std::span<const VertexType> mdl, VulkanDeletionQueue* deletionQueue = nullptr) {
+            calculateBounds(mdl, false);
+
+            if(isPooled()) {
+                resizeRange(_device, *modelPool, modelRange, mdl.size(), deletionQueue);
+                modelPool->write(_device, modelRange, 0, mdl);
+                return;
+            }
+
+            model.setVertexData(_device, mdl, deletionQueue);
+        }
+
+        void setModel(std::shared_ptr<VulkanDevice> _device, std::vector<VertexType>&& mdl, VulkanDeletionQueue* deletionQueue = nullptr) {
+            if(isPooled()) {
+                setModel(_device, std::span<const VertexType>(mdl), deletionQueue);
+                return;
+            }
+
+            calculateBounds(std::span<const VertexType>(mdl), false);
+            model.setVertexData(_device, std::move(mdl), deletionQueue);
+        }
+
+        //returns the existing set if there already is one called instanceVectorID
+        InstanceSetHandle createInstanceSet(const std::string& instanceVectorID) {
+            std::unordered_map<std::string, InstanceSetHandle>::iterator existing = instanceSetHandles.find(instanceVectorID);
+
+            if(existing != instanceSetHandles.end()) {
+                return existing->second;
+            }
+
+            InstanceSetData instanceSet;
+            instanceSet.id = instanceVectorID;
+            instanceSet.data.setPlacement(instancePlacement);
+            instanceSet.data.setKeepCPUCopy(keepCPUCopies);
+            instanceSet.data.setMemoryTag(VulkanMemoryTag(CATEGORY_INSTANCE_SET, ownerName + "/" + instanceVectorID));
+
+            InstanceSetHandle handle = instanceSets.insert(std::move(instanceSet));
+            instanceSets.at(handle).handle = handle;
+
+            instanceSetHandles[instanceVectorID] = handle;
+
+            return handle;
+        }
+
+        InstanceSetHandle addInstancesToModel(std::shared_ptr<VulkanDevice> _device, std::string instanceVectorID, std::span<const InstanceData> instances, VulkanDeletionQueue* deletionQueue = nullptr) {
+            InstanceSetHandle handle = createInstanceSet(instanceVectorID);
+            addInstancesToModel(_device, handle, instances, deletionQueue);
+            return handle;
         }
 
-        void setModel(std::shared_ptr<VulkanDevice> _device, std::vector<VertexType>& mdl) {
-            model.setVertexData(_device, mdl);
+        InstanceSetHandle addInstancesToModel(std::shared_ptr<VulkanDevice> _device, std::string instanceVectorID, std::vector<InstanceData>&& instances, VulkanDeletionQueue* deletionQueue = nullptr) {
+            InstanceSetHandle handle = createInstanceSet(instanceVectorID);
+            addInstancesToModel(_device, handle, std::move(instances), deletionQueue);
+            return handle;
         }
 
-        void addInstancesToModel(std::shared_ptr<VulkanDevice> _device, std::string instanceVectorID, std::vector<InstanceData>& instances) {
-            if(instanceSets.count(instanceVectorID) > 0) {
-                instanceSets[instanceVectorID].data.setVertexData(_device, instances);
+        void addInstancesToModel(std::shared_ptr<VulkanDevice> _device, InstanceSetHandle set, std::span<const InstanceData> instances, VulkanDeletionQueue* deletionQueue = nullptr) {
+            InstanceSetData& instanceSet = instanceSets.at(set);
+
+            instanceSet.chunks.calculate(instances);
+
+            if(isPooled()) {
+                resizeRange(_device, *instancePool, instanceSet.range, instances.size(), deletionQueue);
+                instancePool->write(_device, instanceSet.range, 0, instances);
+                return;
+            }
+
+            instanceSet.data.setVertexData(_device, instances, deletionQueue);
+        }
+
+        void addInstancesToModel(std::shared_ptr<VulkanDevice> _device, InstanceSetHandle set, std::vector<InstanceData>&& instances, VulkanDeletionQueue* deletionQueue = nullptr) {
+            if(isPooled()) {
+                addInstancesToModel(_device, set, std::span<const InstanceData>(instances), deletionQueue);
                 return;
             }
 
-            VulkanVertexBuffer<InstanceData> instanceBuffer = VulkanVertexBuffer<InstanceData>();
-            instanceBuffer.setVertexData(_device, instances);
+            InstanceSetData& instanceSet = instanceSets.at(set);
 
-            instanceSets[instanceVectorID].data = instanceBuffer;
+            //before the move, the instances are gone afterwards
+            instanceSet.chunks.calculate(instances);
+            instanceSet.data.setVertexData(_device, std::move(instances), deletionQueue);
         }
 
-        void removeInstancesFromModel(std::shared_ptr<VulkanDevice> _device, std::string instanceVectorID, bool* shouldBeDestroyed) {
-            instanceSets.at(instanceVectorID).data.destroy(_device, shouldBeDestroyed);
-            instanceSets.erase(instanceVectorID);
+        //fills an instance set in place, see VulkanVertexBuffer::beginWrite
+        std::span<InstanceData> beginInstanceWrite(std::shared_ptr<VulkanDevice> _device, std::string instanceVectorID, uint32_t count, VulkanDeletionQueue* deletionQueue = nullptr) {
+            return beginInstanceWrite(_device, createInstanceSet(instanceVectorID), count, deletionQueue);
         }
 
-        VulkanVertexBuffer<InstanceData>& getInstanceSet(std::string set) {
+        std::span<InstanceData> beginInstanceWrite(std::shared_ptr<VulkanDevice> _device, InstanceSetHandle set, uint32_t count, VulkanDeletionQueue* deletionQueue = nullptr) {
+            InstanceSetData& instanceSet = instanceSets.at(set);
+
+            if(isPooled()) {
+                resizeRange(_device, *instancePool, instanceSet.range, count, deletionQueue);
+                instanceSet.writeSpan = instancePool->beginWrite(_device, instanceSet.range);
+            }else {
+                instanceSet.writeSpan = instanceSet.data.beginWrite(_device, count, deletionQueue);
+            }
+
+            return instanceSet.writeSpan;
+        }
+
+        void finishInstanceWrite(std::shared_ptr<VulkanDevice> _device, InstanceSetHandle set) {
+            InstanceSetData& instanceSet = instanceSets.at(set);
+
+            instanceSet.chunks.calculate(instanceSet.writeSpan);
+            instanceSet.writeSpan = std::span<InstanceData>();
+
+            //pool writes never go through a cpu copy, so there's nothing left to upload
+            if(isPooled()) {
+                return;
+            }
+
+            instanceSet.data.finishWrite(_device);
+        }
+
+        void updateInstanceRange(std::shared_ptr<VulkanDevice> _device, InstanceSetHandle set, uint32_t offset, std::span<const InstanceData> instances) {
+            InstanceSetData& instanceSet = instanceSets.at(set);
+
+            instanceSet.chunks.grow(offset, instances);
+
+            if(isPooled()) {
+                instancePool->write(_device, instanceSet.range, offset, instances);
+                return;
+            }
+
+            instanceSet.data.updateVertexRange(_device, offset, instances);
+        }
+
+        void updateModelRange(std::shared_ptr<VulkanDevice> _device, uint32_t offset, std::span<const VertexType> vertices) {
+            //the replaced vertices aren't known anymore, so the box can only grow
+            calculateBounds(vertices, true);
+
+            if(isPooled()) {
+                modelPool->write(_device, modelRange, offset, vertices);
+                return;
+            }
+
+            model.updateVertexRange(_device, offset, vertices);
+        }
+
+        void removeInstancesFromModel(std::shared_ptr<VulkanDevice> _device, InstanceSetHandle set, VulkanDeletionQueue* deletionQueue) {
+            InstanceSetData& instanceSet = instanceSets.at(set);
+
+            destroyInstanceSet(_device, instanceSet, deletionQueue);
+
+            instanceSetHandles.erase(instanceSet.id);
+            instanceSets.erase(set);
+        }
+
+        VulkanVertexBuffer<InstanceData>& getInstanceSet(InstanceSetHandle set) {
             return instanceSets.at(set).data;
         }
 
-        bool hasInstanceSet(std::string set) {
-            return (instanceSets.count(set) != 0);
+        //a null handle if there's no set called instanceVectorID
+        InstanceSetHandle getInstanceSetHandle(const std::string& instanceVectorID) {
+            std::unordered_map<std::string, InstanceSetHandle>::iterator handle = instanceSetHandles.find(instanceVectorID);
+
+            return (handle != instanceSetHandles.end()) ? handle->second : InstanceSetHandle();
+        }
+
+        //drops the cpu side copies of the model and every instance set, and stops new sets from keeping one
+        void setKeepCPUCopies(bool keep) {
+            keepCPUCopies = keep;
+
+            model.setKeepCPUCopy(keepCPUCopies);
+
+            for(InstanceSetData& instanceData : instanceSets.getValues()) {
+                instanceData.data.setKeepCPUCopy(keepCPUCopies);
+            }
+        }
+
+        bool hasInstanceSet(InstanceSetHandle set) {
+            return instanceSets.contains(set);
+        }
+
+        bool hasInstanceSet(const std::string& set) {
+            return instanceSetHandles.count(set) != 0;
+        }
+
+        //only applies to instance sets added after this is called
+        void setInstancePlacement(BUFFER_PLACEMENT placement) {
+            instancePlacement = placement;
         }
 
     private:
         VulkanVertexBuffer<VertexType> model;
-        std::map<std::string, InstanceSetData> instanceSets;
+        VulkanSlotMap<InstanceSetData, InstanceSetHandle> instanceSets;
+
+        //the names only matter when a set is created or looked up by name, everything else goes through handles
+        std::unordered_map<std::string, InstanceSetHandle> instanceSetHandles = std::unordered_map<std::string, InstanceSetHandle>();
+        BUFFER_PLACEMENT instancePlacement = HOST_VISIBLE;
+        bool keepCPUCopies = true;
+
+        //memory of the model is booked under this name, instance sets under "ownerName/instanceVectorID"
+        std::string ownerName = "";
+
+        std::shared_ptr<VulkanGeometryPool<VertexType>> modelPool = nullptr;
+
+        std::shared_ptr<VulkanGeometryPool<InstanceData>> instancePool = nullptr;
+
+        VulkanGeometryRange modelRange;
+
+        glm::vec3 boundsMin = glm::vec3(0);
+
+        glm::vec3 boundsMax = glm::vec3(0);
+
+        void calculateBounds(std::span<const VertexType> vertices, bool grow) {
+            if(vertices.empty()) {
+                if(!grow) {
+                    boundsMin = glm::vec3(0);
+                    boundsMax = glm::vec3(0);
+                }
+                return;
+            }
+
+            if(!grow) {
+                boundsMin = vertices[0].position;
+                boundsMax = vertices[0].position;
+            }
+
+            for(const VertexType& vertex : vertices) {
+                boundsMin = glm::min(boundsMin, vertex.position);
+                boundsMax = glm::max(boundsMax, vertex.position);
+            }
+        }
+
+        //a range that keeps its size is rewritten in place, like a VulkanVertexBuffer that doesn't need to be reallocated
+        template<typename PoolType>
+        static void resizeRange(std::shared_ptr<VulkanDevice> _device, VulkanGeometryPool<PoolType>& pool, VulkanGeometryRange& range, uint32_t count, VulkanDeletionQueue* deletionQueue) {
+            if(range.count == count) {
+                return;
+            }
+
+            pool.free(range, deletionQueue);
+            range = pool.allocate(_device, count, deletionQueue);
+        }
+
+        void destroyInstanceSet(std::shared_ptr<VulkanDevice> _device, InstanceSetData& instanceSet, VulkanDeletionQueue* deletionQueue) {
+            if(isPooled()) {
+                instancePool->free(instanceSet.range, deletionQueue);
+                instanceSet.range = VulkanGeometryRange();
+            }else {
+                instanceSet.data.destroy(_device, deletionQueue);
+            }
+        }
 };
 
 #endif
\ No newline at end of file
@@ -6,15 +6,14 @@
 #include "Engine/VulkanInclude.h"
 
 struct UniformBuffer {
-    alignas(16) glm::mat4x4 modelMatrix;
-    alignas(16) glm::mat4x4 viewMatrix;
-    alignas(16) glm::mat4x4 projectionMatrix;
+    //projection * view * model, multiplied once on the cpu instead of for every vertex
+    alignas(16) glm::mat4x4 viewProjection;
     alignas(16) glm::vec3 tint;
     
     static VkDescriptorSetLayoutBinding getDescriptorSetLayout() {
         VkDescriptorSetLayoutBinding uboLayoutBinding{};
         uboLayoutBinding.binding = 0;
-        uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC; //lives in VKRenderer's uniform ring
         uboLayoutBinding.descriptorCount = 1;
         uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
         uboLayoutBinding.pImmutableSamplers = nullptr;
@@ -12,15 +12,51 @@
 #include "CompositeVertex.h"
 
 #include "VulkanVertexBuffer.h"
-#include "VulkanUniformBuffer.h"
+#include "VulkanGeometryPool.h"
+#include "VulkanIndirectDrawList.h"
+#include "VulkanInstanceCuller.h"
+#include "VulkanChunkCuller.h"
+#include "VulkanUniformRing.h"
+#include "VulkanParallelRecorder.h"
+#include "VulkanDrawList.h"
+#include "VulkanSlotMap.h"
+#include "VulkanGpuProfiler.h"
 
 #include "UniformBuffer.h"
 #include "OverlayUniformBuffer.h"
+#include "DrawPushConstants.h"
 
 #include <map>
+#include <unordered_map>
 
 #include "InstancedRenderingModel.h"
 
+//typed handles into the model registries, see VulkanSlotMap. instance sets are addressed with an InstanceSetHandle relative to their model
+using ModelHandle = VulkanHandle<struct ModelTag>;
+
+using WireframeModelHandle = VulkanHandle<struct WireframeModelTag>;
+
+//a model set through setModel. both halves always exist, share the handle and get the same instance sets, so set handles are valid for both
+struct ModelData {
+    std::string id;
+
+    InstancedRenderingModel<Vertex> opaque;
+
+    InstancedRenderingModel<TransparentVertex> transparent;
+
+    //pushed before the draws of both halves
+    DrawPushConstants drawParameters;
+};
+
+struct WireframeModelData {
+    std::string id;
+
+    InstancedRenderingModel<WireframeVertex> model;
+
+    //the wireframe shader only reads modelOffset
+    DrawPushConstants drawParameters;
+};
+
 class VKRenderer {
     public:
         VKRenderer(std::shared_ptr<VulkanEngine> engine);
@@ -33,12 +69,41 @@ class VKRenderer {
 
         void setCameraFar(float f);
 
+        /*
+        records the secondaries of every image whose recording is older than the current scene generation, waiting for each of them. renderFrame
+        records the image it acquires by itself, this is only needed to get all of them done up front
+        */
         void recordCommandBuffers();
 
+        /*
+        each pass is split into jobs of modelsPerJob draws (or overlays) that get recorded into secondary command buffers on threadCount threads
+        (including the calling one). 0 threads picks one per core, up to 8
+        */
+        void setRecordingThreads(uint32_t threadCount, size_t modelsPerJob = 256);
+
+        uint32_t getRecordingThreadCount();
+
         void renderFrame();
 
+        //the binds recorded into the command buffer the last renderFrame submitted, and the ones the sorted draw list left out
+        VulkanBindCounts getFrameBindCounts();
+
+        //min / avg / p99 / max time of every phase of the last VulkanFrameTimer::WINDOW_SIZE frames, on the cpu and (with gpu profiling) the gpu
+        VulkanFrameStats getFrameStats();
+
+        //gpu time of each model's draws in the last frame that was read back, in milliseconds. empty unless per model gpu profiling is on
+        std::map<std::string, double> getModelGpuTimes();
+
         //general rendering/settings
 
+        /*
+        bumps the scene generation so every image's secondaries get re-recorded the next time they are used. all the functions here that change
+        what gets drawn already call this, it's only needed after changing things behind the renderer's back through getEngine()
+        */
+        void invalidateCommandBuffers();
+
+        uint64_t getSceneGeneration();
+
         void clearAllInstances();
 
         void setClearColor(glm::vec4 rgba);
@@ -55,36 +120,182 @@ class VKRenderer {
 
         //for 3d rendering (opaque / transparent)
 
-        void setModel(std::string modelID, std::vector<Vertex> modelVerticesOpaque = {}, std::vector<TransparentVertex> modelVerticesTransparent = {});
+        /*
+        the handle overloads are the fast path: a handle lookup is an index and a generation check, no string gets copied or compared. the string
+        overloads only translate the names to handles and stay for compatibility. handles stop resolving once their model or set is removed
+        */
+
+        ModelHandle setModel(std::string modelID, std::vector<Vertex> modelVerticesOpaque = {}, std::vector<TransparentVertex> modelVerticesTransparent = {});
+
+        void setModel(ModelHandle model, std::vector<Vertex> modelVerticesOpaque, std::vector<TransparentVertex> modelVerticesTransparent = {});
+
+        //a null handle if modelID hasn't been set
+        ModelHandle getModelHandle(std::string modelID);
+
+        //a null handle if the model has no set called instanceVectorID
+        InstanceSetHandle getInstanceSetHandle(ModelHandle model, std::string instanceVectorID);
 
         void removeModel(std::string modelID);
 
-        void addInstancesToModel(std::string modelID, std::string instanceVectorID, std::vector<InstanceData>& instances);
+        void removeModel(ModelHandle model);
+
+        InstanceSetHandle addInstancesToModel(std::string modelID, std::string instanceVectorID, std::span<const InstanceData> instances);
+
+        InstanceSetHandle addInstancesToModel(std::string modelID, std::string instanceVectorID, std::vector<InstanceData>&& instances);
+
+        //creates the set if the model doesn't have one called instanceVectorID yet
+        InstanceSetHandle addInstancesToModel(ModelHandle model, std::string instanceVectorID, std::span<const InstanceData> instances);
+
+        InstanceSetHandle addInstancesToModel(ModelHandle model, std::string instanceVectorID, std::vector<InstanceData>&& instances);
+
+        void addInstancesToModel(ModelHandle model, InstanceSetHandle set, std::span<const InstanceData> instances);
+
+        void addInstancesToModel(ModelHandle model, InstanceSetHandle set, std::vector<InstanceData>&& instances);
+
+        //resizes the set to count instances and returns memory to write them into directly. call finishInstanceWrite before touching any other geometry
+        std::span<InstanceData> beginInstanceWrite(std::string modelID, std::string instanceVectorID, uint32_t count);
+
+        std::span<InstanceData> beginInstanceWrite(ModelHandle model, InstanceSetHandle set, uint32_t count);
+
+        void finishInstanceWrite(std::string modelID, std::string instanceVectorID);
+
+        void finishInstanceWrite(ModelHandle model, InstanceSetHandle set);
+
+        /*
+        only rewrites instances [offset, offset + instances.size()) of an existing set, the set keeps its size. the recorded command buffers stay valid
+        unless cpu culling is on, then the set is culled again on the next recording since the instances may have moved into view
+        */
+        void updateInstanceRange(std::string modelID, std::string instanceVectorID, uint32_t offset, std::span<const InstanceData> instances);
+
+        void updateInstanceRange(ModelHandle model, InstanceSetHandle set, uint32_t offset, std::span<const InstanceData> instances);
+
+        //like updateInstanceRange, re-culls on the next recording when cpu culling is on since the model's bounds may have grown
+        void updateModelRange(std::string modelID, uint32_t offset, std::span<const Vertex> modelVerticesOpaque);
+
+        void updateModelRange(ModelHandle model, uint32_t offset, std::span<const Vertex> modelVerticesOpaque);
+
+        void updateModelRange(std::string modelID, uint32_t offset, std::span<const TransparentVertex> modelVerticesTransparent);
+
+        void updateModelRange(ModelHandle model, uint32_t offset, std::span<const TransparentVertex> modelVerticesTransparent);
+
+        //pushed before the model's draws, so changing them doesn't touch any buffer. indirect drawing has one draw per pass and ignores them
+        void setModelDrawParameters(std::string modelID, DrawPushConstants parameters);
+
+        void setModelDrawParameters(ModelHandle model, DrawPushConstants parameters);
 
         void removeInstancesFromModel(std::string modelID, std::string instanceVectorID);
 
+        void removeInstancesFromModel(ModelHandle model, InstanceSetHandle set);
+
         void removeInstancesFromModelSafe(std::string modelID, std::string instanceVectorID);
 
         bool hasInstanceInModel(std::string modelID, std::string instanceVectorID);
 
+        bool hasInstanceInModel(ModelHandle model, InstanceSetHandle set);
+
         bool hasModel(std::string id);
 
+        bool hasModel(ModelHandle model);
+
+        //where models / instance sets created after this call keep their vertex data. DEVICE_LOCAL is faster to draw but every update goes through a staging copy
+        void setGeometryPlacement(BUFFER_PLACEMENT modelPlacement, BUFFER_PLACEMENT instancePlacement);
+
+        //whether vertex buffers keep a cpu side copy of their data. off means geometry only lives on the gpu, applies to existing models too
+        void setKeepCPUCopies(bool keep);
+
+        /*
+        puts all model vertices into one shared buffer per vertex type and all instance sets into another, so every pass binds its vertex buffers once
+        and draws with offsets. uses the placement from setGeometryPlacement and never keeps cpu copies. can only be changed before any model is set
+        */
+        void setGeometryPooling(bool enabled);
+
+        /*
+        draws every pass from a VkDrawIndirectCommand buffer with one command per (model, instance set), so the number of draw calls recorded no
+        longer grows with the number of sets. the buffers are updated slot by slot as sets change. needs geometry pooling and drawIndirectFirstInstance
+        */
+        void setIndirectDrawing(bool enabled);
+
+        /*
+        frustum culls every instance in a compute pass before the render pass and draws only the visible ones, so vertex work scales with what is on
+        screen instead of with the scene. needs indirect drawing
+        */
+        void setGpuCulling(bool enabled);
+
+        /*
+        frustum culls instance sets on the cpu in chunks of VulkanChunkCuller::CHUNK_SIZE instances and only draws the visible chunk ranges. for
+        devices where the compute pass isn't an option, so it can't be combined with indirect drawing. command buffers get re-recorded whenever the
+        camera moves
+        */
+        void setCpuCulling(bool enabled);
+
+        //background compaction of sparse memory pages. each frame (and recordCommandBuffers) moves buffers out of them for up to budgetMilliseconds
+        void setDefragmentation(bool enabled, double budgetMilliseconds = 0.5);
+
+        /*
+        how many frames the cpu may record ahead of the gpu. 1 keeps input latency lowest, 3 lets the cpu and gpu overlap the most. waits for the
+        device to go idle and recreates the per frame sync objects and command pools, so it's fine to call between any two frames
+        */
+        void setFramesInFlight(int framesInFlight);
+
+        int getFramesInFlight();
+
+        /*
+        writes gpu timestamps between the parts of every frame, which show up as the PHASE_GPU_* phases of getFrameStats once the frame has finished.
+        perModel additionally times each model's draws, only without indirect drawing, where draws aren't per model. needs timestamp support
+        */
+        void setGpuProfiling(bool enabled, bool perModel = false);
+
         //for wireframe rendering
 
-        void setWireframeModel(std::string modelID, std::vector<WireframeVertex> modelVertices);
+        WireframeModelHandle setWireframeModel(std::string modelID, std::vector<WireframeVertex> modelVertices);
+
+        void setWireframeModel(WireframeModelHandle model, std::vector<WireframeVertex> modelVertices);
+
+        WireframeModelHandle getWireframeModelHandle(std::string modelID);
+
+        InstanceSetHandle getWireframeInstanceSetHandle(WireframeModelHandle model, std::string instanceVectorID);
 
         void removeWireframeModel(std::string modelID);
 
-        void addInstancesToWireframeModel(std::string modelID, std::string instanceVectorID, std::vector<InstanceData>& instances);
+        void removeWireframeModel(WireframeModelHandle model);
+
+        InstanceSetHandle addInstancesToWireframeModel(std::string modelID, std::string instanceVectorID, std::span<const InstanceData> instances);
+
+        InstanceSetHandle addInstancesToWireframeModel(std::string modelID, std::string instanceVectorID, std::vector<InstanceData>&& instances);
+
+        InstanceSetHandle addInstancesToWireframeModel(WireframeModelHandle model, std::string instanceVectorID, std::span<const InstanceData> instances);
+
+        InstanceSetHandle addInstancesToWireframeModel(WireframeModelHandle model, std::string instanceVectorID, std::vector<InstanceData>&& instances);
+
+        void addInstancesToWireframeModel(WireframeModelHandle model, InstanceSetHandle set, std::span<const InstanceData> instances);
+
+        //same as updateInstanceRange / updateModelRange, including the re-cull with cpu culling on
+        void updateWireframeInstanceRange(std::string modelID, std::string instanceVectorID, uint32_t offset, std::span<const InstanceData> instances);
+
+        void updateWireframeInstanceRange(WireframeModelHandle model, InstanceSetHandle set, uint32_t offset, std::span<const InstanceData> instances);
+
+        void updateWireframeModelRange(std::string modelID, uint32_t offset, std::span<const WireframeVertex> modelVertices);
+
+        void updateWireframeModelRange(WireframeModelHandle model, uint32_t offset, std::span<const WireframeVertex> modelVertices);
+
+        void setWireframeModelDrawParameters(std::string modelID, DrawPushConstants parameters);
+
+        void setWireframeModelDrawParameters(WireframeModelHandle model, DrawPushConstants parameters);
 
         void removeInstancesFromWireframeModel(std::string modelID, std::string instanceVectorID);
 
+        void removeInstancesFromWireframeModel(WireframeModelHandle model, InstanceSetHandle set);
+
         bool hasInstanceInWireframeModel(std::string modelID, std::string instanceVectorID);
 
+        bool hasInstanceInWireframeModel(WireframeModelHandle model, InstanceSetHandle set);
+
         void setWireframeTopology(VkPrimitiveTopology topology);
 
         bool hasWireframeModel(std::string id);
 
+        bool hasWireframeModel(WireframeModelHandle model);
+
         //for overlay rendering
 
         void clearAllOverlays();
@@ -109,11 +320,14 @@ class VKRenderer {
 
         std::shared_ptr<VulkanEngine> getEngine();
 
-        //for managing overlay textures
+        //for managing overlay textures. the pixels are uploaded in the background, the returned token says when they are on the gpu
 
-        void addTexture(std::string id, std::string texturePath);
+        VulkanUploadToken addTexture(std::string id, std::string texturePath);
         
-        void addTextTexture(std::string id, std::string text, glm::vec3 color = glm::vec3(255, 0, 0));
+        VulkanUploadToken addTextTexture(std::string id, std::string text, glm::vec3 color = glm::vec3(255, 0, 0));
+
+        //never blocks
+        bool isUploadComplete(VulkanUploadToken token);
 
         void removeTexture(std::string id);
 
@@ -123,7 +337,7 @@ class VKRenderer {
 
         //for managing array textures (3d world textures)
 
-        void loadTextureArray(std::string id, std::vector<std::string> textures);
+        VulkanUploadToken loadTextureArray(std::string id, std::vector<std::string> textures);
 
         void setCurrentTextureArray(std::string id);
 
@@ -139,6 +353,9 @@ class VKRenderer {
 
         static glm::mat4x4 createViewMatrix(glm::vec3 camera, float xRotation, float yRotation);
 
+        //fov in degrees, with the 0 to 1 depth range the pipelines use
+        static glm::mat4x4 createProjectionMatrix(float fov, float aspectRatio, float near, float far);
+
     private:
         void createGraphicsPipelines();
 
@@ -150,29 +367,202 @@ class VKRenderer {
 
         void updateUniformBuffer(uint32_t imageIndex);
 
-        void removeFrameFromDeleteRequirements(size_t frame);
+        //projection * view of the current camera, what the shaders see with the identity model matrix
+        glm::mat4x4 getViewProjection();
 
-        std::vector<int> getCopyOfFFVWithExtraFrame();
+        //splits every instance set into tasks for the recording threads and turns the results into each set's visibleRanges
+        void cullInstanceSets();
+
+        uint32_t getBlockUniformOffset(uint32_t imageIndex);
+
+        uint32_t getOverlayUniformOffset(uint32_t imageIndex);
+
+        //where everything the current frame replaces or removes waits until the gpu is done with it
+        VulkanDeletionQueue* getDeletionQueue();
+
+        void defragmentStep();
+
+        void createParallelRecorder();
+
+        //per call of recordCommandBuffers / renderFrame: defragmentation, recreating what depends on the image count, stale cpu culling
+        void prepareRecording();
+
+        //per scene generation, shared by every image
+        void prepareScene();
+
+        //records imageIndex's secondaries, the last frame that used them has to be finished
+        void recordImage(uint32_t imageIndex);
+
+        //re-records the current frame's primary to run imageIndex's secondaries, recording them first if they are stale
+        VkCommandBuffer recordFrameCommandBuffer(uint32_t imageIndex);
+
+        std::vector<VkClearValue> getClearValues();
+
+        void createInstanceCuller();
+
+        void createGpuProfiler();
+
+        //reads the timestamps of the last frame that rendered to imageIndex, whose fence has to have been waited on
+        void readGpuTimestamps(uint32_t imageIndex);
+
+        //brings the indirect commands of every instance set of the model up to date with where its model and instances live in the pools
+        void refreshIndirectDraws(ModelHandle model);
+
+        void refreshWireframeIndirectDraws(WireframeModelHandle model);
+
+        //the handle of modelID, throws with action ("set instances for", ...) in the message if there is none
+        ModelHandle requireModelHandle(const std::string& modelID, const std::string& action);
+
+        WireframeModelHandle requireWireframeModelHandle(const std::string& modelID, const std::string& action);
+
+        //the set on both halves of the model, created on both if needed
+        InstanceSetHandle getOrCreateInstanceSet(ModelData& model, const std::string& instanceVectorID);
 
         std::shared_ptr<VulkanEngine> vkEngine;
 
         size_t currentFrame = 0;
 
-        std::map<std::string, InstancedRenderingModel<Vertex>> idToInstancedModels;
+        //starts at 1 so images that were never recorded (generation 0) are always stale
+        uint64_t sceneGeneration = 1;
+
+        //what recordImage left for the frames that render to an image, the primary itself is recorded again every frame
+        struct RecordedImage {
+            uint64_t sceneGeneration = 0;
+
+            std::vector<VkCommandBuffer> secondaries = std::vector<VkCommandBuffer>();
+
+            size_t firstTransparentJob = 0;
+
+            size_t firstOverlayJob = 0;
+
+            VulkanBindCounts bindCounts;
+
+            //the draw runs timed by the secondaries, with the result of the last read
+            struct TimedDrawRun {
+                std::string modelID;
+                uint32_t beginQuery = 0;
+                double milliseconds = 0;
+            };
+
+            std::vector<TimedDrawRun> timedDrawRuns = std::vector<TimedDrawRun>();
+        };
+
+        std::vector<RecordedImage> recordedImages = std::vector<RecordedImage>();
+
+        //the scene generation the draw list, overlay list and cpu culling results were built for
+        uint64_t preparedSceneGeneration = 0;
+
+        std::vector<VulkanVertexBuffer<OverlayVertex>*> preparedOverlays = std::vector<VulkanVertexBuffer<OverlayVertex>*>();
+
+        VulkanBindCounts frameBindCounts;
+
+        //the upload semaphores the frame recorded last has to wait on, filled by recordFrameCommandBuffer
+        std::vector<VkSemaphore> uploadWaitSemaphores = std::vector<VkSemaphore>();
+
+        std::vector<VkPipelineStageFlags> uploadWaitStages = std::vector<VkPipelineStageFlags>();
+
+        //the non-indirect draws, rebuilt once per scene generation
+        VulkanDrawList drawList;
+
+        //the model of each timing group of drawList, opaque and transparent models first and wireframe models after them
+        std::vector<std::string> drawTimingModelIDs = std::vector<std::string>();
+
+        std::shared_ptr<VulkanParallelRecorder> parallelRecorder = std::make_shared<VulkanParallelRecorder>();
+
+        //0 means one per core
+        uint32_t recordingThreadCount = 0;
 
-        std::map<std::string, InstancedRenderingModel<WireframeVertex>> idToWFInstancedModels;
+        size_t modelsPerRecordJob = 256;
 
-        std::map<std::string, InstancedRenderingModel<TransparentVertex>> idToTransparentInstancedModels;
+        //packed, so recording walks them linearly
+        VulkanSlotMap<ModelData, ModelHandle> models;
+
+        VulkanSlotMap<WireframeModelData, WireframeModelHandle> wireframeModels;
+
+        //the string api's view of the registries
+        std::unordered_map<std::string, ModelHandle> modelHandles = std::unordered_map<std::string, ModelHandle>();
+
+        std::unordered_map<std::string, WireframeModelHandle> wireframeModelHandles = std::unordered_map<std::string, WireframeModelHandle>();
 
         std::map<std::string, VulkanVertexBuffer<OverlayVertex>> dataIDToVertexOverlayData;
 
-        std::vector<VulkanUniformBuffer<UniformBuffer>> blockUniformBuffers;
+        //one region per swapchain image holding the UniformBuffer, the OverlayUniformBuffer and room for per draw data
+        VulkanUniformRing uniformRing;
 
-        std::vector<VulkanUniformBuffer<OverlayUniformBuffer>> overlayUniformBuffers;
+        VkDeviceSize perDrawUniformBytes = 64 * 1024;
 
         std::map<std::string, std::map<std::string, unsigned int> > texureArrayTexturesToIDs;
 
-        VulkanVertexBuffer<CompositeVertex> compositeBuffer;
+        VulkanVertexBuffer<CompositeVertex> compositeBuffer = VulkanVertexBuffer<CompositeVertex>(DEVICE_LOCAL);
+
+        BUFFER_PLACEMENT modelPlacement = DEVICE_LOCAL;
+
+        BUFFER_PLACEMENT instancePlacement = DEVICE_LOCAL;
+
+        bool keepCPUCopies = true;
+
+        bool geometryPooling = false;
+
+        std::shared_ptr<VulkanGeometryPool<Vertex>> vertexPool = nullptr;
+
+        std::shared_ptr<VulkanGeometryPool<WireframeVertex>> wireframeVertexPool = nullptr;
+
+        std::shared_ptr<VulkanGeometryPool<TransparentVertex>> transparentVertexPool = nullptr;
+
+        //shared by the opaque, transparent and wireframe models
+        std::shared_ptr<VulkanGeometryPool<InstanceData>> instancePool = nullptr;
+
+        bool indirectDrawing = false;
+
+        //the transparent list is used by both the transparent-opaque and the accumulation pass
+        VulkanIndirectDrawList opaqueDrawList;
+
+        VulkanIndirectDrawList wireframeDrawList;
+
+        VulkanIndirectDrawList transparentDrawList;
+
+        bool gpuCulling = false;
+
+        std::shared_ptr<VulkanInstanceCuller> instanceCuller = std::make_shared<VulkanInstanceCuller>();
+
+        bool cpuCulling = false;
+
+        bool gpuProfiling = false;
+
+        bool modelGpuProfiling = false;
+
+        std::shared_ptr<VulkanGpuProfiler> gpuProfiler = std::make_shared<VulkanGpuProfiler>();
+
+        //runs past this aren't timed
+        uint32_t maxTimedDrawRuns = 512;
+
+        //the image getModelGpuTimes reports, the last one that was read back
+        size_t lastProfiledImage = 0;
+
+        //the view projection the recorded command buffers were culled with
+        glm::mat4x4 culledViewProjection = glm::mat4x4(0.0f);
+
+        //how many chunks one culling task tests, big sets get split over several tasks
+        uint32_t chunksPerCullingTask = 512;
+
+        //which side of a model beginInstanceWrite wrote into, the other side gets a copy in finishInstanceWrite
+        bool instanceWriteToTransparent = false;
+
+        std::span<InstanceData> instanceWriteSpan = std::span<InstanceData>();
+
+        bool defragmentationEnabled = true;
+
+        double defragmentationBudgetMilliseconds = 0.5;
+
+        //pages less full than this get evacuated
+        float defragmentationMaxOccupancy = 0.5f;
+
+        //how often to look for pages worth evacuating while no pass is running, in frames
+        uint32_t defragmentationCheckInterval = 300;
+
+        uint32_t framesSinceDefragmentationCheck = 0;
+
+        uint32_t framesSinceLastRelocation = 0;
 
         //in degrees
         float xRotation = 0;
@@ -194,12 +584,6 @@ class VKRenderer {
 
         glm::vec4 clearColor = glm::vec4(0, 0, 0, 1);
 
-        std::vector<int> fullFrameVector; 
-
-        std::map<int, std::pair<std::vector<int>, bool*> > canObjectBeDestroyedMap = std::map<int, std::pair<std::vector<int>, bool*> >();
-        
-        int mapCounter = 0;
-
         float near = 0.01f;
         float far = 100.0f;
 
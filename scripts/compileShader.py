@@ -0,0 +1,49 @@
+#! /usr/bin/env python3
+import os
+import subprocess
+from executeCommand import execCmd
+from platform import system
+import sys
+
+#single stage version of compileShaderPair.py, for compute shaders
+
+GLSLC_PATH = ""
+if system() == "Darwin":
+    GLSLC_PATH='./VulkanSDKMacOS/macOS/bin/glslc'
+if system() == "Linux":
+    GLSLC_PATH='./VulkanSDKLinux/x86_64/bin/glslc'
+if system() == "Windows":
+    GLSLC_PATH='./VulkanSDKWindows/'
+
+nextArgIsInput = False
+nextArgIsOutput = False
+
+shaderInput = ''
+shaderOutput = ''
+
+for i, arg in enumerate(sys.argv):
+    if i == 0:
+        continue
+    if(arg == '-i'):
+        nextArgIsInput = True
+        nextArgIsOutput = False
+    elif(arg == '-o'):
+        nextArgIsInput = False
+        nextArgIsOutput = True
+    else:
+        if(nextArgIsInput):
+            shaderInput = arg
+        elif(nextArgIsOutput):
+            shaderOutput = arg
+        else:
+            print('you passed an invalid argument, ' + arg + ', ignoring it')
+
+        nextArgIsInput = False
+        nextArgIsOutput = False
+
+if(shaderInput == ''):
+    print('shaderInput not set, exiting\nnote: shaderInput can be set with -i')
+if(shaderOutput == ''):
+    print('shaderOutput not set, exiting\nnote: shaderOutput can be set with -o')
+
+output, error = execCmd(GLSLC_PATH + ' ' + shaderInput + ' -o ' + shaderOutput)
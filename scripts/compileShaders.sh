@@ -7,4 +7,5 @@ python scripts/compileShaderPair.py -v shaders/src/3dshader_instanced_wireframe.
 python scripts/compileShaderPair.py -v shaders/src/overlay.vert -f shaders/src/overlay.frag -vo shaders/output/vert_overlay.spv -fo shaders/output/frag_overlay.spv
 python scripts/compileShaderPair.py -v shaders/src/3dshader_transparent_subpass1.vert -f shaders/src/3dshader_transparent_subpass1.frag -vo shaders/output/3dvert_transparent_subpass1.spv -fo shaders/output/3dfrag_transparent_subpass1.spv
 python scripts/compileShaderPair.py -v shaders/src/3dshader_transparent_subpass2.vert -f shaders/src/3dshader_transparent_subpass2.frag -vo shaders/output/3dvert_transparent_subpass2.spv -fo shaders/output/3dfrag_transparent_subpass2.spv
-python scripts/compileShaderPair.py -v shaders/src/3dshader_transparent_subpass3.vert -f shaders/src/3dshader_transparent_subpass3.frag -vo shaders/output/3dvert_transparent_subpass3.spv -fo shaders/output/3dfrag_transparent_subpass3.spv
\ No newline at end of file
+python scripts/compileShaderPair.py -v shaders/src/3dshader_transparent_subpass3.vert -f shaders/src/3dshader_transparent_subpass3.frag -vo shaders/output/3dvert_transparent_subpass3.spv -fo shaders/output/3dfrag_transparent_subpass3.spv
+python scripts/compileShader.py -i shaders/src/cull_instances.comp -o shaders/output/comp_cull_instances.spv
\ No newline at end of file
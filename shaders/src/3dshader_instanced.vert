@@ -1,9 +1,7 @@
 #version 450
 
 layout(binding = 0) uniform UniformBuffer {
-    mat4x4 modelMatrix;
-    mat4x4 viewMatrix;
-    mat4x4 projectionMatrix;
+    mat4x4 viewProjection;
     vec3 tint;
 } ubo;
 
@@ -17,7 +15,7 @@ layout(location = 1) out vec2 outTexCoord;
 
 void main() {
     vec3 position = modelPosition + worldPosition;
-    gl_Position = ubo.projectionMatrix * ubo.viewMatrix * ubo.modelMatrix * vec4(-position.x, -position.y, -position.z, 1.0);
+    gl_Position = ubo.viewProjection * vec4(-position.x, -position.y, -position.z, 1.0);
     fragColor = color * ubo.tint;
     outTexCoord = inTexCoord;
 }
\ No newline at end of file
@@ -1,12 +1,17 @@
 #version 450
 
 layout(binding = 0) uniform UniformBuffer {
-    mat4x4 modelMatrix;
-    mat4x4 viewMatrix;
-    mat4x4 projectionMatrix;
+    mat4x4 viewProjection;
     vec3 tint;
 } ubo;
 
+//DrawPushConstants
+layout(push_constant) uniform DrawParameters {
+    vec3 modelOffset;
+    uint textureLayerBase;
+    vec4 tint;
+} draw;
+
 layout(location = 0) in vec3 modelPosition;
 layout(location = 1) in vec3 color;
 layout(location = 2) in vec3 inTexCoord;
@@ -16,8 +21,8 @@ layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec3 outTexCoord;
 
 void main() {
-    vec3 position = modelPosition + worldPosition;
-    gl_Position = ubo.projectionMatrix * ubo.viewMatrix * ubo.modelMatrix * vec4(-position.x, -position.y, -position.z, 1.0);
-    fragColor = color * ubo.tint;
-    outTexCoord = inTexCoord;
+    vec3 position = modelPosition + worldPosition + draw.modelOffset;
+    gl_Position = ubo.viewProjection * vec4(-position.x, -position.y, -position.z, 1.0);
+    fragColor = color * ubo.tint * draw.tint.rgb;
+    outTexCoord = vec3(inTexCoord.xy, inTexCoord.z + float(draw.textureLayerBase));
 }
\ No newline at end of file
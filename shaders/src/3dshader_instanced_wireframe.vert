@@ -1,18 +1,23 @@
 #version 450
 
 layout(binding = 0) uniform UniformBuffer {
-    mat4x4 modelMatrix;
-    mat4x4 viewMatrix;
-    mat4x4 projectionMatrix;
+    mat4x4 viewProjection;
     vec3 tint;
 } ubo;
 
+//DrawPushConstants
+layout(push_constant) uniform DrawParameters {
+    vec3 modelOffset;
+    uint textureLayerBase;
+    vec4 tint;
+} draw;
+
 layout(location = 0) in vec3 modelPosition;
 layout(location = 1) in vec3 worldPosition;
 
 void main() {
     //solve z-fighting
     float scale = 1.0005;
-    vec3 position = modelPosition * scale + worldPosition;
-    gl_Position = ubo.projectionMatrix * ubo.viewMatrix * ubo.modelMatrix * vec4(-position.x, -position.y, -position.z, 1.0);
+    vec3 position = modelPosition * scale + worldPosition + draw.modelOffset;
+    gl_Position = ubo.viewProjection * vec4(-position.x, -position.y, -position.z, 1.0);
 }
\ No newline at end of file
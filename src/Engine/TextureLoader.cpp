@@ -26,40 +26,27 @@ std::tuple<int, int, int, stbi_uc*> TextureLoader::getTexturePixels(std::string
     return std::tuple(texWidth, texHeight, texChannels, pixels);
 }
 
-void TextureLoader::createTextureImage(std::shared_ptr<VulkanDevice> device, std::string textureID, std::string texturePath, std::array<bool*, 3> deleteOldTextureBool) {
+VulkanUploadToken TextureLoader::createTextureImage(std::shared_ptr<VulkanDevice> device, std::string textureID, std::string texturePath) {
     std::tuple<int, int, int, stbi_uc*> textureData = getTexturePixels(texturePath, STBI_rgb_alpha);
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-
     VkDeviceSize imageSize = std::get<0>(textureData) * std::get<1>(textureData) * 4;
 
-    VulkanEngine::createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory, device);
-
-    void* data;
-    vkMapMemory(device->getInternalLogicalDevice(), stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, std::get<3>(textureData), static_cast<size_t>(imageSize));
-    vkUnmapMemory(device->getInternalLogicalDevice(), stagingBufferMemory);
-
-    stbi_image_free(std::get<3>(textureData));
-
     VkImage textureImage;
-    VkDeviceMemory textureImageMemory;
-
-    VulkanEngine::createImage(std::get<0>(textureData), std::get<1>(textureData), 1, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory, device);
+    VulkanMemoryAllocation textureImageMemory;
 
-    VulkanEngine::transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, device, 1);
-    VulkanEngine::copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(std::get<0>(textureData)), static_cast<uint32_t>(std::get<1>(textureData)), device);
+    VulkanEngine::createImage(std::get<0>(textureData), std::get<1>(textureData), 1, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory, device, VulkanMemoryTag(CATEGORY_TEXTURE, textureID));
 
-    VulkanEngine::transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, device, 1);
+    //the service copies the pixels into its own staging buffer, so they can be freed right away
+    VulkanUploadToken uploadToken = device->getUploadService()->uploadImage(textureImage, static_cast<uint32_t>(std::get<0>(textureData)), static_cast<uint32_t>(std::get<1>(textureData)), {std::get<3>(textureData)}, imageSize);
 
-    vkDestroyBuffer(device->getInternalLogicalDevice(), stagingBuffer, nullptr);
-    vkFreeMemory(device->getInternalLogicalDevice(), stagingBufferMemory, nullptr);
+    stbi_image_free(std::get<3>(textureData));
 
     texturePathToImage[textureID] = textureImage;
     texturePathToDeviceMemory[textureID] = textureImageMemory;
 
     texturePathToImageDimensions[textureID] = std::make_pair(std::get<0>(textureData), std::get<1>(textureData));
+
+    return uploadToken;
 }
 
 void TextureLoader::createTextureImageView(std::shared_ptr<VulkanDevice> device, std::string textureID, VkFormat format) {
@@ -112,13 +99,6 @@ VkSampler TextureLoader::getTextureSampler() {
 }
 
 void TextureLoader::create(std::shared_ptr<VulkanDevice> device) {
-    funcFreeImage = std::bind(&TextureLoader::vkDeleteImage, this, device, std::placeholders::_1);
-    funcFreeImageView = std::bind(&TextureLoader::vkDeleteImageView, this, device, std::placeholders::_1);
-    funcFreeDeviceMemory = std::bind(&TextureLoader::vkDeleteDeviceMemory, this, device, std::placeholders::_1);
-    imageDeleteThread = std::make_shared<DeleteThread<VkImage>>(funcFreeImage);
-    imageViewDeleteThread = std::make_shared<DeleteThread<VkImageView>>(funcFreeImageView);
-    deviceMemoryDeleteThread = std::make_shared<DeleteThread<VkDeviceMemory>>(funcFreeDeviceMemory);
-
     createTextureSampler(device);
 }
 
@@ -133,8 +113,8 @@ void TextureLoader::destroyTextureLoader(std::shared_ptr<VulkanDevice> device) {
         vkDestroyImage(device->getInternalLogicalDevice(), imagePair.second, nullptr);
     }
     
-    for(std::pair<const std::string, VkDeviceMemory> imagePair : textureArrayIDToDeviceMemory) {
-        vkFreeMemory(device->getInternalLogicalDevice(), imagePair.second, nullptr);
+    for(std::pair<const std::string, VulkanMemoryAllocation> imagePair : textureArrayIDToDeviceMemory) {
+        device->getMemoryAllocator()->free(imagePair.second);
     }
 
     for(std::pair<const std::string, VkImageView> imageViewPair : texturePathToImageView) {
@@ -145,36 +125,28 @@ void TextureLoader::destroyTextureLoader(std::shared_ptr<VulkanDevice> device) {
         vkDestroyImage(device->getInternalLogicalDevice(), imagePair.second, nullptr);
     }
     
-    for(std::pair<const std::string, VkDeviceMemory> imagePair : texturePathToDeviceMemory) {
-        vkFreeMemory(device->getInternalLogicalDevice(), imagePair.second, nullptr);
+    for(std::pair<const std::string, VulkanMemoryAllocation> imagePair : texturePathToDeviceMemory) {
+        device->getMemoryAllocator()->free(imagePair.second);
     }
-
-    imageViewDeleteThread->forceJoin();
-    imageDeleteThread->forceJoin();
-    deviceMemoryDeleteThread->forceJoin();
 }
 
-void TextureLoader::loadTexture(std::shared_ptr<VulkanDevice> device, std::string textureID, std::string texturePath, std::array<bool*, 3> deleteOldTextureBool) {    
+VulkanUploadToken TextureLoader::loadTexture(std::shared_ptr<VulkanDevice> device, std::string textureID, std::string texturePath, VulkanDeletionQueue* deletionQueue) {    
     VkImage oldImage = texturePathToImage[textureID];
     VkImageView oldImageView = texturePathToImageView[textureID];
-    VkDeviceMemory oldDeviceMemory = texturePathToDeviceMemory[textureID];
+    VulkanMemoryAllocation oldDeviceMemory = texturePathToDeviceMemory[textureID];
 
-    createTextureImage(device, textureID, texturePath, deleteOldTextureBool);
+    VulkanUploadToken uploadToken = createTextureImage(device, textureID, texturePath);
     createTextureImageView(device, textureID, VK_FORMAT_R8G8B8A8_SRGB);
 
-    if(texturePathToImage.count(textureID) > 0) {
-        imageViewDeleteThread->addObjectToDelete(oldImageView, deleteOldTextureBool[0]);
-
-        imageDeleteThread->addObjectToDelete(oldImage, deleteOldTextureBool[1]);
+    destroyTexture(device, oldImage, oldImageView, oldDeviceMemory, deletionQueue);
 
-        deviceMemoryDeleteThread->addObjectToDelete(oldDeviceMemory, deleteOldTextureBool[2]);
-    }
+    return uploadToken;
 }
 
-void TextureLoader::loadTextureArray(std::shared_ptr<VulkanDevice> device, std::vector<std::string> texturePaths, std::string arrayName, std::array<bool*, 3> deleteOldTextureBool) {
+VulkanUploadToken TextureLoader::loadTextureArray(std::shared_ptr<VulkanDevice> device, std::vector<std::string> texturePaths, std::string arrayName, VulkanDeletionQueue* deletionQueue) {
     VkImage oldImage = textureArrayIDToImage[arrayName];
     VkImageView oldImageView = textureArrayIDToImageView[arrayName];
-    VkDeviceMemory oldDeviceMemory = texturePathToDeviceMemory[arrayName];
+    VulkanMemoryAllocation oldDeviceMemory = textureArrayIDToDeviceMemory[arrayName];
     
     std::vector<std::tuple<int, int, int, stbi_uc*>> textureData;
 
@@ -197,39 +169,26 @@ void TextureLoader::loadTextureArray(std::shared_ptr<VulkanDevice> device, std::
         }
     }
     
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-
     VkDeviceSize layerSize = std::get<0>(textureData.at(0)) * std::get<1>(textureData.at(0)) * 4;
 
-    VkDeviceSize imageSize = textureData.size() * layerSize;
+    VkImage textureImage;
+    VulkanMemoryAllocation textureImageMemory;
 
-    VulkanEngine::createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory, device);
+    VulkanEngine::createImage(std::get<0>(textureData.at(0)), std::get<1>(textureData.at(0)), textureData.size(), VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory, device, VulkanMemoryTag(CATEGORY_TEXTURE_ARRAY, arrayName));
 
-    VkDeviceSize bufferOffset = 0;
+    std::vector<const void*> layers = std::vector<const void*>();
 
-    void* buffer;
     for(std::tuple<int, int, int, stbi_uc*>& data : textureData) {
-        vkMapMemory(device->getInternalLogicalDevice(), stagingBufferMemory, bufferOffset, layerSize, 0, &buffer);
-        memcpy(buffer, std::get<3>(data), static_cast<size_t>(layerSize));
-        vkUnmapMemory(device->getInternalLogicalDevice(), stagingBufferMemory);
-        bufferOffset = bufferOffset + layerSize;
+        layers.push_back(std::get<3>(data));
     }
 
+    //one layer per texture, the service copies them into its own staging buffer
+    VulkanUploadToken uploadToken = device->getUploadService()->uploadImage(textureImage, static_cast<uint32_t>(std::get<0>(textureData.at(0))), static_cast<uint32_t>(std::get<1>(textureData.at(0))), layers, layerSize);
+
     for(std::tuple<int, int, int, stbi_uc*>& data : textureData) {
         stbi_image_free(std::get<3>(data));
     }
 
-    VkImage textureImage;
-    VkDeviceMemory textureImageMemory;
-
-    VulkanEngine::createImage(std::get<0>(textureData.at(0)), std::get<1>(textureData.at(0)), textureData.size(), VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory, device);
-
-    VulkanEngine::transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, device, texturePaths.size());
-    TextureLoader::copyBufferToImageInLayers(stagingBuffer, textureImage, static_cast<uint32_t>(std::get<0>(textureData.at(0))), static_cast<uint32_t>(std::get<1>(textureData.at(0))), device, texturePaths.size());
-
-    VulkanEngine::transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, device, textureData.size());
-
     textureArrayIDToImage[arrayName] = textureImage;
 
     textureArrayIDToDeviceMemory[arrayName] = textureImageMemory;
@@ -238,62 +197,15 @@ void TextureLoader::loadTextureArray(std::shared_ptr<VulkanDevice> device, std::
 
     textureArrayIDToImageView[arrayName] = VulkanEngine::createImageView(textureArrayIDToImage[arrayName], VK_FORMAT_R8G8B8A8_SRGB, device, VK_IMAGE_VIEW_TYPE_2D_ARRAY, texturePaths.size());
 
-    vkDestroyBuffer(device->getInternalLogicalDevice(), stagingBuffer, nullptr);
-    vkFreeMemory(device->getInternalLogicalDevice(), stagingBufferMemory, nullptr);
-
-    if(textureArrayIDToImage.count(arrayName) > 0) {
-        imageViewDeleteThread->addObjectToDelete(oldImageView, deleteOldTextureBool[0]);
-
-        imageDeleteThread->addObjectToDelete(oldImage, deleteOldTextureBool[1]);
+    destroyTexture(device, oldImage, oldImageView, oldDeviceMemory, deletionQueue);
 
-        deviceMemoryDeleteThread->addObjectToDelete(oldDeviceMemory, deleteOldTextureBool[2]);
-    }
+    return uploadToken;
 }
 
 VkImageView TextureLoader::getTextureArrayImageView(std::string arrayID) {
     return textureArrayIDToImageView[arrayID];
 }
 
-void TextureLoader::copyBufferToImageInLayers(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, std::shared_ptr<VulkanDevice> device, int numberOfLayers) {
-    VkCommandBuffer commandBuffer = VulkanEngine::beginSingleTimeCommands(device);
-
-    VkDeviceSize bufferOffset = 0;
-
-    std::vector<VkBufferImageCopy> regions;
-
-    for(int layer = 0; layer < numberOfLayers; ++layer) {
-        VkBufferImageCopy region{};
-        region.bufferOffset = bufferOffset;
-        region.bufferRowLength = 0;
-        region.bufferImageHeight = 0;
-        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        region.imageSubresource.mipLevel = 0;
-        region.imageSubresource.baseArrayLayer = layer;
-        region.imageSubresource.layerCount = 1;
-        region.imageOffset = {0, 0, 0};
-        region.imageExtent = {
-            width,
-            height,
-            1
-        };
-
-        regions.push_back(region);
-
-        bufferOffset = bufferOffset + width * height * 4;
-    }
-
-    vkCmdCopyBufferToImage(
-        commandBuffer,
-        buffer,
-        image,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        regions.size(),
-        regions.data()
-    );
-
-    VulkanEngine::endSingleTimeCommands(commandBuffer, device);
-}
-
 void expandBitmapChannels(TextBitmap* bitmap, glm::vec3 textColor) {
     std::vector<unsigned char> expandedBitmap;
     for(unsigned char c : bitmap->bitmap) {
@@ -307,38 +219,22 @@ void expandBitmapChannels(TextBitmap* bitmap, glm::vec3 textColor) {
     bitmap->rows = bitmap->rows;
 }
 
-void TextureLoader::loadTextToTexture(std::shared_ptr<VulkanDevice> device, std::string textureID, std::string text, glm::vec3 textColor, std::array<bool*, 3> deleteOldTextureBool) {
+VulkanUploadToken TextureLoader::loadTextToTexture(std::shared_ptr<VulkanDevice> device, std::string textureID, std::string text, glm::vec3 textColor, VulkanDeletionQueue* deletionQueue) {
     VkImage oldImage = texturePathToImage[textureID];
     VkImageView oldImageView = texturePathToImageView[textureID];
-    VkDeviceMemory oldDeviceMemory = texturePathToDeviceMemory[textureID];
+    VulkanMemoryAllocation oldDeviceMemory = texturePathToDeviceMemory[textureID];
 
     TextBitmap bitmap = unitypeConverter.getTextFromString(text);
     expandBitmapChannels(&bitmap, textColor);
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-
     VkDeviceSize imageSize = 4 * bitmap.rows * bitmap.stride;
 
-    VulkanEngine::createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory, device);
-
-    void* data;
-    vkMapMemory(device->getInternalLogicalDevice(), stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, bitmap.bitmap.data(), static_cast<size_t>(imageSize));
-    vkUnmapMemory(device->getInternalLogicalDevice(), stagingBufferMemory);
-
     VkImage textureImage;
-    VkDeviceMemory textureImageMemory;
+    VulkanMemoryAllocation textureImageMemory;
 
-    VulkanEngine::createImage(bitmap.stride, bitmap.rows, 1, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory, device);
-
-    VulkanEngine::transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, device, 1);
-    VulkanEngine::copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(bitmap.stride), static_cast<uint32_t>(bitmap.rows), device);
-    
-    VulkanEngine::transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, device, 1);
+    VulkanEngine::createImage(bitmap.stride, bitmap.rows, 1, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory, device, VulkanMemoryTag(CATEGORY_TEXTURE, textureID));
 
-    vkDestroyBuffer(device->getInternalLogicalDevice(), stagingBuffer, nullptr);
-    vkFreeMemory(device->getInternalLogicalDevice(), stagingBufferMemory, nullptr);
+    VulkanUploadToken uploadToken = device->getUploadService()->uploadImage(textureImage, static_cast<uint32_t>(bitmap.stride), static_cast<uint32_t>(bitmap.rows), {bitmap.bitmap.data()}, imageSize);
 
     texturePathToImage[textureID] = textureImage;
     texturePathToDeviceMemory[textureID] = textureImageMemory;
@@ -347,13 +243,9 @@ void TextureLoader::loadTextToTexture(std::shared_ptr<VulkanDevice> device, std:
 
     createTextureImageView(device, textureID, VK_FORMAT_R8G8B8A8_SRGB);
 
-    if(texturePathToImage.count(textureID) > 0) {
-        imageViewDeleteThread->addObjectToDelete(oldImageView, deleteOldTextureBool[0]);
+    destroyTexture(device, oldImage, oldImageView, oldDeviceMemory, deletionQueue);
 
-        imageDeleteThread->addObjectToDelete(oldImage, deleteOldTextureBool[1]);
-
-        deviceMemoryDeleteThread->addObjectToDelete(oldDeviceMemory, deleteOldTextureBool[2]);
-    }   
+    return uploadToken;
 }
 
 std::pair<unsigned int, unsigned int> TextureLoader::getTextureDimensions(std::string id) {
@@ -372,12 +264,24 @@ std::pair<unsigned int, unsigned int> TextureLoader::getTextureArrayDimensions(s
     return textureArrayIDToImageDimensions.at(id);
 }
 
-std::tuple<std::mutex*, std::mutex*, std::mutex*> TextureLoader::getDeleteThreadAccessMutexes() {
-    if(!imageDeleteThread->isValidInstance() || !imageViewDeleteThread->isValidInstance() || !deviceMemoryDeleteThread->isValidInstance()) {
-        abort();
+void TextureLoader::destroyTexture(std::shared_ptr<VulkanDevice> device, VkImage image, VkImageView imageView, VulkanMemoryAllocation memory, VulkanDeletionQueue* deletionQueue) {
+    //nothing was loaded under the id before
+    if(image == VK_NULL_HANDLE) {
+        return;
+    }
+
+    VkDevice logicalDevice = device->getInternalLogicalDevice();
+    std::shared_ptr<VulkanMemoryAllocator> allocator = device->getMemoryAllocator();
+
+    auto destroyFunction = [logicalDevice, allocator, image, imageView, memory]() {
+        vkDestroyImageView(logicalDevice, imageView, nullptr);
+        vkDestroyImage(logicalDevice, image, nullptr);
+        allocator->free(memory);
+    };
+
+    if(deletionQueue == nullptr) {
+        destroyFunction();
     }else {
-        //imageDeleteThread->getMutexPointer()->lock();
-        //imageDeleteThread->getMutexPointer()->unlock();
+        deletionQueue->retire(destroyFunction);
     }
-    return std::tuple<std::mutex*, std::mutex*, std::mutex*>(imageDeleteThread->getMutexPointer(), imageViewDeleteThread->getMutexPointer(), deviceMemoryDeleteThread->getMutexPointer());
 }
\ No newline at end of file
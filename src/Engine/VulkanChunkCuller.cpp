@@ -0,0 +1,262 @@
+#include "VulkanChunkCuller.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <xmmintrin.h>
+#define CHUNK_CULLER_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CHUNK_CULLER_NEON
+#endif
+
+void VulkanChunkBounds::calculate(std::span<const InstanceData> instances) {
+    chunkCount = static_cast<uint32_t>((instances.size() + VulkanChunkCuller::CHUNK_SIZE - 1) / VulkanChunkCuller::CHUNK_SIZE);
+
+    centerX.assign(chunkCount, 0);
+    centerY.assign(chunkCount, 0);
+    centerZ.assign(chunkCount, 0);
+    extentX.assign(chunkCount, 0);
+    extentY.assign(chunkCount, 0);
+    extentZ.assign(chunkCount, 0);
+
+    for(uint32_t chunk = 0; chunk < chunkCount; ++chunk) {
+        size_t first = chunk * VulkanChunkCuller::CHUNK_SIZE;
+        size_t last = std::min<size_t>(first + VulkanChunkCuller::CHUNK_SIZE, instances.size());
+
+        glm::vec3 boundsMin = instances[first].pos;
+        glm::vec3 boundsMax = instances[first].pos;
+
+        for(size_t i = first + 1; i < last; ++i) {
+            boundsMin = glm::min(boundsMin, instances[i].pos);
+            boundsMax = glm::max(boundsMax, instances[i].pos);
+        }
+
+        centerX[chunk] = (boundsMin.x + boundsMax.x) * 0.5f;
+        centerY[chunk] = (boundsMin.y + boundsMax.y) * 0.5f;
+        centerZ[chunk] = (boundsMin.z + boundsMax.z) * 0.5f;
+        extentX[chunk] = (boundsMax.x - boundsMin.x) * 0.5f;
+        extentY[chunk] = (boundsMax.y - boundsMin.y) * 0.5f;
+        extentZ[chunk] = (boundsMax.z - boundsMin.z) * 0.5f;
+    }
+}
+
+void VulkanChunkBounds::grow(uint32_t offset, std::span<const InstanceData> instances) {
+    for(size_t i = 0; i < instances.size(); ++i) {
+        uint32_t chunk = static_cast<uint32_t>((offset + i) / VulkanChunkCuller::CHUNK_SIZE);
+
+        if(chunk >= chunkCount) {
+            return;
+        }
+
+        glm::vec3 position = instances[i].pos;
+
+        glm::vec3 boundsMin = glm::vec3(centerX[chunk] - extentX[chunk], centerY[chunk] - extentY[chunk], centerZ[chunk] - extentZ[chunk]);
+        glm::vec3 boundsMax = glm::vec3(centerX[chunk] + extentX[chunk], centerY[chunk] + extentY[chunk], centerZ[chunk] + extentZ[chunk]);
+
+        boundsMin = glm::min(boundsMin, position);
+        boundsMax = glm::max(boundsMax, position);
+
+        centerX[chunk] = (boundsMin.x + boundsMax.x) * 0.5f;
+        centerY[chunk] = (boundsMin.y + boundsMax.y) * 0.5f;
+        centerZ[chunk] = (boundsMin.z + boundsMax.z) * 0.5f;
+        extentX[chunk] = (boundsMax.x - boundsMin.x) * 0.5f;
+        extentY[chunk] = (boundsMax.y - boundsMin.y) * 0.5f;
+        extentZ[chunk] = (boundsMax.z - boundsMin.z) * 0.5f;
+    }
+}
+
+void VulkanChunkBounds::clear() {
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    extentX.clear();
+    extentY.clear();
+    extentZ.clear();
+
+    chunkCount = 0;
+}
+
+/*
+the six planes split into components so they can be broadcast, with the model's bounds folded into the distance. a box (center c, half extent e)
+is outside a plane (n, d) when dot(n, c) + dot(|n|, e) + d < 0, and the model's box only shifts c and grows e, so that part is the same for every
+chunk of the model.
+*/
+struct PreparedPlanes {
+    float normalX[6];
+    float normalY[6];
+    float normalZ[6];
+    float absNormalX[6];
+    float absNormalY[6];
+    float absNormalZ[6];
+    float distance[6];
+};
+
+static PreparedPlanes preparePlanes(const VulkanFrustum& frustum, glm::vec3 modelMin, glm::vec3 modelMax) {
+    glm::vec3 modelCenter = (modelMin + modelMax) * 0.5f;
+    glm::vec3 modelExtent = (modelMax - modelMin) * 0.5f;
+
+    PreparedPlanes planes;
+
+    for(int i = 0; i < 6; ++i) {
+        const glm::vec4& plane = frustum.planes[i];
+
+        planes.normalX[i] = plane.x;
+        planes.normalY[i] = plane.y;
+        planes.normalZ[i] = plane.z;
+        planes.absNormalX[i] = std::fabs(plane.x);
+        planes.absNormalY[i] = std::fabs(plane.y);
+        planes.absNormalZ[i] = std::fabs(plane.z);
+        planes.distance[i] = plane.w + plane.x * modelCenter.x + plane.y * modelCenter.y + plane.z * modelCenter.z + planes.absNormalX[i] * modelExtent.x + planes.absNormalY[i] * modelExtent.y + planes.absNormalZ[i] * modelExtent.z;
+    }
+
+    return planes;
+}
+
+static uint8_t testChunk(const PreparedPlanes& planes, const VulkanChunkBounds& chunks, uint32_t chunk) {
+    for(int i = 0; i < 6; ++i) {
+        float distance = planes.distance[i] + planes.normalX[i] * chunks.centerX[chunk] + planes.normalY[i] * chunks.centerY[chunk] + planes.normalZ[i] * chunks.centerZ[chunk] + planes.absNormalX[i] * chunks.extentX[chunk] + planes.absNormalY[i] * chunks.extentY[chunk] + planes.absNormalZ[i] * chunks.extentZ[chunk];
+
+        if(distance < 0) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+VulkanFrustum VulkanChunkCuller::extractFrustum(const glm::mat4x4& viewProjection) {
+    glm::vec4 rows[4];
+
+    for(int i = 0; i < 4; ++i) {
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+
+    VulkanFrustum frustum;
+
+    //left, right, bottom, top, near (depth is 0 to 1) and far
+    frustum.planes[0] = rows[3] + rows[0];
+    frustum.planes[1] = rows[3] - rows[0];
+    frustum.planes[2] = rows[3] + rows[1];
+    frustum.planes[3] = rows[3] - rows[1];
+    frustum.planes[4] = rows[2];
+    frustum.planes[5] = rows[3] - rows[2];
+
+    //the vertex shaders draw -position, so flip the normals to test positions directly
+    for(int i = 0; i < 6; ++i) {
+        frustum.planes[i].x = -frustum.planes[i].x;
+        frustum.planes[i].y = -frustum.planes[i].y;
+        frustum.planes[i].z = -frustum.planes[i].z;
+    }
+
+    return frustum;
+}
+
+void VulkanChunkCuller::cullChunks(const VulkanFrustum& frustum, const VulkanChunkBounds& chunks, glm::vec3 modelMin, glm::vec3 modelMax, uint32_t firstChunk, uint32_t lastChunk, uint8_t* visible) {
+    PreparedPlanes planes = preparePlanes(frustum, modelMin, modelMax);
+
+    uint32_t chunk = firstChunk;
+
+#if defined(CHUNK_CULLER_SSE)
+    for(; chunk + 4 <= lastChunk; chunk += 4) {
+        __m128 centerX = _mm_loadu_ps(&chunks.centerX[chunk]);
+        __m128 centerY = _mm_loadu_ps(&chunks.centerY[chunk]);
+        __m128 centerZ = _mm_loadu_ps(&chunks.centerZ[chunk]);
+        __m128 extentX = _mm_loadu_ps(&chunks.extentX[chunk]);
+        __m128 extentY = _mm_loadu_ps(&chunks.extentY[chunk]);
+        __m128 extentZ = _mm_loadu_ps(&chunks.extentZ[chunk]);
+
+        //a box is visible if it isn't fully behind any plane, so only the smallest distance matters
+        __m128 minDistance = _mm_set1_ps(std::numeric_limits<float>::max());
+
+        for(int i = 0; i < 6; ++i) {
+            __m128 distance = _mm_set1_ps(planes.distance[i]);
+            distance = _mm_add_ps(distance, _mm_mul_ps(centerX, _mm_set1_ps(planes.normalX[i])));
+            distance = _mm_add_ps(distance, _mm_mul_ps(centerY, _mm_set1_ps(planes.normalY[i])));
+            distance = _mm_add_ps(distance, _mm_mul_ps(centerZ, _mm_set1_ps(planes.normalZ[i])));
+            distance = _mm_add_ps(distance, _mm_mul_ps(extentX, _mm_set1_ps(planes.absNormalX[i])));
+            distance = _mm_add_ps(distance, _mm_mul_ps(extentY, _mm_set1_ps(planes.absNormalY[i])));
+            distance = _mm_add_ps(distance, _mm_mul_ps(extentZ, _mm_set1_ps(planes.absNormalZ[i])));
+
+            minDistance = _mm_min_ps(minDistance, distance);
+        }
+
+        int mask = _mm_movemask_ps(_mm_cmpge_ps(minDistance, _mm_setzero_ps()));
+
+        for(uint32_t i = 0; i < 4; ++i) {
+            visible[chunk + i] = (mask >> i) & 1;
+        }
+    }
+#elif defined(CHUNK_CULLER_NEON)
+    for(; chunk + 4 <= lastChunk; chunk += 4) {
+        float32x4_t centerX = vld1q_f32(&chunks.centerX[chunk]);
+        float32x4_t centerY = vld1q_f32(&chunks.centerY[chunk]);
+        float32x4_t centerZ = vld1q_f32(&chunks.centerZ[chunk]);
+        float32x4_t extentX = vld1q_f32(&chunks.extentX[chunk]);
+        float32x4_t extentY = vld1q_f32(&chunks.extentY[chunk]);
+        float32x4_t extentZ = vld1q_f32(&chunks.extentZ[chunk]);
+
+        //a box is visible if it isn't fully behind any plane, so only the smallest distance matters
+        float32x4_t minDistance = vdupq_n_f32(std::numeric_limits<float>::max());
+
+        for(int i = 0; i < 6; ++i) {
+            float32x4_t distance = vdupq_n_f32(planes.distance[i]);
+            distance = vmlaq_n_f32(distance, centerX, planes.normalX[i]);
+            distance = vmlaq_n_f32(distance, centerY, planes.normalY[i]);
+            distance = vmlaq_n_f32(distance, centerZ, planes.normalZ[i]);
+            distance = vmlaq_n_f32(distance, extentX, planes.absNormalX[i]);
+            distance = vmlaq_n_f32(distance, extentY, planes.absNormalY[i]);
+            distance = vmlaq_n_f32(distance, extentZ, planes.absNormalZ[i]);
+
+            minDistance = vminq_f32(minDistance, distance);
+        }
+
+        uint32x4_t inside = vcgeq_f32(minDistance, vdupq_n_f32(0));
+
+        visible[chunk] = vgetq_lane_u32(inside, 0) != 0;
+        visible[chunk + 1] = vgetq_lane_u32(inside, 1) != 0;
+        visible[chunk + 2] = vgetq_lane_u32(inside, 2) != 0;
+        visible[chunk + 3] = vgetq_lane_u32(inside, 3) != 0;
+    }
+#endif
+
+    //whatever doesn't fill a whole register
+    for(; chunk < lastChunk; ++chunk) {
+        visible[chunk] = testChunk(planes, chunks, chunk);
+    }
+}
+
+void VulkanChunkCuller::collectVisibleRanges(const uint8_t* visible, uint32_t chunkCount, uint32_t instanceCount, std::vector<VulkanGeometryRange>& ranges) {
+    ranges.clear();
+
+    for(uint32_t chunk = 0; chunk < chunkCount; ++chunk) {
+        if(!visible[chunk]) {
+            continue;
+        }
+
+        uint32_t first = chunk * CHUNK_SIZE;
+        uint32_t count = std::min(first + CHUNK_SIZE, instanceCount) - first;
+
+        if(!ranges.empty() && ranges.back().first + ranges.back().count == first) {
+            ranges.back().count = ranges.back().count + count;
+        }else {
+            VulkanGeometryRange range;
+            range.first = first;
+            range.count = count;
+
+            ranges.push_back(range);
+        }
+    }
+}
+
+std::string VulkanChunkCuller::getInstructionSet() {
+#if defined(CHUNK_CULLER_SSE)
+    return "SSE";
+#elif defined(CHUNK_CULLER_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
\ No newline at end of file
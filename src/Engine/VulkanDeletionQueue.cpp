@@ -0,0 +1,53 @@
+#include "VulkanDeletionQueue.h"
+
+VulkanDeletionQueue::VulkanDeletionQueue() {
+
+}
+
+void VulkanDeletionQueue::retire(std::function<void()> destroyFunction) {
+    RetiredObject object;
+    object.value = recordingValue;
+    object.destroy = std::move(destroyFunction);
+
+    retiredObjects.push_back(std::move(object));
+}
+
+uint64_t VulkanDeletionQueue::getRecordingValue() {
+    return recordingValue;
+}
+
+uint64_t VulkanDeletionQueue::submit() {
+    return recordingValue++;
+}
+
+void VulkanDeletionQueue::complete(uint64_t value) {
+    if(value <= completedValue) {
+        return;
+    }
+
+    completedValue = value;
+
+    while(!retiredObjects.empty() && retiredObjects.front().value <= completedValue) {
+        retiredObjects.front().destroy();
+        retiredObjects.pop_front();
+    }
+}
+
+bool VulkanDeletionQueue::hasCompleted(uint64_t value) {
+    return value <= completedValue;
+}
+
+void VulkanDeletionQueue::destroyAll() {
+    for(RetiredObject& object : retiredObjects) {
+        object.destroy();
+    }
+
+    retiredObjects.clear();
+
+    //nothing that was submitted is running anymore
+    completedValue = recordingValue - 1;
+}
+
+size_t VulkanDeletionQueue::getPendingCount() {
+    return retiredObjects.size();
+}
\ No newline at end of file
@@ -10,6 +10,15 @@ VulkanDevice::VulkanDevice() : deviceExtensions({
 }
 
 void VulkanDevice::destroyDevice() {
+    //frees memory through the allocator, so it goes first
+    deletionQueue->destroyAll();
+
+    uploadService->destroyUploadService();
+
+    stagingRing->destroyStagingRing();
+
+    memoryAllocator->destroyMemoryAllocator();
+
     vkDestroyCommandPool(logicalDevice, graphicsCommandPool, nullptr);
 
     vkDestroyDevice(logicalDevice, nullptr);
@@ -20,6 +29,12 @@ void VulkanDevice::create(std::shared_ptr<VulkanInstance> instance, std::shared_
     createLogicalDevice(instance);
     createCommandPool();
 
+    memoryAllocator->create(physicalDevice, logicalDevice, memoryBudgetSupported);
+
+    stagingRing->create(logicalDevice, memoryAllocator, graphicsCommandPool, graphicsQueue, stagingRingSize);
+
+    uploadService->create(logicalDevice, memoryAllocator, deletionQueue, indices.graphicsFamily.value(), graphicsQueue, indices.transferFamily, transferQueue);
+
     hasBeenCreated = true;
 }
 
@@ -55,6 +70,10 @@ void VulkanDevice::createLogicalDevice(std::shared_ptr<VulkanInstance> instance)
 
     std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
 
+    if(indices.transferFamily.has_value()) {
+        uniqueQueueFamilies.insert(indices.transferFamily.value());
+    }
+
     float queuePriority = 1.0f;
     for(uint32_t queueFamily : uniqueQueueFamilies) {
         VkDeviceQueueCreateInfo queueCreateInfo{};
@@ -65,10 +84,32 @@ void VulkanDevice::createLogicalDevice(std::shared_ptr<VulkanInstance> instance)
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceFeatures supportedFeatures{};
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
+    //optional, only needed for indirect drawing
+    multiDrawIndirectSupported = supportedFeatures.multiDrawIndirect == VK_TRUE;
+    drawIndirectFirstInstanceSupported = supportedFeatures.drawIndirectFirstInstance == VK_TRUE;
+
+    //optional, only needed for gpu profiling
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    timestampPeriod = deviceProperties.limits.timestampPeriod;
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queueFamilies = std::vector<VkQueueFamilyProperties>(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    timestampValidBits = queueFamilies.at(indices.graphicsFamily.value()).timestampValidBits;
+
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
     deviceFeatures.fillModeNonSolid = VK_TRUE;
     deviceFeatures.independentBlend = VK_TRUE;
+    deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
     
     VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures {};
     indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
@@ -84,8 +125,24 @@ void VulkanDevice::createLogicalDevice(std::shared_ptr<VulkanInstance> instance)
     createInfo.pEnabledFeatures = &deviceFeatures;
     createInfo.pNext = (void*) &indexingFeatures;
 
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    std::vector<const char*> enabledExtensions = deviceExtensions;
+
+    //optional, only gives the memory allocator the driver's budget numbers
+    memoryBudgetSupported = isDeviceExtensionSupported(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    if(memoryBudgetSupported) {
+        enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+
+    //the extension instead of core 1.2 because the core version needs the drawIndirectCount feature, see the note in canDeviceBeUsed
+    bool drawIndirectCountExtension = isDeviceExtensionSupported(physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
+    if(drawIndirectCountExtension) {
+        enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    }
+
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
     //no longer used
     createInfo.enabledLayerCount = 0;
@@ -96,6 +153,14 @@ void VulkanDevice::createLogicalDevice(std::shared_ptr<VulkanInstance> instance)
 
     vkGetDeviceQueue(logicalDevice, indices.graphicsFamily.value(), 0, &graphicsQueue);
     vkGetDeviceQueue(logicalDevice, indices.presentFamily.value(), 0, &presentQueue);
+
+    if(indices.transferFamily.has_value()) {
+        vkGetDeviceQueue(logicalDevice, indices.transferFamily.value(), 0, &transferQueue);
+    }
+
+    if(drawIndirectCountExtension) {
+        cmdDrawIndirectCount = (PFN_vkCmdDrawIndirectCount) vkGetDeviceProcAddr(logicalDevice, "vkCmdDrawIndirectCountKHR");
+    }
 }
 
 QueueFamilyIndices VulkanDevice::getDeviceQueueFamilies(VkPhysicalDevice pDevice, std::shared_ptr<VulkanDisplay> display) {
@@ -132,6 +197,16 @@ QueueFamilyIndices VulkanDevice::getDeviceQueueFamilies(VkPhysicalDevice pDevice
         i++;
     }
 
+    //usually the dma engines, which copy without taking time away from graphics work
+    for(uint32_t family = 0; family < queueFamilyCount; ++family) {
+        VkQueueFlags flags = queueFamilies[family].queueFlags;
+
+        if((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT) && !(flags & VK_QUEUE_COMPUTE_BIT)) {
+            indices.transferFamily = family;
+            break;
+        }
+    }
+
     return indices;
 }
 
@@ -187,6 +262,22 @@ bool VulkanDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
     return requiredExtensions.empty();
 }
 
+bool VulkanDevice::isDeviceExtensionSupported(VkPhysicalDevice device, std::string extensionName) {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+    for(const auto& extension : availableExtensions) {
+        if(extensionName == extension.extensionName) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 SwapChainSupportDetails VulkanDevice::getDeviceSwapChainSupport(VkPhysicalDevice device, std::shared_ptr<VulkanDisplay> display) {
     SwapChainSupportDetails details;
 
@@ -235,11 +326,40 @@ QueueFamilyIndices VulkanDevice::getDeviceQueueFamilies(std::shared_ptr<VulkanDi
     return VulkanDevice::getDeviceQueueFamilies(physicalDevice, display);
 }
 
+bool VulkanDevice::supportsMultiDrawIndirect() {
+    return multiDrawIndirectSupported;
+}
+
+bool VulkanDevice::supportsDrawIndirectFirstInstance() {
+    return drawIndirectFirstInstanceSupported;
+}
+
+PFN_vkCmdDrawIndirectCount VulkanDevice::getDrawIndirectCountFunction() {
+    return cmdDrawIndirectCount;
+}
+
+bool VulkanDevice::supportsTimestamps() {
+    return timestampValidBits > 0 && timestampPeriod > 0;
+}
+
+float VulkanDevice::getTimestampPeriod() {
+    return timestampPeriod;
+}
+
+uint32_t VulkanDevice::getTimestampValidBits() {
+    return timestampValidBits;
+}
+
+uint32_t VulkanDevice::getGraphicsQueueFamilyIndex() {
+    return indices.graphicsFamily.value();
+}
+
 void VulkanDevice::createCommandPool() {
     VkCommandPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     poolInfo.queueFamilyIndex = indices.graphicsFamily.value();
-    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    //only single time commands come from here, they are freed right after they ran and never reset. per frame work uses the frames' own pools
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 
     if(vkCreateCommandPool(logicalDevice, &poolInfo, nullptr, &graphicsCommandPool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create command pool");
@@ -256,4 +376,32 @@ VkQueue& VulkanDevice::getInternalGraphicsQueue() {
 
 VkQueue& VulkanDevice::getInternalPresentQueue() {
     return presentQueue;
+}
+
+bool VulkanDevice::hasTransferQueue() {
+    return indices.transferFamily.has_value();
+}
+
+uint32_t VulkanDevice::getTransferQueueFamilyIndex() {
+    return indices.transferFamily.value();
+}
+
+VkQueue& VulkanDevice::getInternalTransferQueue() {
+    return transferQueue;
+}
+
+std::shared_ptr<VulkanMemoryAllocator> VulkanDevice::getMemoryAllocator() {
+    return memoryAllocator;
+}
+
+std::shared_ptr<VulkanStagingRing> VulkanDevice::getStagingRing() {
+    return stagingRing;
+}
+
+std::shared_ptr<VulkanDeletionQueue> VulkanDevice::getDeletionQueue() {
+    return deletionQueue;
+}
+
+std::shared_ptr<VulkanUploadService> VulkanDevice::getUploadService() {
+    return uploadService;
 }
\ No newline at end of file
@@ -0,0 +1,239 @@
+#include "VulkanDrawList.h"
+
+#include <stdexcept>
+
+void VulkanBindCounts::add(const VulkanBindCounts& other) {
+    pipelineBinds += other.pipelineBinds;
+    descriptorSetBinds += other.descriptorSetBinds;
+    vertexBufferBinds += other.vertexBufferBinds;
+    skippedBinds += other.skippedBinds;
+    pushConstantUpdates += other.pushConstantUpdates;
+    draws += other.draws;
+}
+
+void VulkanDrawList::clear() {
+    draws.clear();
+    bufferNumbers.clear();
+    timestampRuns.clear();
+}
+
+void VulkanDrawList::addDraw(VulkanDrawState state, VkBuffer vertexBuffer, VkBuffer instanceBuffer, uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance, const DrawPushConstants& pushConstants, uint32_t timingGroup) {
+    if(state.subpass > 0xF || state.pipeline > 0xF || state.descriptorPipeline > 0xF) {
+        throw std::runtime_error("draw state doesn't fit into a draw list key!");
+    }
+
+    VulkanDrawItem item;
+    item.state = state;
+    item.vertexBuffer = vertexBuffer;
+    item.instanceBuffer = instanceBuffer;
+    item.vertexCount = vertexCount;
+    item.instanceCount = instanceCount;
+    item.firstVertex = firstVertex;
+    item.firstInstance = firstInstance;
+    item.pushConstants = pushConstants;
+    item.timingGroup = timingGroup;
+
+    item.key = (static_cast<uint64_t>(state.subpass) << 56) | (static_cast<uint64_t>(state.pipeline) << 52) | (static_cast<uint64_t>(state.descriptorPipeline) << 48);
+    item.key |= (static_cast<uint64_t>(getBufferNumber(vertexBuffer)) << 24) | static_cast<uint64_t>(getBufferNumber(instanceBuffer));
+
+    draws.push_back(item);
+}
+
+uint32_t VulkanDrawList::getBufferNumber(VkBuffer buffer) {
+    std::unordered_map<VkBuffer, uint32_t>::iterator it = bufferNumbers.find(buffer);
+
+    if(it != bufferNumbers.end()) {
+        return it->second;
+    }
+
+    uint32_t number = static_cast<uint32_t>(bufferNumbers.size());
+
+    if(number > 0xFFFFFF) {
+        throw std::runtime_error("too many buffers for a draw list key!");
+    }
+
+    bufferNumbers[buffer] = number;
+
+    return number;
+}
+
+void VulkanDrawList::sort() {
+    size_t count = draws.size();
+
+    if(count < 2) {
+        return;
+    }
+
+    entries.resize(count);
+    scratchEntries.resize(count);
+
+    uint32_t histograms[8][256] = {};
+
+    for(size_t i = 0; i < count; ++i) {
+        entries[i].key = draws[i].key;
+        entries[i].index = static_cast<uint32_t>(i);
+
+        for(uint32_t byte = 0; byte < 8; ++byte) {
+            ++histograms[byte][(entries[i].key >> (byte * 8)) & 0xFF];
+        }
+    }
+
+    for(uint32_t byte = 0; byte < 8; ++byte) {
+        uint32_t shift = byte * 8;
+
+        //every key has the same value in this byte, the pass wouldn't move anything
+        if(histograms[byte][(entries[0].key >> shift) & 0xFF] == count) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+
+        for(uint32_t bucket = 0; bucket < 256; ++bucket) {
+            uint32_t bucketSize = histograms[byte][bucket];
+            histograms[byte][bucket] = offset;
+            offset += bucketSize;
+        }
+
+        for(SortEntry& entry : entries) {
+            scratchEntries[histograms[byte][(entry.key >> shift) & 0xFF]++] = entry;
+        }
+
+        entries.swap(scratchEntries);
+    }
+
+    sortedDraws.clear();
+    sortedDraws.reserve(count);
+
+    for(SortEntry& entry : entries) {
+        sortedDraws.push_back(draws[entry.index]);
+    }
+
+    draws.swap(sortedDraws);
+}
+
+std::vector<VulkanDrawItem>& VulkanDrawList::getDraws() {
+    return draws;
+}
+
+void VulkanDrawList::assignTimestamps(uint32_t firstQuery, uint32_t queryCount) {
+    timestampRuns.clear();
+
+    uint32_t nextQuery = firstQuery;
+    bool runTimed = false;
+
+    for(size_t i = 0; i < draws.size(); ++i) {
+        VulkanDrawItem& item = draws[i];
+        item.beginTimestamp = VulkanDrawItem::NO_TIMESTAMP;
+        item.endTimestamp = VulkanDrawItem::NO_TIMESTAMP;
+
+        if(item.timingGroup == VulkanDrawItem::NO_TIMING_GROUP) {
+            runTimed = false;
+            continue;
+        }
+
+        //a run never crosses into another subpass, the subpass change would count towards it
+        bool startsRun = i == 0 || draws[i - 1].timingGroup != item.timingGroup || draws[i - 1].state.subpass != item.state.subpass;
+
+        if(startsRun) {
+            runTimed = nextQuery + 2 <= firstQuery + queryCount;
+
+            if(!runTimed) {
+                continue;
+            }
+
+            VulkanTimestampRun run;
+            run.timingGroup = item.timingGroup;
+            run.beginQuery = nextQuery;
+            timestampRuns.push_back(run);
+
+            item.beginTimestamp = nextQuery;
+            nextQuery += 2;
+        }else if(!runTimed) {
+            continue;
+        }else {
+            //the run goes on, so the previous draw doesn't end it
+            draws[i - 1].endTimestamp = VulkanDrawItem::NO_TIMESTAMP;
+        }
+
+        item.endTimestamp = timestampRuns.back().beginQuery + 1;
+    }
+}
+
+std::vector<VulkanTimestampRun>& VulkanDrawList::getTimestampRuns() {
+    return timestampRuns;
+}
+
+void VulkanDrawList::record(VkCommandBuffer commandBuffer, size_t first, size_t last, const VulkanDrawBindings& bindings, VulkanBindCounts& counts) {
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    VkPipelineLayout boundLayout = VK_NULL_HANDLE;
+    VkDescriptorSet boundDescriptorSet = VK_NULL_HANDLE;
+    VkBuffer boundBuffers[] = {VK_NULL_HANDLE, VK_NULL_HANDLE};
+
+    VkPipelineLayout pushedLayout = VK_NULL_HANDLE;
+    DrawPushConstants pushedConstants;
+
+    VkDeviceSize offsets[] = {0, 0};
+
+    for(size_t i = first; i < last; ++i) {
+        const VulkanDrawItem& item = draws[i];
+
+        VkPipeline pipeline = bindings.pipelines[item.state.pipeline];
+
+        if(pipeline != boundPipeline) {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            boundPipeline = pipeline;
+            ++counts.pipelineBinds;
+        }else {
+            ++counts.skippedBinds;
+        }
+
+        //a set bound with another layout might not be compatible, so a layout change rebinds too
+        VkPipelineLayout layout = bindings.pipelineLayouts[item.state.pipeline];
+        VkDescriptorSet descriptorSet = bindings.descriptorSets[item.state.descriptorPipeline];
+
+        if(layout != boundLayout || descriptorSet != boundDescriptorSet) {
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &descriptorSet, 1, &bindings.dynamicOffset);
+            boundLayout = layout;
+            boundDescriptorSet = descriptorSet;
+            ++counts.descriptorSetBinds;
+        }else {
+            ++counts.skippedBinds;
+        }
+
+        bool vertexBufferChanged = item.vertexBuffer != boundBuffers[0];
+        bool instanceBufferChanged = item.instanceBuffer != boundBuffers[1];
+
+        if(vertexBufferChanged || instanceBufferChanged) {
+            //only the slots that changed
+            uint32_t firstBinding = (vertexBufferChanged) ? 0 : 1;
+            uint32_t bindingCount = (vertexBufferChanged && instanceBufferChanged) ? 2 : 1;
+
+            boundBuffers[0] = item.vertexBuffer;
+            boundBuffers[1] = item.instanceBuffer;
+
+            vkCmdBindVertexBuffers(commandBuffer, firstBinding, bindingCount, &boundBuffers[firstBinding], offsets);
+            ++counts.vertexBufferBinds;
+        }else {
+            ++counts.skippedBinds;
+        }
+
+        //push constants are undefined after binding a pipeline with another layout, until they are pushed with it
+        if(layout != pushedLayout || item.pushConstants != pushedConstants) {
+            vkCmdPushConstants(commandBuffer, layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawPushConstants), &item.pushConstants);
+            pushedLayout = layout;
+            pushedConstants = item.pushConstants;
+            ++counts.pushConstantUpdates;
+        }
+
+        if(bindings.queryPool != VK_NULL_HANDLE && item.beginTimestamp != VulkanDrawItem::NO_TIMESTAMP) {
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, bindings.queryPool, bindings.firstQuery + item.beginTimestamp);
+        }
+
+        vkCmdDraw(commandBuffer, item.vertexCount, item.instanceCount, item.firstVertex, item.firstInstance);
+        ++counts.draws;
+
+        if(bindings.queryPool != VK_NULL_HANDLE && item.endTimestamp != VulkanDrawItem::NO_TIMESTAMP) {
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, bindings.queryPool, bindings.firstQuery + item.endTimestamp);
+        }
+    }
+}
\ No newline at end of file
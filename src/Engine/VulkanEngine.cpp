@@ -308,25 +308,22 @@ std::shared_ptr<TextureLoader> VulkanEngine::getTextureLoader() {
     return textureLoader;
 }
 
+std::shared_ptr<VulkanFrameTimer> VulkanEngine::getFrameTimer() {
+    return frameTimer;
+}
+
 void VulkanEngine::recreateSwapchain() {
+    VulkanFrameTimer::ScopedTimer timer(*frameTimer, PHASE_SWAPCHAIN_RECREATE);
+
     vkDeviceWaitIdle(vkDevice->getInternalLogicalDevice());
     setSwapchain(vkSwapchain);
 }
 
 uint32_t VulkanEngine::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, std::shared_ptr<VulkanDevice>  device) {
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(device->getInternalPhysicalDevice(), &memProperties);
-
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
-        }
-    }
-
-    throw std::runtime_error("couldn't find memory type that matched the requested properties.");
+    return device->getMemoryAllocator()->findMemoryType(typeFilter, properties);
 }
 
-void VulkanEngine::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory, std::shared_ptr<VulkanDevice>  device) {
+static VkMemoryRequirements createBufferHandle(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, std::shared_ptr<VulkanDevice>& device) {
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.size = size;
@@ -340,19 +337,26 @@ void VulkanEngine::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkM
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(device->getInternalLogicalDevice(), buffer, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = VulkanEngine::findMemoryType(memRequirements.memoryTypeBits, properties, device);
+    return memRequirements;
+}
+
+void VulkanEngine::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VulkanMemoryAllocation& bufferMemory, std::shared_ptr<VulkanDevice>  device, VulkanMemoryTag tag) {
+    VkMemoryRequirements memRequirements = createBufferHandle(size, usage, buffer, device);
 
-    if(vkAllocateMemory(device->getInternalLogicalDevice(), &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate vertex buffer memory!");
-    }
+    bufferMemory = device->getMemoryAllocator()->allocate(memRequirements, properties, true, tag);
+
+    vkBindBufferMemory(device->getInternalLogicalDevice(), buffer, bufferMemory.memory, bufferMemory.offset);
+}
 
-    vkBindBufferMemory(device->getInternalLogicalDevice(), buffer, bufferMemory, 0);
+void VulkanEngine::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, MEMORY_USAGE memoryUsage, VkBuffer& buffer, VulkanMemoryAllocation& bufferMemory, std::shared_ptr<VulkanDevice>  device, VulkanMemoryTag tag) {
+    VkMemoryRequirements memRequirements = createBufferHandle(size, usage, buffer, device);
+
+    bufferMemory = device->getMemoryAllocator()->allocate(memRequirements, memoryUsage, true, tag);
+
+    vkBindBufferMemory(device->getInternalLogicalDevice(), buffer, bufferMemory.memory, bufferMemory.offset);
 }
 
-void VulkanEngine::createImage(uint32_t width, uint32_t height, uint32_t layers, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory, std::shared_ptr<VulkanDevice> device) {
+void VulkanEngine::createImage(uint32_t width, uint32_t height, uint32_t layers, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VulkanMemoryAllocation& imageMemory, std::shared_ptr<VulkanDevice> device, VulkanMemoryTag tag) {
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -375,16 +379,9 @@ void VulkanEngine::createImage(uint32_t width, uint32_t height, uint32_t layers,
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(device->getInternalLogicalDevice(), image, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties, device);
-
-    if (vkAllocateMemory(device->getInternalLogicalDevice(), &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate image memory!");
-    }
+    imageMemory = device->getMemoryAllocator()->allocate(memRequirements, properties, tiling == VK_IMAGE_TILING_LINEAR, tag);
 
-    vkBindImageMemory(device->getInternalLogicalDevice(), image, imageMemory, 0);
+    vkBindImageMemory(device->getInternalLogicalDevice(), image, imageMemory.memory, imageMemory.offset);
 }
 
 VkCommandBuffer VulkanEngine::beginSingleTimeCommands(std::shared_ptr<VulkanDevice> device) {
@@ -0,0 +1,103 @@
+#include "VulkanFrameTimer.h"
+
+#include <algorithm>
+
+VulkanFrameTimer::ScopedTimer::ScopedTimer(VulkanFrameTimer& timer, FRAME_PHASE phase) : timer(timer), phase(phase), start(std::chrono::steady_clock::now()) {
+
+}
+
+VulkanFrameTimer::ScopedTimer::~ScopedTimer() {
+    timer.addSample(phase, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+}
+
+VulkanFrameTimer::VulkanFrameTimer() {
+
+}
+
+void VulkanFrameTimer::addSample(FRAME_PHASE phase, uint64_t nanoseconds) {
+    PhaseRing& ring = rings[phase];
+
+    ring.nanoseconds[ring.next] = nanoseconds;
+    ring.next = (ring.next + 1) % WINDOW_SIZE;
+    ring.count = std::min(ring.count + 1, WINDOW_SIZE);
+}
+
+VulkanFrameStats VulkanFrameTimer::getFrameStats() {
+    VulkanFrameStats stats;
+
+    for(size_t phase = 0; phase < FRAME_PHASE_COUNT; ++phase) {
+        PhaseRing& ring = rings[phase];
+
+        if(ring.count == 0) {
+            continue;
+        }
+
+        //the ring is only partially filled until WINDOW_SIZE samples came in, and always from the start
+        std::copy(ring.nanoseconds.begin(), ring.nanoseconds.begin() + ring.count, scratch.begin());
+
+        uint64_t total = 0;
+
+        for(uint32_t i = 0; i < ring.count; ++i) {
+            total += scratch[i];
+        }
+
+        //nearest rank
+        uint32_t p99Index = (ring.count * 99 + 99) / 100 - 1;
+        std::nth_element(scratch.begin(), scratch.begin() + p99Index, scratch.begin() + ring.count);
+
+        VulkanPhaseStats& phaseStats = stats.phases[phase];
+        phaseStats.min = *std::min_element(scratch.begin(), scratch.begin() + ring.count) / 1000000.0;
+        phaseStats.max = *std::max_element(scratch.begin(), scratch.begin() + ring.count) / 1000000.0;
+        phaseStats.average = total / static_cast<double>(ring.count) / 1000000.0;
+        phaseStats.p99 = scratch[p99Index] / 1000000.0;
+        phaseStats.samples = ring.count;
+    }
+
+    return stats;
+}
+
+void VulkanFrameTimer::reset() {
+    for(PhaseRing& ring : rings) {
+        ring.next = 0;
+        ring.count = 0;
+    }
+}
+
+const char* VulkanFrameTimer::getPhaseName(FRAME_PHASE phase) {
+    switch(phase) {
+        case PHASE_FENCE_WAIT:
+            return "fence wait";
+        case PHASE_DELETION:
+            return "deletion";
+        case PHASE_ACQUIRE:
+            return "acquire";
+        case PHASE_IMAGE_WAIT:
+            return "image wait";
+        case PHASE_UNIFORM_UPDATE:
+            return "uniform update";
+        case PHASE_RECORDING:
+            return "recording";
+        case PHASE_SUBMIT:
+            return "submit";
+        case PHASE_PRESENT:
+            return "present";
+        case PHASE_SWAPCHAIN_RECREATE:
+            return "swapchain recreate";
+        case PHASE_FRAME:
+            return "frame";
+        case PHASE_GPU_PRE_PASS:
+            return "gpu pre pass";
+        case PHASE_GPU_OPAQUE:
+            return "gpu opaque";
+        case PHASE_GPU_TRANSPARENT:
+            return "gpu transparent";
+        case PHASE_GPU_COMPOSITE:
+            return "gpu composite";
+        case PHASE_GPU_OVERLAY:
+            return "gpu overlay";
+        case PHASE_GPU_FRAME:
+            return "gpu frame";
+        default:
+            return "unknown";
+    }
+}
\ No newline at end of file
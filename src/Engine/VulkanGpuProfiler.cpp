@@ -0,0 +1,140 @@
+#include "VulkanGpuProfiler.h"
+
+#include <stdexcept>
+
+VulkanGpuProfiler::VulkanGpuProfiler() {
+
+}
+
+void VulkanGpuProfiler::create(std::shared_ptr<VulkanDevice> device, uint32_t imageCount, uint32_t drawQueryCount) {
+    if(!device->supportsTimestamps()) {
+        throw std::runtime_error("the graphics queue of this device doesn't support timestamps!");
+    }
+
+    this->imageCount = imageCount;
+    this->drawQueryCount = drawQueryCount;
+    queriesPerImage = SUBPASS_QUERY_COUNT + drawQueryCount;
+
+    nanosecondsPerTick = device->getTimestampPeriod();
+    timestampMask = (device->getTimestampValidBits() >= 64) ? ~0ull : (1ull << device->getTimestampValidBits()) - 1;
+
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = queriesPerImage * imageCount;
+
+    if(vkCreateQueryPool(device->getInternalLogicalDevice(), &poolInfo, nullptr, &queryPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timestamp query pool!");
+    }
+
+    results = std::vector<uint64_t>(queriesPerImage * 2, 0);
+    pendingImages = std::vector<bool>(imageCount, false);
+
+    hasBeenCreated = true;
+}
+
+void VulkanGpuProfiler::destroyGpuProfiler(std::shared_ptr<VulkanDevice> device) {
+    if(!hasBeenCreated) {
+        return;
+    }
+
+    vkDestroyQueryPool(device->getInternalLogicalDevice(), queryPool, nullptr);
+
+    queryPool = VK_NULL_HANDLE;
+    pendingImages.clear();
+
+    hasBeenCreated = false;
+}
+
+bool VulkanGpuProfiler::isCreated() {
+    return hasBeenCreated;
+}
+
+uint32_t VulkanGpuProfiler::getImageCount() {
+    return imageCount;
+}
+
+uint32_t VulkanGpuProfiler::getDrawQueryCount() {
+    return drawQueryCount;
+}
+
+VkQueryPool VulkanGpuProfiler::getQueryPool() {
+    return queryPool;
+}
+
+uint32_t VulkanGpuProfiler::getFirstQuery(uint32_t imageIndex) {
+    return imageIndex * queriesPerImage;
+}
+
+void VulkanGpuProfiler::recordReset(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+    vkCmdResetQueryPool(commandBuffer, queryPool, getFirstQuery(imageIndex), queriesPerImage);
+
+    pendingImages[imageIndex] = true;
+}
+
+void VulkanGpuProfiler::writeTimestamp(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t query, VkPipelineStageFlagBits stage) {
+    vkCmdWriteTimestamp(commandBuffer, stage, queryPool, getFirstQuery(imageIndex) + query);
+}
+
+bool VulkanGpuProfiler::readImage(std::shared_ptr<VulkanDevice> device, uint32_t imageIndex, VulkanFrameTimer& timer) {
+    if(imageIndex >= pendingImages.size() || !pendingImages[imageIndex]) {
+        return false;
+    }
+
+    pendingImages[imageIndex] = false;
+
+    //queries that were never written come back unavailable (VK_NOT_READY) instead of blocking, their availability is checked one by one
+    VkResult result = vkGetQueryPoolResults(device->getInternalLogicalDevice(), queryPool, getFirstQuery(imageIndex), queriesPerImage, results.size() * sizeof(uint64_t),
+                                            results.data(), 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    if(result != VK_SUCCESS && result != VK_NOT_READY) {
+        throw std::runtime_error("failed to read timestamp queries!");
+    }
+
+    const std::pair<uint32_t, FRAME_PHASE> boundaries[] = {
+        {OPAQUE_BEGIN_QUERY, PHASE_GPU_PRE_PASS},
+        {TRANSPARENT_BEGIN_QUERY, PHASE_GPU_OPAQUE},
+        {COMPOSITE_BEGIN_QUERY, PHASE_GPU_TRANSPARENT},
+        {OVERLAY_BEGIN_QUERY, PHASE_GPU_COMPOSITE},
+        {FRAME_END_QUERY, PHASE_GPU_OVERLAY}
+    };
+
+    //each part lasts from the previous boundary to its own
+    for(const std::pair<uint32_t, FRAME_PHASE>& boundary : boundaries) {
+        uint64_t nanoseconds = getElapsedNanoseconds(boundary.first - 1, boundary.first);
+
+        if(nanoseconds > 0) {
+            timer.addSample(boundary.second, nanoseconds);
+        }
+    }
+
+    uint64_t frameNanoseconds = getElapsedNanoseconds(FRAME_BEGIN_QUERY, FRAME_END_QUERY);
+
+    if(frameNanoseconds > 0) {
+        timer.addSample(PHASE_GPU_FRAME, frameNanoseconds);
+    }
+
+    return true;
+}
+
+double VulkanGpuProfiler::getDrawRunMilliseconds(uint32_t beginQuery) {
+    if(beginQuery + 1 >= queriesPerImage) {
+        return 0;
+    }
+
+    return getElapsedNanoseconds(beginQuery, beginQuery + 1) / 1000000.0;
+}
+
+uint64_t VulkanGpuProfiler::getElapsedNanoseconds(uint32_t beginQuery, uint32_t endQuery) {
+    if(results[beginQuery * 2 + 1] == 0 || results[endQuery * 2 + 1] == 0) {
+        return 0;
+    }
+
+    uint64_t begin = results[beginQuery * 2] & timestampMask;
+    uint64_t end = results[endQuery * 2] & timestampMask;
+
+    //the counter wrapped around in between
+    uint64_t ticks = (end - begin) & timestampMask;
+
+    return static_cast<uint64_t>(ticks * nanosecondsPerTick);
+}
\ No newline at end of file
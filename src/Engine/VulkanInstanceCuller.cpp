@@ -0,0 +1,299 @@
+#include "VulkanInstanceCuller.h"
+
+#include <fstream>
+#include <array>
+#include <algorithm>
+
+//the smallest maxComputeWorkGroupCount[0] a device may have, bigger draw lists are culled in several dispatches
+const static uint32_t MAX_DISPATCH_GROUPS = 65535;
+
+VulkanInstanceCuller::VulkanInstanceCuller() {
+
+}
+
+void VulkanInstanceCuller::create(std::shared_ptr<VulkanDevice> device, uint32_t imageCount, uint32_t _drawListCount) {
+    if(hasBeenCreated) {
+        throw std::runtime_error("instance culler has already been created!");
+    }
+
+    drawListCount = _drawListCount;
+
+    VkDevice logicalDevice = device->getInternalLogicalDevice();
+
+    //the UniformBuffer, then source commands, bounds, instances, visible instances and culled commands
+    std::array<VkDescriptorSetLayoutBinding, 6> bindings{};
+
+    for(uint32_t i = 0; i < bindings.size(); ++i) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = (i == 0) ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[i].pImmutableSamplers = nullptr;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if(vkCreateDescriptorSetLayout(logicalDevice, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor set layout for culling!");
+    }
+
+    //the first draw of the dispatch
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(uint32_t);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if(vkCreatePipelineLayout(logicalDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout for culling!");
+    }
+
+    std::vector<char> shaderCode = readFile(computeShader);
+    VkShaderModule shaderModule = createShaderModule(shaderCode, device);
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = pipelineLayout;
+
+    if(vkCreateComputePipelines(logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &computePipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create culling pipeline!");
+    }
+
+    vkDestroyShaderModule(logicalDevice, shaderModule, nullptr);
+
+    uint32_t setCount = imageCount * drawListCount;
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSizes[0].descriptorCount = setCount;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = setCount * 5;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = setCount;
+
+    if(vkCreateDescriptorPool(logicalDevice, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor pool for culling!");
+    }
+
+    images = std::vector<ImageOutputs>(imageCount);
+
+    for(ImageOutputs& image : images) {
+        image.visibleInstances.setKeepCPUCopy(false);
+        image.visibleInstances.setExtraUsage(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        image.visibleInstances.setMemoryTag(VulkanMemoryTag(CATEGORY_OTHER, "culling/visible instances"));
+
+        image.culledCommands = std::vector<VulkanVertexBuffer<VkDrawIndirectCommand>>(drawListCount, VulkanVertexBuffer<VkDrawIndirectCommand>(DEVICE_LOCAL));
+
+        for(VulkanVertexBuffer<VkDrawIndirectCommand>& culledCommands : image.culledCommands) {
+            culledCommands.setKeepCPUCopy(false);
+            culledCommands.setExtraUsage(VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+            culledCommands.setMemoryTag(VulkanMemoryTag(CATEGORY_OTHER, "culling/commands"));
+        }
+
+        std::vector<VkDescriptorSetLayout> layouts = std::vector<VkDescriptorSetLayout>(drawListCount, descriptorSetLayout);
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = descriptorPool;
+        allocInfo.descriptorSetCount = drawListCount;
+        allocInfo.pSetLayouts = layouts.data();
+
+        image.descriptorSets.resize(drawListCount);
+
+        if(vkAllocateDescriptorSets(logicalDevice, &allocInfo, image.descriptorSets.data()) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate descriptor sets for culling!");
+        }
+    }
+
+    hasBeenCreated = true;
+}
+
+void VulkanInstanceCuller::destroyInstanceCuller(std::shared_ptr<VulkanDevice> device) {
+    if(!hasBeenCreated) {
+        return;
+    }
+
+    VkDevice logicalDevice = device->getInternalLogicalDevice();
+
+    for(ImageOutputs& image : images) {
+        image.visibleInstances.destroy(device, nullptr);
+
+        for(VulkanVertexBuffer<VkDrawIndirectCommand>& culledCommands : image.culledCommands) {
+            culledCommands.destroy(device, nullptr);
+        }
+    }
+    images.clear();
+
+    //frees the descriptor sets too
+    vkDestroyDescriptorPool(logicalDevice, descriptorPool, nullptr);
+    vkDestroyPipeline(logicalDevice, computePipeline, nullptr);
+    vkDestroyPipelineLayout(logicalDevice, pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(logicalDevice, descriptorSetLayout, nullptr);
+
+    hasBeenCreated = false;
+}
+
+bool VulkanInstanceCuller::isCreated() {
+    return hasBeenCreated;
+}
+
+uint32_t VulkanInstanceCuller::getImageCount() {
+    return static_cast<uint32_t>(images.size());
+}
+
+void VulkanInstanceCuller::prepareImage(std::shared_ptr<VulkanDevice> device, uint32_t imageIndex, VkBuffer uniformBuffer, VkDeviceSize uniformRange, VulkanVertexBuffer<InstanceData>& instances, std::vector<VulkanIndirectDrawList*>& drawLists, VulkanDeletionQueue* deletionQueue) {
+    if(drawLists.size() != drawListCount) {
+        throw std::runtime_error("instance culler was created for a different number of draw lists!");
+    }
+
+    ImageOutputs& image = images.at(imageIndex);
+
+    for(uint32_t i = 0; i < drawListCount; ++i) {
+        VulkanIndirectDrawList& drawList = *drawLists[i];
+
+        //an empty list has no buffers to bind, and the draws skip it anyway
+        if(drawList.getDrawCount() == 0) {
+            continue;
+        }
+
+        growOutput(device, image.visibleInstances, instances.getBufferSize(), deletionQueue);
+        growOutput(device, image.culledCommands[i], drawList.getMaxDrawCount(), deletionQueue);
+
+        VkDescriptorBufferInfo uniformInfo{};
+        uniformInfo.buffer = uniformBuffer;
+        uniformInfo.offset = 0;
+        uniformInfo.range = uniformRange;
+
+        std::array<VkDescriptorBufferInfo, 5> storageInfos{};
+        storageInfos[0] = {drawList.getCommandBuffer(), 0, VK_WHOLE_SIZE};
+        storageInfos[1] = {drawList.getBoundsBuffer(), 0, VK_WHOLE_SIZE};
+        storageInfos[2] = {instances.getVertexBuffer(), 0, VK_WHOLE_SIZE};
+        storageInfos[3] = {image.visibleInstances.getVertexBuffer(), 0, VK_WHOLE_SIZE};
+        storageInfos[4] = {image.culledCommands[i].getVertexBuffer(), 0, VK_WHOLE_SIZE};
+
+        std::array<VkWriteDescriptorSet, 6> descriptorWrites{};
+
+        for(uint32_t j = 0; j < descriptorWrites.size(); ++j) {
+            descriptorWrites[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[j].dstSet = image.descriptorSets[i];
+            descriptorWrites[j].dstBinding = j;
+            descriptorWrites[j].dstArrayElement = 0;
+            descriptorWrites[j].descriptorType = (j == 0) ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[j].descriptorCount = 1;
+            descriptorWrites[j].pBufferInfo = (j == 0) ? &uniformInfo : &storageInfos[j - 1];
+        }
+
+        vkUpdateDescriptorSets(device->getInternalLogicalDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+}
+
+void VulkanInstanceCuller::recordCulling(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t uniformOffset, std::vector<VulkanIndirectDrawList*>& drawLists) {
+    if(drawLists.size() != drawListCount) {
+        throw std::runtime_error("instance culler was created for a different number of draw lists!");
+    }
+
+    ImageOutputs& image = images.at(imageIndex);
+
+    bool culledAnything = false;
+
+    for(uint32_t i = 0; i < drawListCount; ++i) {
+        VulkanIndirectDrawList& drawList = *drawLists[i];
+
+        //prepareImage left the sets of empty lists alone
+        if(drawList.getDrawCount() == 0) {
+            continue;
+        }
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &image.descriptorSets[i], 1, &uniformOffset);
+
+        for(uint32_t firstDraw = 0; firstDraw < drawList.getDrawCount(); firstDraw += MAX_DISPATCH_GROUPS) {
+            vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &firstDraw);
+            vkCmdDispatch(commandBuffer, std::min(drawList.getDrawCount() - firstDraw, MAX_DISPATCH_GROUPS), 1, 1);
+        }
+
+        culledAnything = true;
+    }
+
+    if(!culledAnything) {
+        return;
+    }
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+VkBuffer VulkanInstanceCuller::getVisibleInstanceBuffer(uint32_t imageIndex) {
+    return images.at(imageIndex).visibleInstances.getVertexBuffer();
+}
+
+VkBuffer VulkanInstanceCuller::getCulledCommandBuffer(uint32_t imageIndex, uint32_t drawListIndex) {
+    return images.at(imageIndex).culledCommands.at(drawListIndex).getVertexBuffer();
+}
+
+template<typename ElementType>
+void VulkanInstanceCuller::growOutput(std::shared_ptr<VulkanDevice> device, VulkanVertexBuffer<ElementType>& output, uint32_t count, VulkanDeletionQueue* deletionQueue) {
+    if(count <= output.getCapacity()) {
+        return;
+    }
+
+    //the old contents are thrown away every frame anyway, so the buffer is replaced instead of resized to skip the copy
+    uint32_t newCapacity = std::max<uint32_t>(count, output.getCapacity() * 2);
+
+    output.destroy(device, deletionQueue);
+    output.resizePreservingContents(device, newCapacity, nullptr);
+}
+
+std::vector<char> VulkanInstanceCuller::readFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+    if(!file.is_open()) {
+        throw std::runtime_error("failed to open file!");
+    }
+
+    size_t fileSize = (size_t) file.tellg();
+    std::vector<char> buffer(fileSize);
+
+    file.seekg(0);
+    file.read(buffer.data(), fileSize);
+
+    file.close();
+
+    return buffer;
+}
+
+VkShaderModule VulkanInstanceCuller::createShaderModule(const std::vector<char>& shaderCode, std::shared_ptr<VulkanDevice> device) {
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+    createInfo.codeSize = shaderCode.size();
+
+    VkShaderModule shader;
+
+    if(vkCreateShaderModule(device->getInternalLogicalDevice(), &createInfo, nullptr, &shader) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shader");
+    }
+
+    return shader;
+}
\ No newline at end of file
@@ -0,0 +1,824 @@
+#include "VulkanMemoryAllocator.h"
+
+#include <algorithm>
+
+VulkanMemoryAllocator::VulkanMemoryAllocator() {
+
+}
+
+void VulkanMemoryAllocator::create(VkPhysicalDevice _physicalDevice, VkDevice _logicalDevice, bool _memoryBudgetExtension) {
+    physicalDevice = _physicalDevice;
+    logicalDevice = _logicalDevice;
+    memoryBudgetExtension = _memoryBudgetExtension;
+
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    detectMemoryArchitecture();
+
+    hasBeenCreated = true;
+
+    updateBudget();
+}
+
+void VulkanMemoryAllocator::destroyMemoryAllocator() {
+    std::lock_guard<std::mutex> lock(allocatorMutex);
+
+    for(std::pair<const uint64_t, MemoryPage>& page : pages) {
+        if(page.second.mappedData != nullptr) {
+            vkUnmapMemory(logicalDevice, page.second.memory);
+        }
+
+        vkFreeMemory(logicalDevice, page.second.memory, nullptr);
+    }
+
+    pages.clear();
+
+    totalUsage = VulkanMemoryUsageStats();
+    categoryUsage.fill(VulkanMemoryUsageStats());
+    ownerUsage.clear();
+
+    heapAllocatorBytes.fill(0);
+    heapOverBudget.fill(false);
+
+    hasBeenCreated = false;
+}
+
+VkDeviceSize VulkanMemoryAllocator::alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    if(alignment <= 1) {
+        return value;
+    }
+
+    return ((value + alignment - 1) / alignment) * alignment;
+}
+
+uint32_t VulkanMemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+    for(uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("couldn't find memory type that matched the requested properties.");
+}
+
+void VulkanMemoryAllocator::detectMemoryArchitecture() {
+    VkPhysicalDeviceProperties deviceProperties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    bool hasDeviceLocalType = false;
+    bool everyDeviceLocalTypeIsHostVisible = true;
+
+    for(uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+
+        if(flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
+            hasDeviceLocalType = true;
+
+            if(!(flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
+                everyDeviceLocalTypeIsHostVisible = false;
+            }
+        }
+    }
+
+    unifiedMemory = deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU || deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU || (hasDeviceLocalType && everyDeviceLocalTypeIsHostVisible);
+
+    resizableBAR = false;
+
+    if(!unifiedMemory) {
+        for(uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+            VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+            VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[i].heapIndex].size;
+
+            //every discrete gpu has the 256MB bar window, it only counts once it covers more than that
+            if((flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) && (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && heapSize > 256ull * 1024 * 1024) {
+                resizableBAR = true;
+            }
+        }
+    }
+}
+
+uint32_t VulkanMemoryAllocator::findMemoryTypeForUsage(uint32_t typeFilter, MEMORY_USAGE usage) {
+    VkMemoryPropertyFlags required = 0;
+    VkMemoryPropertyFlags preferred = 0;
+    VkMemoryPropertyFlags avoided = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT | VK_MEMORY_PROPERTY_PROTECTED_BIT;
+
+    switch(usage) {
+        case USAGE_STATIC_GEOMETRY:
+            preferred = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+            if(unifiedMemory) {
+                //no reason to stage anything when vram and system memory are the same thing
+                preferred |= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+            }else {
+                avoided |= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+            }
+            break;
+        case USAGE_STREAMING:
+            required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+            avoided |= VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+
+            if(unifiedMemory || resizableBAR) {
+                preferred = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+            }
+            break;
+        case USAGE_READBACK:
+            required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+            preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+            break;
+        case USAGE_STAGING:
+            required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+            avoided |= VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+
+            if(!unifiedMemory) {
+                avoided |= VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+            }
+            break;
+    }
+
+    int bestScore = -1;
+    uint32_t bestType = 0;
+    VkDeviceSize bestHeapSize = 0;
+
+    for(uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+
+        if(!(typeFilter & (1 << i)) || (flags & required) != required) {
+            continue;
+        }
+
+        //every preferred flag outweighs all of the avoided ones
+        int score = 64 * __builtin_popcount(flags & preferred) + (32 - __builtin_popcount(flags & avoided));
+
+        VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[i].heapIndex].size;
+
+        if(score > bestScore || (score == bestScore && heapSize > bestHeapSize)) {
+            bestScore = score;
+            bestType = i;
+            bestHeapSize = heapSize;
+        }
+    }
+
+    if(bestScore < 0) {
+        throw std::runtime_error("couldn't find memory type that matched the requested usage.");
+    }
+
+    return bestType;
+}
+
+bool VulkanMemoryAllocator::isUnifiedMemory() {
+    return unifiedMemory;
+}
+
+bool VulkanMemoryAllocator::hasResizableBAR() {
+    return resizableBAR;
+}
+
+const VkPhysicalDeviceMemoryProperties& VulkanMemoryAllocator::getMemoryProperties() {
+    return memoryProperties;
+}
+
+void VulkanMemoryAllocator::setPreferredPageSize(VkDeviceSize size) {
+    std::lock_guard<std::mutex> lock(allocatorMutex);
+
+    preferredPageSize = size;
+}
+
+VkDeviceSize VulkanMemoryAllocator::getPageSizeForType(uint32_t memoryTypeIndex) {
+    VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+
+    //small heaps (e.g. the 256MB BAR heap) would be eaten by a couple of default sized pages
+    if(heapSize <= 1024ull * 1024 * 1024) {
+        return std::min(preferredPageSize, heapSize / 8);
+    }
+
+    return preferredPageSize;
+}
+
+uint64_t VulkanMemoryAllocator::createPage(uint32_t memoryTypeIndex, VkDeviceSize size, bool linear, bool dedicated) {
+    MemoryPage page;
+    page.size = size;
+    page.memoryTypeIndex = memoryTypeIndex;
+    page.linear = linear;
+    page.dedicated = dedicated;
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    if(vkAllocateMemory(logicalDevice, &allocInfo, nullptr, &page.memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate memory page!");
+    }
+
+    if(memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        if(vkMapMemory(logicalDevice, page.memory, 0, size, 0, &page.mappedData) != VK_SUCCESS) {
+            vkFreeMemory(logicalDevice, page.memory, nullptr);
+            throw std::runtime_error("failed to map memory page!");
+        }
+    }
+
+    page.freeBlocks[0] = size;
+
+    uint32_t heapIndex = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+    heapAllocatorBytes[heapIndex] = heapAllocatorBytes[heapIndex] + size;
+
+    uint64_t pageID = nextPageID;
+    ++nextPageID;
+
+    pages[pageID] = page;
+
+    return pageID;
+}
+
+void VulkanMemoryAllocator::releasePage(uint64_t pageID) {
+    MemoryPage& page = pages.at(pageID);
+
+    if(page.mappedData != nullptr) {
+        vkUnmapMemory(logicalDevice, page.memory);
+    }
+
+    vkFreeMemory(logicalDevice, page.memory, nullptr);
+
+    uint32_t heapIndex = memoryProperties.memoryTypes[page.memoryTypeIndex].heapIndex;
+    heapAllocatorBytes[heapIndex] = heapAllocatorBytes[heapIndex] - page.size;
+
+    pages.erase(pageID);
+}
+
+bool VulkanMemoryAllocator::allocateFromPage(MemoryPage& page, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) {
+    for(std::map<VkDeviceSize, VkDeviceSize>::iterator it = page.freeBlocks.begin(); it != page.freeBlocks.end(); ++it) {
+        VkDeviceSize blockOffset = it->first;
+        VkDeviceSize blockSize = it->second;
+
+        VkDeviceSize alignedOffset = alignUp(blockOffset, alignment);
+
+        if(alignedOffset + size > blockOffset + blockSize) {
+            continue;
+        }
+
+        page.freeBlocks.erase(it);
+
+        //the padding in front of the aligned offset stays free so it can merge back later
+        if(alignedOffset > blockOffset) {
+            page.freeBlocks[blockOffset] = alignedOffset - blockOffset;
+        }
+
+        if(alignedOffset + size < blockOffset + blockSize) {
+            page.freeBlocks[alignedOffset + size] = (blockOffset + blockSize) - (alignedOffset + size);
+        }
+
+        page.usedBytes = page.usedBytes + size;
+        ++page.allocationCount;
+
+        offset = alignedOffset;
+        return true;
+    }
+
+    return false;
+}
+
+VulkanMemoryAllocation VulkanMemoryAllocator::allocate(VkMemoryRequirements requirements, VkMemoryPropertyFlags properties, bool linearResource, VulkanMemoryTag tag) {
+    if(!hasBeenCreated) {
+        throw std::runtime_error("you can't allocate memory before the VulkanMemoryAllocator has been created!");
+    }
+
+    return allocateAndRecord(requirements, findMemoryType(requirements.memoryTypeBits, properties), linearResource, tag);
+}
+
+VulkanMemoryAllocation VulkanMemoryAllocator::allocate(VkMemoryRequirements requirements, MEMORY_USAGE usage, bool linearResource, VulkanMemoryTag tag) {
+    if(!hasBeenCreated) {
+        throw std::runtime_error("you can't allocate memory before the VulkanMemoryAllocator has been created!");
+    }
+
+    return allocateAndRecord(requirements, findMemoryTypeForUsage(requirements.memoryTypeBits, usage), linearResource, tag);
+}
+
+VulkanMemoryAllocation VulkanMemoryAllocator::allocateAndRecord(VkMemoryRequirements requirements, uint32_t memoryTypeIndex, bool linearResource, VulkanMemoryTag tag) {
+    VulkanMemoryAllocation allocation;
+
+    {
+        std::lock_guard<std::mutex> lock(allocatorMutex);
+
+        allocation = allocateFromType(requirements, memoryTypeIndex, linearResource);
+        allocation.tag = tag;
+
+        recordAllocation(allocation);
+    }
+
+    //outside the lock so the callback can query stats
+    checkBudgets();
+
+    return allocation;
+}
+
+//allocatorMutex has to be held
+VulkanMemoryAllocation VulkanMemoryAllocator::allocateFromType(VkMemoryRequirements requirements, uint32_t memoryTypeIndex, bool linearResource) {
+    VulkanMemoryAllocation allocation;
+    allocation.memoryTypeIndex = memoryTypeIndex;
+    allocation.size = requirements.size;
+
+    VkDeviceSize pageSize = getPageSizeForType(memoryTypeIndex);
+
+    if(requirements.size > pageSize / 2) {
+        allocation.pageID = createPage(memoryTypeIndex, requirements.size, linearResource, true);
+        MemoryPage& page = pages.at(allocation.pageID);
+
+        page.freeBlocks.clear();
+        page.usedBytes = requirements.size;
+        page.allocationCount = 1;
+
+        allocation.memory = page.memory;
+        allocation.offset = 0;
+        allocation.mappedData = page.mappedData;
+
+        return allocation;
+    }
+
+    for(std::pair<const uint64_t, MemoryPage>& page : pages) {
+        if(page.second.dedicated || page.second.evacuating || page.second.memoryTypeIndex != memoryTypeIndex || page.second.linear != linearResource) {
+            continue;
+        }
+
+        VkDeviceSize offset = 0;
+        if(allocateFromPage(page.second, requirements.size, requirements.alignment, offset)) {
+            allocation.memory = page.second.memory;
+            allocation.offset = offset;
+            allocation.pageID = page.first;
+
+            if(page.second.mappedData != nullptr) {
+                allocation.mappedData = static_cast<char*>(page.second.mappedData) + offset;
+            }
+
+            return allocation;
+        }
+    }
+
+    allocation.pageID = createPage(memoryTypeIndex, pageSize, linearResource, false);
+    MemoryPage& page = pages.at(allocation.pageID);
+
+    VkDeviceSize offset = 0;
+    allocateFromPage(page, requirements.size, requirements.alignment, offset); //can't fail, the page is empty and at least twice as big as the request
+
+    allocation.memory = page.memory;
+    allocation.offset = offset;
+
+    if(page.mappedData != nullptr) {
+        allocation.mappedData = static_cast<char*>(page.mappedData) + offset;
+    }
+
+    return allocation;
+}
+
+void VulkanMemoryAllocator::free(VulkanMemoryAllocation allocation) {
+    if(allocation.memory == VK_NULL_HANDLE) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(allocatorMutex);
+
+    if(pages.count(allocation.pageID) == 0 || pages.at(allocation.pageID).memory != allocation.memory) {
+        throw std::runtime_error("attempted to free memory that wasn't allocated by this VulkanMemoryAllocator!");
+    }
+
+    MemoryPage& page = pages.at(allocation.pageID);
+
+    recordFree(allocation);
+
+    page.usedBytes = page.usedBytes - allocation.size;
+    --page.allocationCount;
+
+    if(page.dedicated) {
+        releasePage(allocation.pageID);
+        return;
+    }
+
+    VkDeviceSize blockOffset = allocation.offset;
+    VkDeviceSize blockSize = allocation.size;
+
+    //merge with the following free block
+    std::map<VkDeviceSize, VkDeviceSize>::iterator next = page.freeBlocks.lower_bound(blockOffset);
+    if(next != page.freeBlocks.end() && next->first == blockOffset + blockSize) {
+        blockSize = blockSize + next->second;
+        next = page.freeBlocks.erase(next);
+    }
+
+    //merge with the preceding free block
+    if(next != page.freeBlocks.begin()) {
+        std::map<VkDeviceSize, VkDeviceSize>::iterator previous = std::prev(next);
+        if(previous->first + previous->second == blockOffset) {
+            blockOffset = previous->first;
+            blockSize = blockSize + previous->second;
+            page.freeBlocks.erase(previous);
+        }
+    }
+
+    page.freeBlocks[blockOffset] = blockSize;
+
+    if(page.evacuating && page.allocationCount == 0) {
+        releasePage(allocation.pageID);
+        return;
+    }
+
+    if(page.allocationCount == 0) {
+        //keep a single empty page per memory type around so a remove/add cycle doesn't hit vkAllocateMemory every time
+        for(std::pair<const uint64_t, MemoryPage>& otherPage : pages) {
+            if(otherPage.first != allocation.pageID && !otherPage.second.dedicated && otherPage.second.allocationCount == 0 && otherPage.second.memoryTypeIndex == page.memoryTypeIndex && otherPage.second.linear == page.linear) {
+                releasePage(allocation.pageID);
+                return;
+            }
+        }
+    }
+}
+
+std::vector<VulkanMemoryPageInfo> VulkanMemoryAllocator::getPageUsage() {
+    std::lock_guard<std::mutex> lock(allocatorMutex);
+
+    std::vector<VulkanMemoryPageInfo> pageUsage;
+
+    for(std::pair<const uint64_t, MemoryPage>& page : pages) {
+        VulkanMemoryPageInfo info{};
+        info.pageID = page.first;
+        info.memoryTypeIndex = page.second.memoryTypeIndex;
+        info.linear = page.second.linear;
+        info.dedicated = page.second.dedicated;
+        info.evacuating = page.second.evacuating;
+        info.size = page.second.size;
+        info.usedBytes = page.second.usedBytes;
+        info.allocationCount = page.second.allocationCount;
+        info.freeBlockCount = page.second.freeBlocks.size();
+
+        for(std::pair<const VkDeviceSize, VkDeviceSize>& block : page.second.freeBlocks) {
+            info.largestFreeBlock = std::max(info.largestFreeBlock, block.second);
+        }
+
+        pageUsage.push_back(info);
+    }
+
+    return pageUsage;
+}
+
+VulkanMemoryStats VulkanMemoryAllocator::getStats() {
+    std::vector<VulkanMemoryPageInfo> pageUsage = getPageUsage();
+
+    VulkanMemoryStats stats;
+
+    VkDeviceSize contiguousFreeBytes = 0;
+
+    for(VulkanMemoryPageInfo& info : pageUsage) {
+        ++stats.pageCount;
+
+        if(info.dedicated) {
+            ++stats.dedicatedPageCount;
+        }
+
+        stats.allocationCount = stats.allocationCount + info.allocationCount;
+        stats.reservedBytes = stats.reservedBytes + info.size;
+        stats.usedBytes = stats.usedBytes + info.usedBytes;
+        stats.freeBlockCount = stats.freeBlockCount + info.freeBlockCount;
+        stats.largestFreeBlock = std::max(stats.largestFreeBlock, info.largestFreeBlock);
+
+        contiguousFreeBytes = contiguousFreeBytes + info.largestFreeBlock;
+    }
+
+    stats.freeBytes = stats.reservedBytes - stats.usedBytes;
+
+    if(stats.freeBytes > 0) {
+        stats.fragmentation = 1.0f - (float) contiguousFreeBytes / (float) stats.freeBytes;
+    }
+
+    return stats;
+}
+
+uint32_t VulkanMemoryAllocator::beginDefragmentation(float maxOccupancy) {
+    std::lock_guard<std::mutex> lock(allocatorMutex);
+
+    for(std::pair<const uint64_t, MemoryPage>& page : pages) {
+        if(page.second.evacuating) {
+            return 0;
+        }
+    }
+
+    //pages that can share allocations, grouped by (memory type, linear)
+    std::map<std::pair<uint32_t, bool>, std::vector<MemoryPage*>> pageGroups;
+
+    for(std::pair<const uint64_t, MemoryPage>& page : pages) {
+        if(!page.second.dedicated) {
+            pageGroups[std::make_pair(page.second.memoryTypeIndex, page.second.linear)].push_back(&page.second);
+        }
+    }
+
+    uint32_t markedPages = 0;
+
+    for(std::pair<const std::pair<uint32_t, bool>, std::vector<MemoryPage*>>& group : pageGroups) {
+        if(group.second.size() < 2) {
+            continue;
+        }
+
+        VkDeviceSize availableBytes = 0;
+
+        for(MemoryPage* page : group.second) {
+            availableBytes = availableBytes + (page->size - page->usedBytes);
+        }
+
+        //emptiest first, those are the cheapest to move
+        std::sort(group.second.begin(), group.second.end(), [](MemoryPage* a, MemoryPage* b) {
+            return a->usedBytes < b->usedBytes;
+        });
+
+        for(MemoryPage* page : group.second) {
+            //empty pages are the ones free() keeps around on purpose
+            if(page->allocationCount == 0) {
+                continue;
+            }
+
+            if((float) page->usedBytes / (float) page->size >= maxOccupancy) {
+                break;
+            }
+
+            VkDeviceSize pageFreeBytes = page->size - page->usedBytes;
+
+            //free space is counted without looking at fragmentation, so leave some room instead of forcing new pages
+            if(availableBytes < pageFreeBytes + page->usedBytes * 2) {
+                break;
+            }
+
+            page->evacuating = true;
+            availableBytes = availableBytes - pageFreeBytes - page->usedBytes;
+            ++markedPages;
+        }
+    }
+
+    return markedPages;
+}
+
+void VulkanMemoryAllocator::endDefragmentation() {
+    std::lock_guard<std::mutex> lock(allocatorMutex);
+
+    for(std::pair<const uint64_t, MemoryPage>& page : pages) {
+        page.second.evacuating = false;
+    }
+}
+
+bool VulkanMemoryAllocator::isDefragmenting() {
+    std::lock_guard<std::mutex> lock(allocatorMutex);
+
+    for(std::pair<const uint64_t, MemoryPage>& page : pages) {
+        if(page.second.evacuating) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool VulkanMemoryAllocator::shouldRelocate(const VulkanMemoryAllocation& allocation) {
+    if(allocation.memory == VK_NULL_HANDLE) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(allocatorMutex);
+
+    std::map<uint64_t, MemoryPage>::iterator page = pages.find(allocation.pageID);
+
+    return page != pages.end() && page->second.evacuating;
+}
+
+static void addToUsage(VulkanMemoryUsageStats& usage, VkDeviceSize size) {
+    usage.liveBytes = usage.liveBytes + size;
+    usage.peakBytes = std::max(usage.peakBytes, usage.liveBytes);
+    ++usage.allocationCount;
+    ++usage.totalAllocationCount;
+}
+
+static void removeFromUsage(VulkanMemoryUsageStats& usage, VkDeviceSize size) {
+    usage.liveBytes = usage.liveBytes - size;
+    --usage.allocationCount;
+}
+
+//allocatorMutex has to be held
+void VulkanMemoryAllocator::recordAllocation(const VulkanMemoryAllocation& allocation) {
+    addToUsage(totalUsage, allocation.size);
+    addToUsage(categoryUsage[allocation.tag.category], allocation.size);
+
+    if(allocation.tag.ownerID != 0) {
+        addToUsage(ownerUsage[allocation.tag.ownerID], allocation.size);
+    }
+}
+
+//allocatorMutex has to be held
+void VulkanMemoryAllocator::recordFree(const VulkanMemoryAllocation& allocation) {
+    removeFromUsage(totalUsage, allocation.size);
+    removeFromUsage(categoryUsage[allocation.tag.category], allocation.size);
+
+    if(allocation.tag.ownerID != 0 && ownerUsage.count(allocation.tag.ownerID) != 0) {
+        VulkanMemoryUsageStats& usage = ownerUsage.at(allocation.tag.ownerID);
+        removeFromUsage(usage, allocation.size);
+
+        if(usage.allocationCount == 0) {
+            ownerUsage.erase(allocation.tag.ownerID);
+        }
+    }
+}
+
+VulkanMemoryUsageStats VulkanMemoryAllocator::getUsageStats() {
+    std::lock_guard<std::mutex> lock(allocatorMutex);
+
+    return totalUsage;
+}
+
+VulkanMemoryUsageStats VulkanMemoryAllocator::getCategoryStats(MEMORY_CATEGORY category) {
+    std::lock_guard<std::mutex> lock(allocatorMutex);
+
+    return categoryUsage[category];
+}
+
+VulkanMemoryUsageStats VulkanMemoryAllocator::getOwnerStats(uint64_t ownerID) {
+    std::lock_guard<std::mutex> lock(allocatorMutex);
+
+    if(ownerUsage.count(ownerID) == 0) {
+        return VulkanMemoryUsageStats();
+    }
+
+    return ownerUsage.at(ownerID);
+}
+
+VulkanMemoryUsageStats VulkanMemoryAllocator::getOwnerStats(const std::string& ownerName) {
+    return getOwnerStats(VulkanMemoryTag::ownerIDFromName(ownerName));
+}
+
+bool VulkanMemoryAllocator::hasMemoryBudgetExtension() {
+    return memoryBudgetExtension;
+}
+
+//allocatorMutex has to be held
+VulkanHeapBudget VulkanMemoryAllocator::getHeapBudget(uint32_t heapIndex) {
+    VulkanHeapBudget heapBudget;
+    heapBudget.heapIndex = heapIndex;
+    heapBudget.deviceLocal = memoryProperties.memoryHeaps[heapIndex].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+    heapBudget.heapSize = memoryProperties.memoryHeaps[heapIndex].size;
+    heapBudget.allocatorBytes = heapAllocatorBytes[heapIndex];
+
+    if(memoryBudgetExtension) {
+        heapBudget.budget = heapDriverBudget[heapIndex];
+
+        //the driver numbers are only as new as the last updateBudget, so account for what we allocated / freed since then ourselves
+        if(heapAllocatorBytes[heapIndex] >= heapAllocatorBytesAtUpdate[heapIndex]) {
+            heapBudget.usage = heapDriverUsage[heapIndex] + (heapAllocatorBytes[heapIndex] - heapAllocatorBytesAtUpdate[heapIndex]);
+        }else {
+            VkDeviceSize freedBytes = heapAllocatorBytesAtUpdate[heapIndex] - heapAllocatorBytes[heapIndex];
+            heapBudget.usage = (heapDriverUsage[heapIndex] > freedBytes) ? heapDriverUsage[heapIndex] - freedBytes : 0;
+        }
+    }else {
+        heapBudget.budget = heapBudget.heapSize / 10 * 8;
+        heapBudget.usage = heapAllocatorBytes[heapIndex];
+    }
+
+    if(heapBudgetOverride[heapIndex] != 0) {
+        heapBudget.budget = heapBudgetOverride[heapIndex];
+    }
+
+    return heapBudget;
+}
+
+std::vector<VulkanHeapBudget> VulkanMemoryAllocator::getHeapBudgets() {
+    std::lock_guard<std::mutex> lock(allocatorMutex);
+
+    std::vector<VulkanHeapBudget> heapBudgets;
+
+    for(uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+        heapBudgets.push_back(getHeapBudget(i));
+    }
+
+    return heapBudgets;
+}
+
+void VulkanMemoryAllocator::updateBudget() {
+    if(memoryBudgetExtension) {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+        budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+        VkPhysicalDeviceMemoryProperties2 memoryProperties2{};
+        memoryProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        memoryProperties2.pNext = &budgetProperties;
+
+        vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &memoryProperties2);
+
+        std::lock_guard<std::mutex> lock(allocatorMutex);
+
+        for(uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+            heapDriverBudget[i] = budgetProperties.heapBudget[i];
+            heapDriverUsage[i] = budgetProperties.heapUsage[i];
+        }
+
+        heapAllocatorBytesAtUpdate = heapAllocatorBytes;
+    }
+
+    checkBudgets();
+}
+
+void VulkanMemoryAllocator::setHeapBudget(uint32_t heapIndex, VkDeviceSize budget) {
+    if(heapIndex >= VK_MAX_MEMORY_HEAPS) {
+        throw std::runtime_error("heap index passed to setHeapBudget is out of range!");
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(allocatorMutex);
+
+        heapBudgetOverride[heapIndex] = budget;
+    }
+
+    checkBudgets();
+}
+
+void VulkanMemoryAllocator::setBudgetExceededCallback(std::function<void(const VulkanHeapBudget&)> callback) {
+    std::lock_guard<std::mutex> lock(allocatorMutex);
+
+    budgetExceededCallback = callback;
+}
+
+void VulkanMemoryAllocator::checkBudgets() {
+    std::vector<VulkanHeapBudget> exceededBudgets;
+    std::function<void(const VulkanHeapBudget&)> callback;
+
+    {
+        std::lock_guard<std::mutex> lock(allocatorMutex);
+
+        for(uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+            VulkanHeapBudget heapBudget = getHeapBudget(i);
+
+            bool overBudget = heapBudget.usage > heapBudget.budget;
+
+            if(overBudget && !heapOverBudget[i]) {
+                exceededBudgets.push_back(heapBudget);
+            }
+
+            heapOverBudget[i] = overBudget;
+        }
+
+        callback = budgetExceededCallback;
+    }
+
+    if(!callback) {
+        return;
+    }
+
+    for(VulkanHeapBudget& heapBudget : exceededBudgets) {
+        callback(heapBudget);
+    }
+}
+
+static const char* getCategoryName(MEMORY_CATEGORY category) {
+    switch(category) {
+        case CATEGORY_OTHER:
+            return "other";
+        case CATEGORY_MODEL:
+            return "models";
+        case CATEGORY_INSTANCE_SET:
+            return "instance sets";
+        case CATEGORY_OVERLAY:
+            return "overlays";
+        case CATEGORY_TEXTURE:
+            return "textures";
+        case CATEGORY_TEXTURE_ARRAY:
+            return "texture arrays";
+        case CATEGORY_UNIFORM:
+            return "uniforms";
+        case CATEGORY_STAGING:
+            return "staging";
+        case CATEGORY_ATTACHMENT:
+            return "attachments";
+        case CATEGORY_COUNT:
+            break;
+    }
+
+    return "unknown";
+}
+
+void VulkanMemoryAllocator::printStats() {
+    VulkanMemoryStats stats = getStats();
+
+    std::cout << "device memory: " << stats.allocationCount << " allocations in " << stats.pageCount << " pages (" << stats.dedicatedPageCount << " dedicated), "
+              << stats.usedBytes / 1024 << "KB used / " << stats.reservedBytes / 1024 << "KB reserved, "
+              << stats.freeBlockCount << " free blocks, largest " << stats.largestFreeBlock / 1024 << "KB, fragmentation " << stats.fragmentation * 100.0f << "%"
+              << (unifiedMemory ? ", unified memory" : "") << (resizableBAR ? ", resizable bar" : "") << std::endl;
+
+    for(VulkanMemoryPageInfo& info : getPageUsage()) {
+        std::cout << "    page " << info.pageID << " (type " << info.memoryTypeIndex << (info.linear ? ", linear" : ", optimal") << (info.dedicated ? ", dedicated" : "") << (info.evacuating ? ", evacuating" : "") << "): "
+                  << info.usedBytes / 1024 << "KB / " << info.size / 1024 << "KB, " << info.allocationCount << " allocations, " << info.freeBlockCount << " free blocks" << std::endl;
+    }
+
+    for(int i = 0; i < CATEGORY_COUNT; i++) {
+        VulkanMemoryUsageStats usage = getCategoryStats((MEMORY_CATEGORY) i);
+
+        if(usage.totalAllocationCount == 0) {
+            continue;
+        }
+
+        std::cout << "    " << getCategoryName((MEMORY_CATEGORY) i) << ": " << usage.liveBytes / 1024 << "KB live, " << usage.peakBytes / 1024 << "KB peak, " << usage.allocationCount << " allocations" << std::endl;
+    }
+
+    for(VulkanHeapBudget& heapBudget : getHeapBudgets()) {
+        std::cout << "    heap " << heapBudget.heapIndex << (heapBudget.deviceLocal ? " (device local)" : "") << ": " << heapBudget.usage / (1024 * 1024) << "MB / " << heapBudget.budget / (1024 * 1024) << "MB budget, "
+                  << heapBudget.allocatorBytes / (1024 * 1024) << "MB from this allocator" << std::endl;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,260 @@
+#include "VulkanParallelRecorder.h"
+
+#include <algorithm>
+
+VulkanParallelRecorder::VulkanParallelRecorder() {
+
+}
+
+void VulkanParallelRecorder::create(std::shared_ptr<VulkanDevice> device, uint32_t threadCount, uint32_t _imageCount) {
+    if(hasBeenCreated) {
+        throw std::runtime_error("parallel recorder has already been created!");
+    }
+
+    logicalDevice = device->getInternalLogicalDevice();
+    imageCount = _imageCount;
+
+    threadCount = std::max<uint32_t>(threadCount, 1);
+
+    threadPools = std::vector<ThreadPools>(threadCount);
+
+    for(ThreadPools& threadPool : threadPools) {
+        threadPool.pools = std::vector<VkCommandPool>(imageCount, VK_NULL_HANDLE);
+        threadPool.buffers = std::vector<std::vector<VkCommandBuffer>>(imageCount);
+        threadPool.usedBuffers = std::vector<size_t>(imageCount, 0);
+
+        for(uint32_t i = 0; i < imageCount; ++i) {
+            VkCommandPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.queueFamilyIndex = device->getGraphicsQueueFamilyIndex();
+            poolInfo.flags = 0;
+
+            if(vkCreateCommandPool(logicalDevice, &poolInfo, nullptr, &threadPool.pools[i]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create command pool for parallel recording!");
+            }
+        }
+    }
+
+    stopWorkers = false;
+    workGeneration = 0;
+
+    //thread 0 is whoever calls record
+    for(uint32_t i = 1; i < threadCount; ++i) {
+        workers.push_back(std::thread(&VulkanParallelRecorder::workerLoop, this, i));
+    }
+
+    hasBeenCreated = true;
+}
+
+void VulkanParallelRecorder::destroyParallelRecorder() {
+    if(!hasBeenCreated) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(workMutex);
+        stopWorkers = true;
+    }
+    workAvailable.notify_all();
+
+    for(std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    //destroying a pool frees every buffer allocated from it
+    for(ThreadPools& threadPool : threadPools) {
+        for(VkCommandPool pool : threadPool.pools) {
+            vkDestroyCommandPool(logicalDevice, pool, nullptr);
+        }
+    }
+    threadPools.clear();
+
+    hasBeenCreated = false;
+}
+
+bool VulkanParallelRecorder::isCreated() {
+    return hasBeenCreated;
+}
+
+uint32_t VulkanParallelRecorder::getThreadCount() {
+    return static_cast<uint32_t>(threadPools.size());
+}
+
+uint32_t VulkanParallelRecorder::getImageCount() {
+    return imageCount;
+}
+
+void VulkanParallelRecorder::resetImage(uint32_t imageIndex) {
+    for(ThreadPools& threadPool : threadPools) {
+        vkResetCommandPool(logicalDevice, threadPool.pools[imageIndex], 0);
+        threadPool.usedBuffers[imageIndex] = 0;
+    }
+}
+
+std::vector<VkCommandBuffer> VulkanParallelRecorder::record(uint32_t imageIndex, VkRenderPass renderPass, VkFramebuffer framebuffer, std::vector<VulkanRecordJob>& jobs) {
+    std::vector<VkCommandBuffer> results = std::vector<VkCommandBuffer>(jobs.size(), VK_NULL_HANDLE);
+
+    if(jobs.empty()) {
+        return results;
+    }
+
+    currentJobs = &jobs;
+    currentResults = &results;
+    currentImage = imageIndex;
+    currentRenderPass = renderPass;
+    currentFramebuffer = framebuffer;
+
+    runBatch(jobs.size());
+
+    currentJobs = nullptr;
+    currentResults = nullptr;
+
+    if(firstError != nullptr) {
+        std::rethrow_exception(firstError);
+    }
+
+    return results;
+}
+
+void VulkanParallelRecorder::runTasks(std::vector<std::function<void()>>& tasks) {
+    if(tasks.empty()) {
+        return;
+    }
+
+    currentTasks = &tasks;
+
+    runBatch(tasks.size());
+
+    currentTasks = nullptr;
+
+    if(firstError != nullptr) {
+        std::rethrow_exception(firstError);
+    }
+}
+
+void VulkanParallelRecorder::runBatch(size_t count) {
+    firstError = nullptr;
+    nextJob = 0;
+
+    //a single job isn't worth waking anyone up for
+    bool useWorkers = !workers.empty() && count > 1;
+
+    if(useWorkers) {
+        {
+            std::lock_guard<std::mutex> lock(workMutex);
+            ++workGeneration;
+            busyWorkers = static_cast<uint32_t>(workers.size());
+        }
+        workAvailable.notify_all();
+    }
+
+    runJobs(0);
+
+    if(useWorkers) {
+        std::unique_lock<std::mutex> lock(workMutex);
+        workFinished.wait(lock, [&]() { return busyWorkers == 0; });
+    }
+}
+
+void VulkanParallelRecorder::workerLoop(uint32_t threadIndex) {
+    uint64_t seenGeneration = 0;
+
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(workMutex);
+            workAvailable.wait(lock, [&]() { return stopWorkers || workGeneration != seenGeneration; });
+
+            if(stopWorkers) {
+                return;
+            }
+
+            seenGeneration = workGeneration;
+        }
+
+        runJobs(threadIndex);
+
+        {
+            std::lock_guard<std::mutex> lock(workMutex);
+            --busyWorkers;
+        }
+        workFinished.notify_one();
+    }
+}
+
+void VulkanParallelRecorder::runJobs(uint32_t threadIndex) {
+    size_t jobCount = (currentTasks != nullptr) ? currentTasks->size() : currentJobs->size();
+
+    while(true) {
+        size_t jobIndex = nextJob.fetch_add(1);
+
+        if(jobIndex >= jobCount) {
+            return;
+        }
+
+        try {
+            if(currentTasks != nullptr) {
+                currentTasks->at(jobIndex)();
+                continue;
+            }
+
+            VulkanRecordJob& job = currentJobs->at(jobIndex);
+
+            VkCommandBuffer commandBuffer = acquireBuffer(threadIndex);
+
+            VkCommandBufferInheritanceInfo inheritanceInfo{};
+            inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+            inheritanceInfo.renderPass = currentRenderPass;
+            inheritanceInfo.subpass = job.subpass;
+            inheritanceInfo.framebuffer = currentFramebuffer;
+
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+            beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+            if(vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+                throw std::runtime_error("failed to begin recording secondary command buffer!");
+            }
+
+            job.record(commandBuffer);
+
+            if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to record secondary command buffer!");
+            }
+
+            currentResults->at(jobIndex) = commandBuffer;
+        }catch(...) {
+            std::lock_guard<std::mutex> lock(workMutex);
+
+            if(firstError == nullptr) {
+                firstError = std::current_exception();
+            }
+        }
+    }
+}
+
+VkCommandBuffer VulkanParallelRecorder::acquireBuffer(uint32_t threadIndex) {
+    ThreadPools& threadPool = threadPools[threadIndex];
+
+    std::vector<VkCommandBuffer>& buffers = threadPool.buffers[currentImage];
+    size_t& usedBuffers = threadPool.usedBuffers[currentImage];
+
+    if(usedBuffers == buffers.size()) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = threadPool.pools[currentImage];
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+
+        if(vkAllocateCommandBuffers(logicalDevice, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate secondary command buffer!");
+        }
+
+        buffers.push_back(commandBuffer);
+    }
+
+    return buffers[usedBuffers++];
+}
\ No newline at end of file
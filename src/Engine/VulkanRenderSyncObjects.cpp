@@ -1,14 +1,25 @@
 #include <VulkanRenderSyncObjects.h>
 
+#include <algorithm>
+
 VulkanRenderSyncObjects::VulkanRenderSyncObjects() {
 
 }
 
 void VulkanRenderSyncObjects::create(std::shared_ptr<VulkanDevice> device, std::shared_ptr<VulkanSwapchain> swapchain) {
-    imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-    imagesInFlight.resize(swapchain->getSwapchainImageCount(), VK_NULL_HANDLE);
+    imagesInFlight = std::vector<VkFence>(swapchain->getSwapchainImageCount(), VK_NULL_HANDLE);
+
+    createFrameObjects(device);
+
+    hasBeenCreated = true;
+}
+
+void VulkanRenderSyncObjects::createFrameObjects(std::shared_ptr<VulkanDevice> device) {
+    imageAvailableSemaphores = std::vector<VkSemaphore>(maxFramesInFlight);
+    renderFinishedSemaphores = std::vector<VkSemaphore>(maxFramesInFlight);
+    inFlightFences = std::vector<VkFence>(maxFramesInFlight);
+    frameCommandPools = std::vector<FrameCommandPool>(maxFramesInFlight);
+    frameTimelineValues = std::vector<uint64_t>(maxFramesInFlight, 0);
 
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -17,16 +28,24 @@ void VulkanRenderSyncObjects::create(std::shared_ptr<VulkanDevice> device, std::
     fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    for(size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for(int i = 0; i < maxFramesInFlight; i++) {
         if(vkCreateSemaphore(device->getInternalLogicalDevice(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
             vkCreateSemaphore(device->getInternalLogicalDevice(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
             vkCreateFence(device->getInternalLogicalDevice(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
 
             throw std::runtime_error("failed to create synchronization objects for a frame!");
         }
-    }
 
-    hasBeenCreated = true;
+        //buffers are only ever reset together with the whole pool
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = device->getGraphicsQueueFamilyIndex();
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+        if(vkCreateCommandPool(device->getInternalLogicalDevice(), &poolInfo, nullptr, &frameCommandPools[i].pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create command pool for a frame!");
+        }
+    }
 }
 
 std::vector<VkSemaphore>& VulkanRenderSyncObjects::getInternalImageAvailableSemaphores() {
@@ -45,14 +64,94 @@ std::vector<VkFence>& VulkanRenderSyncObjects::getInternalImagesInFlight() {
     return imagesInFlight;
 }
 
+uint64_t VulkanRenderSyncObjects::getFrameTimelineValue(size_t frame) {
+    return frameTimelineValues.at(frame);
+}
+
+void VulkanRenderSyncObjects::setFrameTimelineValue(size_t frame, uint64_t value) {
+    frameTimelineValues.at(frame) = value;
+}
+
+void VulkanRenderSyncObjects::resetFrameCommandPool(std::shared_ptr<VulkanDevice> device, size_t frame) {
+    FrameCommandPool& frameCommandPool = frameCommandPools.at(frame);
+
+    vkResetCommandPool(device->getInternalLogicalDevice(), frameCommandPool.pool, 0);
+
+    frameCommandPool.usedBuffers[VK_COMMAND_BUFFER_LEVEL_PRIMARY] = 0;
+    frameCommandPool.usedBuffers[VK_COMMAND_BUFFER_LEVEL_SECONDARY] = 0;
+}
+
+VkCommandBuffer VulkanRenderSyncObjects::acquireFrameCommandBuffer(std::shared_ptr<VulkanDevice> device, size_t frame, VkCommandBufferLevel level) {
+    FrameCommandPool& frameCommandPool = frameCommandPools.at(frame);
+
+    std::vector<VkCommandBuffer>& buffers = frameCommandPool.buffers[level];
+    size_t& usedBuffers = frameCommandPool.usedBuffers[level];
+
+    if(usedBuffers == buffers.size()) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = frameCommandPool.pool;
+        allocInfo.level = level;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+
+        if(vkAllocateCommandBuffers(device->getInternalLogicalDevice(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate command buffer for a frame!");
+        }
+
+        buffers.push_back(commandBuffer);
+    }
+
+    return buffers[usedBuffers++];
+}
+
+int VulkanRenderSyncObjects::getMaxFramesInFlight() {
+    return maxFramesInFlight;
+}
+
+void VulkanRenderSyncObjects::setMaxFramesInFlight(std::shared_ptr<VulkanDevice> device, int framesInFlight) {
+    if(framesInFlight < 1) {
+        throw std::runtime_error("at least one frame has to be in flight!");
+    }
+
+    if(framesInFlight == maxFramesInFlight) {
+        return;
+    }
+
+    maxFramesInFlight = framesInFlight;
+
+    if(!hasBeenCreated) {
+        return;
+    }
+
+    destroyFrameObjects(device);
+    createFrameObjects(device);
+
+    std::fill(imagesInFlight.begin(), imagesInFlight.end(), VK_NULL_HANDLE);
+}
+
 bool VulkanRenderSyncObjects::isCreated() {
     return hasBeenCreated;
 }
 
 void VulkanRenderSyncObjects::destroySyncObjects(std::shared_ptr<VulkanDevice> device) {
-    for(size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    destroyFrameObjects(device);
+}
+
+void VulkanRenderSyncObjects::destroyFrameObjects(std::shared_ptr<VulkanDevice> device) {
+    for(size_t i = 0; i < inFlightFences.size(); i++) {
         vkDestroySemaphore(device->getInternalLogicalDevice(), renderFinishedSemaphores[i], nullptr);
         vkDestroySemaphore(device->getInternalLogicalDevice(), imageAvailableSemaphores[i], nullptr);
         vkDestroyFence(device->getInternalLogicalDevice(), inFlightFences[i], nullptr);
+
+        //destroying the pool frees its buffers too
+        vkDestroyCommandPool(device->getInternalLogicalDevice(), frameCommandPools[i].pool, nullptr);
     }
+
+    imageAvailableSemaphores.clear();
+    renderFinishedSemaphores.clear();
+    inFlightFences.clear();
+    frameCommandPools.clear();
+    frameTimelineValues.clear();
 }
\ No newline at end of file
@@ -0,0 +1,333 @@
+#include "VulkanStagingRing.h"
+
+#include <cstring>
+#include <algorithm>
+
+VulkanStagingRing::VulkanStagingRing() {
+
+}
+
+void VulkanStagingRing::create(VkDevice _logicalDevice, std::shared_ptr<VulkanMemoryAllocator> _allocator, VkCommandPool _commandPool, VkQueue _queue, VkDeviceSize _capacity) {
+    logicalDevice = _logicalDevice;
+    allocator = _allocator;
+    commandPool = _commandPool;
+    queue = _queue;
+
+    createRingBuffer(_capacity);
+
+    hasBeenCreated = true;
+}
+
+void VulkanStagingRing::destroyStagingRing() {
+    if(!hasBeenCreated) {
+        return;
+    }
+
+    destroyRingBuffer();
+
+    pendingCopies.clear();
+    submissionMarkers.clear();
+    head = 0;
+    tail = 0;
+
+    hasBeenCreated = false;
+}
+
+void VulkanStagingRing::createRingBuffer(VkDeviceSize size) {
+    //keep every reservation aligned, including the ones that wrap around to offset 0
+    capacity = ((size + RING_ALIGNMENT - 1) / RING_ALIGNMENT) * RING_ALIGNMENT;
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = capacity;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if(vkCreateBuffer(logicalDevice, &bufferInfo, nullptr, &ringBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create staging ring buffer!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(logicalDevice, ringBuffer, &memRequirements);
+
+    ringMemory = allocator->allocate(memRequirements, USAGE_STAGING, true, VulkanMemoryTag(CATEGORY_STAGING));
+
+    vkBindBufferMemory(logicalDevice, ringBuffer, ringMemory.memory, ringMemory.offset);
+
+    head = 0;
+    tail = 0;
+}
+
+void VulkanStagingRing::destroyRingBuffer() {
+    if(ringBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(logicalDevice, ringBuffer, nullptr);
+        ringBuffer = VK_NULL_HANDLE;
+    }
+
+    allocator->free(ringMemory);
+    ringMemory = VulkanMemoryAllocation();
+}
+
+bool VulkanStagingRing::reserve(VkDeviceSize size, VkDeviceSize& offset) {
+    uint64_t start = ((head + RING_ALIGNMENT - 1) / RING_ALIGNMENT) * RING_ALIGNMENT;
+
+    //never split a copy across the end of the ring, skip ahead to the start of the next lap instead
+    if((start % capacity) + size > capacity) {
+        start = ((start + capacity - 1) / capacity) * capacity;
+    }
+
+    if(start + size - tail > capacity) {
+        return false;
+    }
+
+    head = start + size;
+    offset = start % capacity;
+    return true;
+}
+
+void VulkanStagingRing::stage(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size) {
+    if(size == 0) {
+        return;
+    }
+
+    std::memcpy(stageInPlace(dstBuffer, dstOffset, size), data, (size_t) size);
+}
+
+void* VulkanStagingRing::stageInPlace(VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size) {
+    if(size > capacity) {
+        flushImmediately();
+        destroyRingBuffer();
+        createRingBuffer(size * 2);
+    }
+
+    VkDeviceSize offset = 0;
+
+    if(!reserve(size, offset)) {
+        //out of space before the next frame, so stall once instead of overwriting data the gpu hasn't read yet
+        flushImmediately();
+
+        if(!reserve(size, offset)) {
+            throw std::runtime_error("failed to reserve space in staging ring!");
+        }
+    }
+
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = offset;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size = size;
+
+    addCopyRegion(pendingCopies[dstBuffer], copyRegion);
+
+    return static_cast<char*>(ringMemory.mappedData) + offset;
+}
+
+void VulkanStagingRing::addCopyRegion(std::map<VkDeviceSize, VkBufferCopy>& regions, VkBufferCopy region) {
+    VkDeviceSize regionEnd = region.dstOffset + region.size;
+
+    //cut whatever the new region overwrites out of the regions that are already queued, copies within one vkCmdCopyBuffer can't overlap
+    auto iterator = regions.lower_bound(region.dstOffset);
+    if(iterator != regions.begin()) {
+        std::advance(iterator, -1);
+    }
+
+    while(iterator != regions.end() && iterator->second.dstOffset < regionEnd) {
+        VkBufferCopy existing = iterator->second;
+        VkDeviceSize existingEnd = existing.dstOffset + existing.size;
+
+        if(existingEnd <= region.dstOffset) {
+            std::advance(iterator, 1);
+            continue;
+        }
+
+        iterator = regions.erase(iterator);
+
+        if(existing.dstOffset < region.dstOffset) {
+            VkBufferCopy front = existing;
+            front.size = region.dstOffset - existing.dstOffset;
+            regions[front.dstOffset] = front;
+        }
+
+        if(existingEnd > regionEnd) {
+            VkBufferCopy back = existing;
+            back.srcOffset = existing.srcOffset + (regionEnd - existing.dstOffset);
+            back.dstOffset = regionEnd;
+            back.size = existingEnd - regionEnd;
+            iterator = regions.insert(std::make_pair(back.dstOffset, back)).first;
+        }
+    }
+
+    //merge with the neighbours when the bytes are also contiguous in the ring
+    auto next = regions.find(regionEnd);
+    if(next != regions.end() && next->second.srcOffset == region.srcOffset + region.size) {
+        region.size += next->second.size;
+        regions.erase(next);
+    }
+
+    auto previous = regions.lower_bound(region.dstOffset);
+    if(previous != regions.begin()) {
+        std::advance(previous, -1);
+
+        if(previous->second.dstOffset + previous->second.size == region.dstOffset && previous->second.srcOffset + previous->second.size == region.srcOffset) {
+            previous->second.size += region.size;
+            return;
+        }
+    }
+
+    regions[region.dstOffset] = region;
+}
+
+void VulkanStagingRing::cancelUploads(VkBuffer dstBuffer) {
+    //the ring space stays reserved until the next frame finishes, which is fine
+    pendingCopies.erase(dstBuffer);
+
+    pendingMoves.erase(std::remove_if(pendingMoves.begin(), pendingMoves.end(), [dstBuffer](BufferMove& move) {
+        return move.dstBuffer == dstBuffer;
+    }), pendingMoves.end());
+}
+
+void VulkanStagingRing::moveBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
+    if(size == 0) {
+        return;
+    }
+
+    //srcBuffer only gets its contents from a move queued in this batch, so copy straight from where that move would have read
+    for(BufferMove& move : pendingMoves) {
+        if(move.dstBuffer == srcBuffer) {
+            move.dstBuffer = dstBuffer;
+            move.size = std::min(move.size, size);
+            return;
+        }
+    }
+
+    pendingMoves.push_back({srcBuffer, dstBuffer, size});
+}
+
+void VulkanStagingRing::retargetUploads(VkBuffer oldBuffer, VkBuffer newBuffer) {
+    if(pendingCopies.count(oldBuffer) == 0) {
+        return;
+    }
+
+    std::map<VkDeviceSize, VkBufferCopy>& newRegions = pendingCopies[newBuffer];
+
+    for(std::pair<const VkDeviceSize, VkBufferCopy>& region : pendingCopies.at(oldBuffer)) {
+        addCopyRegion(newRegions, region.second);
+    }
+
+    pendingCopies.erase(oldBuffer);
+}
+
+void VulkanStagingRing::recordCopies(VkCommandBuffer commandBuffer) {
+    //last frame's draws may still be reading the buffers we are about to overwrite
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+    if(!pendingMoves.empty()) {
+        //the buffers being moved may have been filled by an earlier batch
+        VkMemoryBarrier moveBarrier{};
+        moveBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        moveBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        moveBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &moveBarrier, 0, nullptr, 0, nullptr);
+
+        for(BufferMove& move : pendingMoves) {
+            VkBufferCopy copyRegion{};
+            copyRegion.size = move.size;
+
+            vkCmdCopyBuffer(commandBuffer, move.srcBuffer, move.dstBuffer, 1, &copyRegion);
+        }
+
+        //staged copies into the moved buffers have to land on top of the moved contents
+        moveBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &moveBarrier, 0, nullptr, 0, nullptr);
+
+        pendingMoves.clear();
+    }
+
+    std::vector<VkBufferCopy> copyRegions = std::vector<VkBufferCopy>();
+
+    for(std::pair<const VkBuffer, std::map<VkDeviceSize, VkBufferCopy>>& copies : pendingCopies) {
+        copyRegions.clear();
+
+        for(std::pair<const VkDeviceSize, VkBufferCopy>& region : copies.second) {
+            copyRegions.push_back(region.second);
+        }
+
+        vkCmdCopyBuffer(commandBuffer, ringBuffer, copies.first, static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
+    }
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+    //compute covers the culling pass, which reads instances and draw commands before the render pass
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    pendingCopies.clear();
+}
+
+void VulkanStagingRing::recordUploads(VkCommandBuffer commandBuffer, uint64_t submission) {
+    if(!hasPendingUploads()) {
+        return;
+    }
+
+    recordCopies(commandBuffer);
+
+    submissionMarkers.push_back(std::make_pair(submission, head));
+}
+
+void VulkanStagingRing::releaseSubmissions(uint64_t completedSubmission) {
+    //markers are in submission order, so the finished ones are all at the front
+    while(!submissionMarkers.empty() && submissionMarkers.front().first <= completedSubmission) {
+        tail = submissionMarkers.front().second;
+        submissionMarkers.pop_front();
+    }
+}
+
+void VulkanStagingRing::flushImmediately() {
+    if(hasPendingUploads()) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = commandPool;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        vkAllocateCommandBuffers(logicalDevice, &allocInfo, &commandBuffer);
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+        recordCopies(commandBuffer);
+
+        vkEndCommandBuffer(commandBuffer);
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+
+        vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+        vkQueueWaitIdle(queue);
+
+        vkFreeCommandBuffers(logicalDevice, commandPool, 1, &commandBuffer);
+    }else {
+        vkQueueWaitIdle(queue);
+    }
+
+    //the queue is idle, so nothing in the ring is in use anymore
+    submissionMarkers.clear();
+    tail = head;
+}
+
+bool VulkanStagingRing::hasPendingUploads() {
+    return !pendingCopies.empty() || !pendingMoves.empty();
+}
+
+VkDeviceSize VulkanStagingRing::getCapacity() {
+    return capacity;
+}
\ No newline at end of file
@@ -11,8 +11,6 @@ VulkanSwapchain::VulkanSwapchain() {
 }
 
 void VulkanSwapchain::destroySwapchain(std::shared_ptr<VulkanDevice> device) {
-    vkFreeCommandBuffers(device->getInternalLogicalDevice(), device->getInternalCommandPool(), static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
-
     for(auto framebuffer : swapChainFramebuffers) {
         vkDestroyFramebuffer(device->getInternalLogicalDevice(), framebuffer, nullptr);
     }
@@ -28,7 +26,7 @@ void VulkanSwapchain::destroySwapchain(std::shared_ptr<VulkanDevice> device) {
             if(!SWAPCHAIN_ATTACHMENT) { //don't destroy the first attachment here b/c it's the swapchain, and should be destroyed automatically
                 vkDestroyImage(device->getInternalLogicalDevice(), attachment.image, nullptr);
 
-                vkFreeMemory(device->getInternalLogicalDevice(), attachment.memory, nullptr);
+                device->getMemoryAllocator()->free(attachment.memory);
             }
         }
         SWAPCHAIN_ATTACHMENT = false;
@@ -43,7 +41,6 @@ void VulkanSwapchain::create(std::shared_ptr<VulkanInstance> vkInstance, std::sh
     createUserDefinedAttachments(vkDevice);
     createRenderpass(vkInstance, vkDisplay, vkDevice);
     createFramebuffers(vkDevice);
-    createCommandBuffers(vkDevice);
     hasBeenCreated = true;
 }
 
@@ -258,24 +255,6 @@ std::vector<VkFramebuffer>& VulkanSwapchain::getInternalFramebuffers() {
     return swapChainFramebuffers;
 }
 
-void VulkanSwapchain::createCommandBuffers(std::shared_ptr<VulkanDevice> device) {
-    commandBuffers.resize(swapchainImageCount);
-
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = device->getInternalCommandPool();
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = (uint32_t) commandBuffers.size();
-
-    if(vkAllocateCommandBuffers(device->getInternalLogicalDevice(), &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate command buffers!");
-    }
-}
-
-std::vector<VkCommandBuffer>& VulkanSwapchain::getInternalCommandBuffers() {
-    return commandBuffers;
-}
-
 bool hasStencilComponent(VkFormat format) {
     return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
 }
@@ -296,16 +275,7 @@ VkFormat VulkanSwapchain::findSupportedFormat(const std::vector<VkFormat>& candi
 }
 
 uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, std::shared_ptr<VulkanDevice>& device) {
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(device->getInternalPhysicalDevice(), &memProperties);
-
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
-        }
-    }
-
-    throw std::runtime_error("couldn't find memory type that matched the requested properties.");
+    return device->getMemoryAllocator()->findMemoryType(typeFilter, properties);
 }
 
 VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, std::shared_ptr<VulkanDevice> device) {
@@ -336,7 +306,7 @@ void VulkanSwapchain::createUserDefinedAttachments(std::shared_ptr<VulkanDevice>
             FramebufferAttachment attachment;
 
             attachment.format = findSupportedFormat(info.formatCandidates, info.imageTiling, info.formatFeatures, device);
-            VulkanEngine::createImage(swapChainExtent.width, swapChainExtent.height, 1, attachment.format, info.imageTiling, info.usageBits, info.memoryPropertyBits, attachment.image, attachment.memory, device);
+            VulkanEngine::createImage(swapChainExtent.width, swapChainExtent.height, 1, attachment.format, info.imageTiling, info.usageBits, info.memoryPropertyBits, attachment.image, attachment.memory, device, VulkanMemoryTag(CATEGORY_ATTACHMENT));
             attachment.imageView = createImageView(attachment.image, attachment.format, info.imageAspectBits, device);
 
             attachmentVector.push_back(attachment);
@@ -0,0 +1,87 @@
+#include "VulkanUniformRing.h"
+#include "VulkanEngine.h"
+
+#include <cstring>
+#include <algorithm>
+
+VulkanUniformRing::VulkanUniformRing() {
+
+}
+
+void VulkanUniformRing::create(std::shared_ptr<VulkanDevice> device, VkDeviceSize _regionSize, uint32_t _regionCount) {
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(device->getInternalPhysicalDevice(), &properties);
+
+    alignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 1);
+
+    regionSize = alignSize(_regionSize);
+    regionCount = _regionCount;
+
+    VulkanEngine::createBuffer(regionSize * regionCount, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, USAGE_STREAMING, uniformBuffer, uniformBufferMemory, device, VulkanMemoryTag(CATEGORY_UNIFORM));
+
+    currentRegion = 0;
+    regionCursor = 0;
+
+    hasBeenCreated = true;
+}
+
+void VulkanUniformRing::destroyUniformRing(std::shared_ptr<VulkanDevice> device) {
+    if(!hasBeenCreated) {
+        return;
+    }
+
+    vkDestroyBuffer(device->getInternalLogicalDevice(), uniformBuffer, nullptr);
+    device->getMemoryAllocator()->free(uniformBufferMemory);
+
+    uniformBuffer = VK_NULL_HANDLE;
+    uniformBufferMemory = VulkanMemoryAllocation();
+
+    hasBeenCreated = false;
+}
+
+bool VulkanUniformRing::isCreated() {
+    return hasBeenCreated;
+}
+
+void VulkanUniformRing::write(uint32_t offset, const void* data, VkDeviceSize size) {
+    std::memcpy(static_cast<char*>(uniformBufferMemory.mappedData) + offset, data, (size_t) size);
+}
+
+void VulkanUniformRing::beginRegion(uint32_t region, VkDeviceSize reservedBytes) {
+    currentRegion = region;
+    regionCursor = alignSize(reservedBytes);
+}
+
+uint32_t VulkanUniformRing::push(const void* data, VkDeviceSize size) {
+    if(regionCursor + size > regionSize) {
+        throw std::runtime_error("ran out of space in uniform ring region!");
+    }
+
+    uint32_t offset = getRegionOffset(currentRegion) + static_cast<uint32_t>(regionCursor);
+
+    write(offset, data, size);
+
+    regionCursor += alignSize(size);
+
+    return offset;
+}
+
+uint32_t VulkanUniformRing::getRegionOffset(uint32_t region) {
+    return static_cast<uint32_t>(regionSize * region);
+}
+
+VkDeviceSize VulkanUniformRing::alignSize(VkDeviceSize size) {
+    return ((size + alignment - 1) / alignment) * alignment;
+}
+
+VkBuffer VulkanUniformRing::getUniformBuffer() {
+    return uniformBuffer;
+}
+
+uint32_t VulkanUniformRing::getRegionCount() {
+    return regionCount;
+}
+
+VkDeviceSize VulkanUniformRing::getRegionSize() {
+    return regionSize;
+}
\ No newline at end of file
@@ -0,0 +1,345 @@
+#include "VulkanUploadService.h"
+
+#include <cstring>
+#include <stdexcept>
+
+VulkanUploadService::VulkanUploadService() {
+
+}
+
+void VulkanUploadService::create(VkDevice _logicalDevice, std::shared_ptr<VulkanMemoryAllocator> _allocator, std::shared_ptr<VulkanDeletionQueue> _deletionQueue, uint32_t _graphicsFamily, VkQueue graphicsQueue, std::optional<uint32_t> transferFamily, VkQueue transferQueue) {
+    logicalDevice = _logicalDevice;
+    allocator = _allocator;
+    deletionQueue = _deletionQueue;
+    graphicsFamily = _graphicsFamily;
+
+    transferQueueUsed = transferFamily.has_value();
+    uploadFamily = (transferQueueUsed) ? transferFamily.value() : graphicsFamily;
+    uploadQueue = (transferQueueUsed) ? transferQueue : graphicsQueue;
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = uploadFamily;
+    //every command buffer is recorded once and freed as soon as its upload is done
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    if(vkCreateCommandPool(logicalDevice, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload command pool!");
+    }
+
+    hasBeenCreated = true;
+}
+
+void VulkanUploadService::destroyUploadService() {
+    if(!hasBeenCreated) {
+        return;
+    }
+
+    for(Upload& upload : inFlightUploads) {
+        finishUpload(upload);
+    }
+
+    inFlightUploads.clear();
+
+    //released to a frame that never came
+    for(VkSemaphore semaphore : acquireSemaphores) {
+        vkDestroySemaphore(logicalDevice, semaphore, nullptr);
+    }
+
+    acquireSemaphores.clear();
+    acquireImageBarriers.clear();
+    acquireBufferBarriers.clear();
+
+    for(VkFence fence : freeFences) {
+        vkDestroyFence(logicalDevice, fence, nullptr);
+    }
+
+    freeFences.clear();
+
+    vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
+    commandPool = VK_NULL_HANDLE;
+
+    completedToken = nextToken - 1;
+
+    hasBeenCreated = false;
+}
+
+VulkanUploadService::Upload VulkanUploadService::beginUpload(VkDeviceSize size) {
+    Upload upload;
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if(vkCreateBuffer(logicalDevice, &bufferInfo, nullptr, &upload.stagingBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload staging buffer!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(logicalDevice, upload.stagingBuffer, &memRequirements);
+
+    upload.stagingMemory = allocator->allocate(memRequirements, USAGE_STAGING, true, VulkanMemoryTag(CATEGORY_STAGING));
+
+    vkBindBufferMemory(logicalDevice, upload.stagingBuffer, upload.stagingMemory.memory, upload.stagingMemory.offset);
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    if(vkAllocateCommandBuffers(logicalDevice, &allocInfo, &upload.commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate upload command buffer!");
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(upload.commandBuffer, &beginInfo);
+
+    return upload;
+}
+
+VulkanUploadToken VulkanUploadService::submitUpload(Upload& upload) {
+    vkEndCommandBuffer(upload.commandBuffer);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &upload.commandBuffer;
+
+    VkSemaphore releaseSemaphore = VK_NULL_HANDLE;
+
+    if(transferQueueUsed) {
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        if(vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &releaseSemaphore) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upload semaphore!");
+        }
+
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &releaseSemaphore;
+    }
+
+    upload.fence = getFence();
+
+    if(vkQueueSubmit(uploadQueue, 1, &submitInfo, upload.fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit upload!");
+    }
+
+    if(transferQueueUsed) {
+        acquireSemaphores.push_back(releaseSemaphore);
+    }
+
+    upload.token = nextToken++;
+    inFlightUploads.push_back(upload);
+
+    return upload.token;
+}
+
+void VulkanUploadService::finishUpload(Upload& upload) {
+    vkFreeCommandBuffers(logicalDevice, commandPool, 1, &upload.commandBuffer);
+
+    vkDestroyBuffer(logicalDevice, upload.stagingBuffer, nullptr);
+    allocator->free(upload.stagingMemory);
+
+    vkResetFences(logicalDevice, 1, &upload.fence);
+    freeFences.push_back(upload.fence);
+}
+
+VkFence VulkanUploadService::getFence() {
+    if(!freeFences.empty()) {
+        VkFence fence = freeFences.back();
+        freeFences.pop_back();
+        return fence;
+    }
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VkFence fence;
+
+    if(vkCreateFence(logicalDevice, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload fence!");
+    }
+
+    return fence;
+}
+
+VulkanUploadToken VulkanUploadService::uploadImage(VkImage image, uint32_t width, uint32_t height, const std::vector<const void*>& layers, VkDeviceSize layerSize) {
+    if(layers.empty()) {
+        return 0;
+    }
+
+    Upload upload = beginUpload(layerSize * layers.size());
+
+    std::vector<VkBufferImageCopy> regions = std::vector<VkBufferImageCopy>();
+
+    for(size_t layer = 0; layer < layers.size(); ++layer) {
+        std::memcpy(static_cast<char*>(upload.stagingMemory.mappedData) + layer * layerSize, layers[layer], static_cast<size_t>(layerSize));
+
+        VkBufferImageCopy region{};
+        region.bufferOffset = layer * layerSize;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = static_cast<uint32_t>(layer);
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = {width, height, 1};
+
+        regions.push_back(region);
+    }
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = static_cast<uint32_t>(layers.size());
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(upload.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    vkCmdCopyBufferToImage(upload.commandBuffer, upload.stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    if(transferQueueUsed) {
+        //release, the layout transition happens once, between this and the acquire
+        barrier.srcQueueFamilyIndex = uploadFamily;
+        barrier.dstQueueFamilyIndex = graphicsFamily;
+        barrier.dstAccessMask = 0;
+
+        vkCmdPipelineBarrier(upload.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        acquireImageBarriers.push_back(barrier);
+    }else {
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(upload.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, ACQUIRE_STAGES, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    return submitUpload(upload);
+}
+
+VulkanUploadToken VulkanUploadService::uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size) {
+    if(size == 0) {
+        return 0;
+    }
+
+    Upload upload = beginUpload(size);
+
+    std::memcpy(upload.stagingMemory.mappedData, data, static_cast<size_t>(size));
+
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = 0;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size = size;
+
+    vkCmdCopyBuffer(upload.commandBuffer, upload.stagingBuffer, dstBuffer, 1, &copyRegion);
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = dstBuffer;
+    barrier.offset = dstOffset;
+    barrier.size = size;
+
+    if(transferQueueUsed) {
+        barrier.srcQueueFamilyIndex = uploadFamily;
+        barrier.dstQueueFamilyIndex = graphicsFamily;
+        barrier.dstAccessMask = 0;
+
+        vkCmdPipelineBarrier(upload.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        acquireBufferBarriers.push_back(barrier);
+    }else {
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(upload.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, ACQUIRE_STAGES, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+    }
+
+    return submitUpload(upload);
+}
+
+bool VulkanUploadService::isComplete(VulkanUploadToken token) {
+    if(token > completedToken) {
+        collect();
+    }
+
+    return token <= completedToken;
+}
+
+void VulkanUploadService::wait(VulkanUploadToken token) {
+    for(Upload& upload : inFlightUploads) {
+        if(upload.token == token) {
+            vkWaitForFences(logicalDevice, 1, &upload.fence, VK_TRUE, UINT64_MAX);
+            break;
+        }
+    }
+
+    collect();
+}
+
+void VulkanUploadService::recordAcquires(VkCommandBuffer commandBuffer, std::vector<VkSemaphore>& waitSemaphores, std::vector<VkPipelineStageFlags>& waitStages) {
+    if(acquireSemaphores.empty()) {
+        return;
+    }
+
+    //the semaphore waits happen before ACQUIRE_STAGES, which is also the first scope of the acquire, so the two chain
+    vkCmdPipelineBarrier(commandBuffer, ACQUIRE_STAGES, ACQUIRE_STAGES, 0, 0, nullptr, static_cast<uint32_t>(acquireBufferBarriers.size()), acquireBufferBarriers.data(),
+                         static_cast<uint32_t>(acquireImageBarriers.size()), acquireImageBarriers.data());
+
+    VkDevice device = logicalDevice;
+
+    for(VkSemaphore semaphore : acquireSemaphores) {
+        waitSemaphores.push_back(semaphore);
+        waitStages.push_back(ACQUIRE_STAGES);
+
+        deletionQueue->retire([device, semaphore]() {
+            vkDestroySemaphore(device, semaphore, nullptr);
+        });
+    }
+
+    acquireSemaphores.clear();
+    acquireImageBarriers.clear();
+    acquireBufferBarriers.clear();
+}
+
+void VulkanUploadService::collect() {
+    while(!inFlightUploads.empty() && vkGetFenceStatus(logicalDevice, inFlightUploads.front().fence) == VK_SUCCESS) {
+        finishUpload(inFlightUploads.front());
+
+        completedToken = inFlightUploads.front().token;
+        inFlightUploads.pop_front();
+    }
+}
+
+bool VulkanUploadService::usesTransferQueue() {
+    return transferQueueUsed;
+}
+
+size_t VulkanUploadService::getPendingCount() {
+    return inFlightUploads.size();
+}
\ No newline at end of file
@@ -9,9 +9,10 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <chrono>
+#include <thread>
+#include <algorithm>
 
 #include <math.h>
-#include <numeric>
 
 const std::vector<CompositeVertex> VKRenderer::compositeBufferVertices = {
     {{-1, -1}},
@@ -22,15 +23,11 @@ const std::vector<CompositeVertex> VKRenderer::compositeBufferVertices = {
     {{1, 1}},
 };
 
-VKRenderer::VKRenderer(std::shared_ptr<VulkanEngine> engine) : vkEngine(engine), fullFrameVector(VulkanRenderSyncObjects::getMaxFramesInFlight() + 1) {
-    std::iota(std::begin(fullFrameVector), std::end(fullFrameVector), 0);
-
+VKRenderer::VKRenderer(std::shared_ptr<VulkanEngine> engine) : vkEngine(engine) {
     createUniformBuffers();
 }
 
-VKRenderer::VKRenderer() : vkEngine(std::make_shared<VulkanEngine>()), fullFrameVector(VulkanRenderSyncObjects::getMaxFramesInFlight() + 1) {
-    std::iota(std::begin(fullFrameVector), std::end(fullFrameVector), 0);
-
+VKRenderer::VKRenderer() : vkEngine(std::make_shared<VulkanEngine>()) {
     std::shared_ptr<VulkanInstance> instance = std::make_shared<VulkanInstance>();
     instance->setAppName("Test App");
 
@@ -210,18 +207,7 @@ VKRenderer::VKRenderer() : vkEngine(std::make_shared<VulkanEngine>()), fullFrame
 
     std::shared_ptr<TextureLoader> textureLoader = vkEngine->getTextureLoader();
 
-    std::array<bool*, 3> deleteBooleans = std::array<bool*, 3>();
-    canObjectBeDestroyedMap[mapCounter] = std::make_pair(std::vector<int>(), new bool(true));
-    deleteBooleans[0] = canObjectBeDestroyedMap[mapCounter].second;
-    ++mapCounter;
-    canObjectBeDestroyedMap[mapCounter] = std::make_pair(std::vector<int>(), new bool(true));
-    deleteBooleans[1] = canObjectBeDestroyedMap[mapCounter].second;
-    ++mapCounter;
-    canObjectBeDestroyedMap[mapCounter] = std::make_pair(std::vector<int>(), new bool(true));
-    deleteBooleans[2] = canObjectBeDestroyedMap[mapCounter].second;
-    ++mapCounter;
-
-    textureLoader->loadTexture(vkEngine->getDevice(), "missing_texture", "assets/missing_texture.png", deleteBooleans);
+    textureLoader->loadTexture(vkEngine->getDevice(), "missing_texture", "assets/missing_texture.png", getDeletionQueue());
     
 
     loadTextureArray("default", {missingTexture, missingTexture});
@@ -230,13 +216,6 @@ VKRenderer::VKRenderer() : vkEngine(std::make_shared<VulkanEngine>()), fullFrame
 
     addTexture("UNTEXTURED", "assets/blank_texture.png");
 
-    VulkanVertexBuffer<OverlayVertex>::createMemoryHandler(device);
-    VulkanVertexBuffer<Vertex>::createMemoryHandler(device);
-    VulkanVertexBuffer<InstanceData>::createMemoryHandler(device);
-    VulkanVertexBuffer<TransparentVertex>::createMemoryHandler(device);
-    VulkanVertexBuffer<CompositeVertex>::createMemoryHandler(device);
-    VulkanVertexBuffer<WireframeVertex>::createMemoryHandler(device);
-    
     //populate composite buffer
     compositeBuffer.setVertexData(vkEngine->getDevice(), compositeBufferVertices);
     
@@ -247,242 +226,726 @@ VKRenderer::~VKRenderer() {
 
     destroyUniformBuffers();
 
-    bool temp = true;
-
-    for(std::pair<const std::string, InstancedRenderingModel<Vertex>>& vertexData : idToInstancedModels) {
-        vertexData.second.destroy(vkEngine->getDevice(), &temp);
+    for(ModelData& modelData : models.getValues()) {
+        modelData.opaque.destroy(vkEngine->getDevice(), nullptr);
+        modelData.transparent.destroy(vkEngine->getDevice(), nullptr);
     }
 
-    for(std::pair<const std::string, InstancedRenderingModel<WireframeVertex>>& vertexData : idToWFInstancedModels) {
-        vertexData.second.destroy(vkEngine->getDevice(), &temp);
+    for(WireframeModelData& modelData : wireframeModels.getValues()) {
+        modelData.model.destroy(vkEngine->getDevice(), nullptr);
     }
 
     for(std::pair<const std::string, VulkanVertexBuffer<OverlayVertex>>& vertexData : dataIDToVertexOverlayData) {
-        vertexData.second.destroy(vkEngine->getDevice(), &temp);
+        vertexData.second.destroy(vkEngine->getDevice(), nullptr);
     }
 
-    for(std::pair<const std::string, InstancedRenderingModel<TransparentVertex>>& vertexData : idToTransparentInstancedModels) {
-        vertexData.second.destroy(vkEngine->getDevice(), &temp);
+    instanceCuller->destroyInstanceCuller(vkEngine->getDevice());
+
+    gpuProfiler->destroyGpuProfiler(vkEngine->getDevice());
+
+    opaqueDrawList.destroy(vkEngine->getDevice(), nullptr);
+    wireframeDrawList.destroy(vkEngine->getDevice(), nullptr);
+    transparentDrawList.destroy(vkEngine->getDevice(), nullptr);
+
+    if(geometryPooling) {
+        vertexPool->destroy(vkEngine->getDevice(), nullptr);
+        wireframeVertexPool->destroy(vkEngine->getDevice(), nullptr);
+        transparentVertexPool->destroy(vkEngine->getDevice(), nullptr);
+        instancePool->destroy(vkEngine->getDevice(), nullptr);
     }
 
-    VulkanVertexBuffer<OverlayVertex>::forceJoinDeleteThreads();
-    VulkanVertexBuffer<Vertex>::forceJoinDeleteThreads();
-    VulkanVertexBuffer<InstanceData>::forceJoinDeleteThreads();
-    VulkanVertexBuffer<TransparentVertex>::forceJoinDeleteThreads();
-    VulkanVertexBuffer<CompositeVertex>::forceJoinDeleteThreads();
-}
+    parallelRecorder->destroyParallelRecorder();
 
-void VKRenderer::recordCommandBuffers() {
-    std::vector<VkCommandBuffer>& commandBuffers = vkEngine->getSwapchain()->getInternalCommandBuffers();
-    std::vector<VkFramebuffer>& swapChainFramebuffers = vkEngine->getSwapchain()->getInternalFramebuffers();
-    VkRenderPass& renderPass = vkEngine->getSwapchain()->getInternalRenderPass();
-    VkExtent2D& swapChainExtent = vkEngine->getSwapchain()->getInternalExtent2D();
+    //the device is idle, nothing that is still waiting for a frame can be in use
+    vkEngine->getDevice()->getDeletionQueue()->destroyAll();
+}
 
-    std::vector<VkFence>& imagesInFlight = vkEngine->getSyncObjects()->getInternalImagesInFlight();
+/*
+adds a draw for every instance set of the side half of models, one for each of states. without pooling each model and instance set has its own
+buffer, with pooling every draw reads the two pool buffers and only differs in firstVertex / firstInstance. every draw carries the model's draw
+parameters and is in timing group timingGroupBase + the model's index
+*/
+template<typename VertexType, typename ModelDataType>
+static void addModelDrawItems(VulkanDrawList& drawList, std::vector<VulkanDrawState> states, std::vector<ModelDataType>& models, InstancedRenderingModel<VertexType> ModelDataType::* side, VulkanGeometryPool<VertexType>* modelPool, VulkanGeometryPool<InstanceData>* instancePool, bool culled, uint32_t timingGroupBase) {
+    for(size_t i = 0; i < models.size(); ++i) {
+        ModelDataType& modelData = models[i];
+        InstancedRenderingModel<VertexType>& model = modelData.*side;
+        uint32_t timingGroup = timingGroupBase + static_cast<uint32_t>(i);
+
+        VkBuffer vertexBuffer = (modelPool != nullptr) ? modelPool->getVertexBuffer().getVertexBuffer() : model.getModel().getVertexBuffer();
+        uint32_t firstVertex = (modelPool != nullptr) ? model.getModelRange().first : 0;
+        uint32_t vertexCount = (modelPool != nullptr) ? model.getModelRange().count : static_cast<uint32_t>(model.getModel().getBufferSize());
+
+        if(vertexCount == 0) {
+            //nothing to draw
+            continue;
+        }
 
-    for(size_t i = 0; i < commandBuffers.size(); i++) {
+        for(InstanceSetData& data : model.getInstanceSets()) {
+            VkBuffer instanceBuffer = (modelPool != nullptr) ? instancePool->getVertexBuffer().getVertexBuffer() : data.data.getVertexBuffer();
+            uint32_t firstInstance = (modelPool != nullptr) ? data.range.first : 0;
+            uint32_t instanceCount = (modelPool != nullptr) ? data.range.count : static_cast<uint32_t>(data.data.getBufferSize());
 
-        if(imagesInFlight[i] != VK_NULL_HANDLE) {
-            vkWaitForFences(vkEngine->getDevice()->getInternalLogicalDevice(), 1, &imagesInFlight[i], VK_TRUE, UINT64_MAX);
+            for(VulkanDrawState& state : states) {
+                if(culled) {
+                    for(VulkanGeometryRange& visibleRange : data.visibleRanges) {
+                        drawList.addDraw(state, vertexBuffer, instanceBuffer, vertexCount, visibleRange.count, firstVertex, firstInstance + visibleRange.first, modelData.drawParameters, timingGroup);
+                    }
+                }else if(instanceCount > 0) {
+                    drawList.addDraw(state, vertexBuffer, instanceBuffer, vertexCount, instanceCount, firstVertex, firstInstance, modelData.drawParameters, timingGroup);
+                }
+            }
         }
+    }
+}
+
+//one command per (model, instance set) of drawList out of drawCommands, which is either the list's own buffer or its culled copy
+static void recordIndirectModelDraws(VkCommandBuffer commandBuffer, std::shared_ptr<VulkanDevice> device, VulkanIndirectDrawList& drawList, VkBuffer drawCommands, VkBuffer modelBuffer, VkBuffer instanceBuffer) {
+    if(drawList.getDrawCount() == 0) {
+        //nothing to draw
+        return;
+    }
+
+    VkDeviceSize offsets[] = {0, 0};
+    VkBuffer buffers[] = {modelBuffer, instanceBuffer};
 
-        vkResetCommandBuffer(commandBuffers[i], 0);
+    vkCmdBindVertexBuffers(commandBuffer, 0, 2, buffers, offsets);
 
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = 0; // Optional
-        beginInfo.pInheritanceInfo = nullptr; // Optional
+    uint32_t stride = sizeof(VkDrawIndirectCommand);
 
-        if(vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS) {
-            throw std::runtime_error("failed to begin recording command buffer!");
+    //without multiDrawIndirect maxDrawIndirectCount is 1, so the count path would be past the limit even if the extension is there
+    if(device->getDrawIndirectCountFunction() != nullptr && device->supportsMultiDrawIndirect()) {
+        device->getDrawIndirectCountFunction()(commandBuffer, drawCommands, 0, drawList.getCountBuffer(), 0, drawList.getMaxDrawCount(), stride);
+    }else if(device->supportsMultiDrawIndirect()) {
+        vkCmdDrawIndirect(commandBuffer, drawCommands, 0, drawList.getDrawCount(), stride);
+    }else {
+        //still no rebinding between draws, but one call per command
+        for(uint32_t i = 0; i < drawList.getDrawCount(); ++i) {
+            vkCmdDrawIndirect(commandBuffer, drawCommands, i * stride, 1, stride);
         }
+    }
+}
 
-        VkRenderPassBeginInfo renderPassInfo{};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = renderPass;
-        renderPassInfo.framebuffer = swapChainFramebuffers[i];
+//the draws are keyed by (modelKey, instance set handle), modelKey being the value of the model's handle
+template<typename VertexType>
+static void updateIndirectDraws(std::shared_ptr<VulkanDevice> device, VulkanIndirectDrawList& drawList, uint32_t modelKey, InstancedRenderingModel<VertexType>& model, VulkanDeletionQueue* deletionQueue) {
+    VulkanGeometryRange modelRange = model.getModelRange();
 
-        renderPassInfo.renderArea.offset = {0, 0};
-        renderPassInfo.renderArea.extent = swapChainExtent;
-        
-        std::vector<VkClearValue> clearValues = {{{{clearColor.x, clearColor.y, clearColor.z, clearColor.w}}}, {{{1.0, 0}}}, {{{0, 0, 0, 0}}}, {{{1.0}}}};
+    for(InstanceSetData& data : model.getInstanceSets()) {
+        VkDrawIndirectCommand command{};
+        command.vertexCount = modelRange.count;
+        command.instanceCount = data.range.count;
+        command.firstVertex = modelRange.first;
+        command.firstInstance = data.range.first;
+
+        VulkanDrawBounds bounds;
+        bounds.min = glm::vec4(model.getBoundsMin(), 0);
+        bounds.max = glm::vec4(model.getBoundsMax(), 0);
+
+        drawList.setDraw(device, VulkanIndirectDrawList::makeKey(modelKey, data.handle.value), command, bounds, deletionQueue);
+    }
+}
 
-        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-        renderPassInfo.pClearValues = clearValues.data();
+template<typename VertexType>
+static void removeIndirectDraws(std::shared_ptr<VulkanDevice> device, VulkanIndirectDrawList& drawList, uint32_t modelKey, InstancedRenderingModel<VertexType>& model) {
+    for(InstanceSetData& data : model.getInstanceSets()) {
+        drawList.removeDraw(device, VulkanIndirectDrawList::makeKey(modelKey, data.handle.value));
+    }
+}
 
-        vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+//one task per chunksPerTask chunks of every instance set of the side half of models, each writing its own part of the set's visibleChunks
+template<typename VertexType, typename ModelDataType>
+static void addCullingTasks(std::vector<std::function<void()>>& tasks, std::vector<ModelDataType>& models, InstancedRenderingModel<VertexType> ModelDataType::* side, const VulkanFrustum& frustum, uint32_t chunksPerTask) {
+    for(ModelDataType& modelData : models) {
+        InstancedRenderingModel<VertexType>& model = modelData.*side;
+        //the shaders move the whole model by its draw offset
+        glm::vec3 modelMin = model.getBoundsMin() + modelData.drawParameters.modelOffset;
+        glm::vec3 modelMax = model.getBoundsMax() + modelData.drawParameters.modelOffset;
 
-        vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, vkEngine->getGraphicsPipeline(0)->getInternalGraphicsPipeline());
+        for(InstanceSetData& data : model.getInstanceSets()) {
+            InstanceSetData* instanceSet = &data;
 
-        vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, vkEngine->getGraphicsPipeline(0)->getPipelineLayout(), 0, 1, &vkEngine->getGraphicsPipeline(0)->getDescriptorSets()[i], 0, nullptr);
+            instanceSet->visibleChunks.resize(instanceSet->chunks.chunkCount);
 
-        for(std::pair<const std::string, InstancedRenderingModel<Vertex>>& vertexData : idToInstancedModels) {
-            VulkanVertexBuffer<Vertex>& vertexBuffer = vertexData.second.getModel();
-            VkDeviceSize offsets[] = {0};
+            for(uint32_t first = 0; first < instanceSet->chunks.chunkCount; first += chunksPerTask) {
+                uint32_t last = std::min(first + chunksPerTask, instanceSet->chunks.chunkCount);
 
-            if(vertexBuffer.getBufferSize() > 0) {
-                 VkBuffer buffer = vertexBuffer.getVertexBuffer();
+                tasks.push_back([=, &frustum]() {
+                    VulkanChunkCuller::cullChunks(frustum, instanceSet->chunks, modelMin, modelMax, first, last, instanceSet->visibleChunks.data());
+                });
+            }
+        }
+    }
+}
 
-                vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, &buffer, offsets);
+template<typename VertexType, typename ModelDataType>
+static void collectVisibleRanges(std::vector<ModelDataType>& models, InstancedRenderingModel<VertexType> ModelDataType::* side) {
+    for(ModelDataType& modelData : models) {
+        InstancedRenderingModel<VertexType>& model = modelData.*side;
 
-                for(std::pair<const std::string, InstanceSetData>& data : vertexData.second.getInstanceSets()) {
-                    VulkanVertexBuffer<InstanceData>& instanceBuffer = data.second.data;
+        for(InstanceSetData& instanceSet : model.getInstanceSets()) {
+            uint32_t instanceCount = (model.isPooled()) ? instanceSet.range.count : static_cast<uint32_t>(instanceSet.data.getBufferSize());
 
-                    if(instanceBuffer.getBufferSize() > 0) {
-                        VkBuffer instanceDataBuffer = instanceBuffer.getVertexBuffer();
+            //bounds that don't match the set (a write that was never finished) can't be trusted, so the whole set is drawn
+            if(instanceSet.chunks.chunkCount != (instanceCount + VulkanChunkCuller::CHUNK_SIZE - 1) / VulkanChunkCuller::CHUNK_SIZE) {
+                instanceSet.visibleRanges.clear();
 
-                        vkCmdBindVertexBuffers(commandBuffers[i], 1, 1, &instanceDataBuffer, offsets);
+                if(instanceCount > 0) {
+                    VulkanGeometryRange range;
+                    range.count = instanceCount;
 
-                        vkCmdDraw(commandBuffers[i], vertexBuffer.getBufferSize(), instanceBuffer.getBufferSize(), 0, 0);
-                    }else {
-                        //nothing to draw
-                    }
+                    instanceSet.visibleRanges.push_back(range);
                 }
-            }else {
-                //nothing to draw
+
+                continue;
             }
+
+            VulkanChunkCuller::collectVisibleRanges(instanceSet.visibleChunks.data(), instanceSet.chunks.chunkCount, instanceCount, instanceSet.visibleRanges);
         }
+    }
+}
+
+void VKRenderer::prepareRecording() {
+    //buffers moved here are picked up by the recording below
+    defragmentStep();
+
+    uint32_t imageCount = static_cast<uint32_t>(vkEngine->getSwapchain()->getSwapchainImageCount());
+
+    //swapchain recreation can change the image count, new images have never been recorded
+    if(recordedImages.size() != imageCount) {
+        recordedImages = std::vector<RecordedImage>(imageCount);
+        invalidateCommandBuffers();
+    }
 
-        vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, vkEngine->getGraphicsPipeline(2)->getInternalGraphicsPipeline());
+    if(!parallelRecorder->isCreated() || parallelRecorder->getImageCount() != imageCount) {
+        createParallelRecorder();
+    }
+
+    if(gpuCulling && (!instanceCuller->isCreated() || instanceCuller->getImageCount() != imageCount)) {
+        createInstanceCuller();
+    }
+
+    if(gpuProfiling && (!gpuProfiler->isCreated() || gpuProfiler->getImageCount() != imageCount)) {
+        createGpuProfiler();
+    }
 
-        vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, vkEngine->getGraphicsPipeline(2)->getPipelineLayout(), 0, 1, &vkEngine->getGraphicsPipeline(0)->getDescriptorSets()[i], 0, nullptr);
+    //the visible ranges are baked into the secondaries, so they only stay valid for the view they were culled with
+    if(cpuCulling) {
+        glm::mat4x4 viewProjection = getViewProjection();
 
-        for(std::pair<const std::string, InstancedRenderingModel<WireframeVertex>>& vertexData : idToWFInstancedModels) {
-            VulkanVertexBuffer<WireframeVertex>& vertexBuffer = vertexData.second.getModel();
-            VkDeviceSize offsets[] = {0};
+        if(viewProjection != culledViewProjection) {
+            culledViewProjection = viewProjection;
+            invalidateCommandBuffers();
+        }
+    }
+}
 
-            if(vertexBuffer.getBufferSize() > 0) {
-                 VkBuffer buffer = vertexBuffer.getVertexBuffer();
+void VKRenderer::prepareScene() {
+    if(preparedSceneGeneration == sceneGeneration) {
+        return;
+    }
 
-                vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, &buffer, offsets);
+    if(cpuCulling) {
+        cullInstanceSets();
+    }
 
-                for(std::pair<const std::string, InstanceSetData>& data : vertexData.second.getInstanceSets()) {
-                    VulkanVertexBuffer<InstanceData>& instanceBuffer = data.second.data;
+    //the models are packed already, only the overlays live in a std::map that has no random access. both are shared by all the images
+    preparedOverlays.clear();
 
-                    if(instanceBuffer.getBufferSize() > 0) {
-                        VkBuffer instanceDataBuffer = instanceBuffer.getVertexBuffer();
+    for(std::pair<const std::string, VulkanVertexBuffer<OverlayVertex>>& vertexData : dataIDToVertexOverlayData) {
+        preparedOverlays.push_back(&vertexData.second);
+    }
 
-                        vkCmdBindVertexBuffers(commandBuffers[i], 1, 1, &instanceDataBuffer, offsets);
+    //transparent models draw in the opaque subpass and the accumulation subpass, both draws come out of one walk over them
+    if(!indirectDrawing) {
+        drawList.clear();
 
-                        vkCmdDraw(commandBuffers[i], vertexBuffer.getBufferSize(), instanceBuffer.getBufferSize(), 0, 0);
-                    }else {
-                        //nothing to draw
-                    }
-                }
-            }else {
-                //nothing to draw
+        uint32_t wireframeTimingGroups = static_cast<uint32_t>(models.size());
+
+        addModelDrawItems(drawList, {{0, 0, 0}}, models.getValues(), &ModelData::opaque, vertexPool.get(), instancePool.get(), cpuCulling, 0);
+        addModelDrawItems(drawList, {{0, 2, 0}}, wireframeModels.getValues(), &WireframeModelData::model, wireframeVertexPool.get(), instancePool.get(), cpuCulling, wireframeTimingGroups);
+        addModelDrawItems(drawList, {{0, 5, 5}, {1, 3, 3}}, models.getValues(), &ModelData::transparent, transparentVertexPool.get(), instancePool.get(), cpuCulling, 0);
+
+        drawList.sort();
+
+        //the queries after the subpass boundaries are free for the draws
+        if(modelGpuProfiling) {
+            drawList.assignTimestamps(VulkanGpuProfiler::SUBPASS_QUERY_COUNT, gpuProfiler->getDrawQueryCount());
+
+            drawTimingModelIDs.clear();
+
+            for(ModelData& modelData : models.getValues()) {
+                drawTimingModelIDs.push_back(modelData.id);
+            }
+
+            for(WireframeModelData& modelData : wireframeModels.getValues()) {
+                drawTimingModelIDs.push_back(modelData.id);
             }
         }
+    }
+
+    preparedSceneGeneration = sceneGeneration;
+}
+
+std::vector<VkClearValue> VKRenderer::getClearValues() {
+    return {{{{clearColor.x, clearColor.y, clearColor.z, clearColor.w}}}, {{{1.0, 0}}}, {{{0, 0, 0, 0}}}, {{{1.0}}}};
+}
+
+void VKRenderer::recordCommandBuffers() {
+    prepareRecording();
+
+    std::vector<VkFence>& imagesInFlight = vkEngine->getSyncObjects()->getInternalImagesInFlight();
+
+    for(uint32_t imageIndex = 0; imageIndex < recordedImages.size(); ++imageIndex) {
+        if(recordedImages[imageIndex].sceneGeneration == sceneGeneration) {
+            continue;
+        }
+
+        //renderFrame only ever waits for the image it acquired, this has to wait for every stale one
+        if(imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
+            vkWaitForFences(vkEngine->getDevice()->getInternalLogicalDevice(), 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+        }
+
+        //the draw runs the timestamps belong to are about to be replaced
+        readGpuTimestamps(imageIndex);
+
+        recordImage(imageIndex);
+    }
+}
 
-        vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, vkEngine->getGraphicsPipeline(5)->getInternalGraphicsPipeline());
+void VKRenderer::recordImage(uint32_t imageIndex) {
+    prepareScene();
 
-        vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, vkEngine->getGraphicsPipeline(5)->getPipelineLayout(), 0, 1, &vkEngine->getGraphicsPipeline(5)->getDescriptorSets()[i], 0, nullptr);
+    std::vector<VkFramebuffer>& swapChainFramebuffers = vkEngine->getSwapchain()->getInternalFramebuffers();
+    VkRenderPass& renderPass = vkEngine->getSwapchain()->getInternalRenderPass();
+    VkExtent2D& swapChainExtent = vkEngine->getSwapchain()->getInternalExtent2D();
 
-        for(std::pair<const std::string, InstancedRenderingModel<TransparentVertex>>& vertexData : idToTransparentInstancedModels) {
-            VulkanVertexBuffer<TransparentVertex>& vertexBuffer = vertexData.second.getModel();
-            VkDeviceSize offsets[] = {0};
+    //in the order the instance culler knows them by
+    std::vector<VulkanIndirectDrawList*> drawLists = {&opaqueDrawList, &wireframeDrawList, &transparentDrawList};
 
-            if(vertexBuffer.getBufferSize() > 0) {
-                 VkBuffer buffer = vertexBuffer.getVertexBuffer();
+    std::vector<VulkanVertexBuffer<OverlayVertex>*>& overlays = preparedOverlays;
 
-                vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, &buffer, offsets);
+    parallelRecorder->resetImage(imageIndex);
 
-                for(std::pair<const std::string, InstanceSetData>& data : vertexData.second.getInstanceSets()) {
-                    VulkanVertexBuffer<InstanceData>& instanceBuffer = data.second.data;
+    uint32_t blockUniformOffset = getBlockUniformOffset(imageIndex);
+    uint32_t overlayUniformOffset = getOverlayUniformOffset(imageIndex);
 
-                    if(instanceBuffer.getBufferSize() > 0) {
-                        VkBuffer instanceDataBuffer = instanceBuffer.getVertexBuffer();
+    //secondaries don't inherit any state, so every job binds its own pipeline and descriptor set
+    std::vector<VulkanRecordJob> jobs = std::vector<VulkanRecordJob>();
 
-                        vkCmdBindVertexBuffers(commandBuffers[i], 1, 1, &instanceDataBuffer, offsets);
+    //every job counts into its own slot so the workers never share one
+    std::vector<VulkanBindCounts> jobBindCounts = std::vector<VulkanBindCounts>();
 
-                        vkCmdDraw(commandBuffers[i], vertexBuffer.getBufferSize(), instanceBuffer.getBufferSize(), 0, 0);
-                    }else {
-                        //nothing to draw
-                    }
-                }
+    //a whole pass is a handful of commands in indirect mode, so it gets a single job
+    auto addIndirectJob = [&](uint32_t subpass, uint32_t pipelineIndex, uint32_t descriptorPipelineIndex, uint32_t drawListIndex, auto* modelPool) {
+        VkPipeline pipeline = vkEngine->getGraphicsPipeline(pipelineIndex)->getInternalGraphicsPipeline();
+        VkPipelineLayout pipelineLayout = vkEngine->getGraphicsPipeline(pipelineIndex)->getPipelineLayout();
+        VkDescriptorSet descriptorSet = vkEngine->getGraphicsPipeline(descriptorPipelineIndex)->getDescriptorSets()[imageIndex];
+        VulkanGeometryPool<InstanceData>* instances = instancePool.get();
+        VulkanIndirectDrawList* drawList = drawLists[drawListIndex];
+        VulkanInstanceCuller* culler = (gpuCulling) ? instanceCuller.get() : nullptr;
+        std::shared_ptr<VulkanDevice> device = vkEngine->getDevice();
+
+        size_t countsIndex = jobBindCounts.size();
+        jobBindCounts.push_back(VulkanBindCounts());
+
+        VulkanRecordJob job;
+        job.subpass = subpass;
+        job.record = [=, &jobBindCounts](VkCommandBuffer commandBuffer) {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 1, &blockUniformOffset);
+
+            //one command covers many models, so they all draw with the default parameters
+            DrawPushConstants pushConstants;
+            vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawPushConstants), &pushConstants);
+
+            VulkanBindCounts& counts = jobBindCounts[countsIndex];
+            counts.pipelineBinds = 1;
+            counts.descriptorSetBinds = 1;
+            counts.pushConstantUpdates = 1;
+            counts.vertexBufferBinds = (drawList->getDrawCount() > 0) ? 1 : 0;
+            counts.draws = drawList->getDrawCount();
+
+            //prepareImage has sized the culling outputs by the time the jobs run
+            VkBuffer modelBuffer = modelPool->getVertexBuffer().getVertexBuffer();
+
+            if(culler != nullptr) {
+                recordIndirectModelDraws(commandBuffer, device, *drawList, culler->getCulledCommandBuffer(imageIndex, drawListIndex), modelBuffer, culler->getVisibleInstanceBuffer(imageIndex));
             }else {
-                //nothing to draw
+                recordIndirectModelDraws(commandBuffer, device, *drawList, drawList->getCommandBuffer(), modelBuffer, instances->getVertexBuffer().getVertexBuffer());
             }
-        }
+        };
 
-        vkCmdNextSubpass(commandBuffers[i], VK_SUBPASS_CONTENTS_INLINE);
+        jobs.push_back(job);
+    };
 
-        vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, vkEngine->getGraphicsPipeline(3)->getInternalGraphicsPipeline());
-        vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, vkEngine->getGraphicsPipeline(3)->getPipelineLayout(), 0, 1, &vkEngine->getGraphicsPipeline(3)->getDescriptorSets()[i], 0, nullptr);
-        
-        for(std::pair<const std::string, InstancedRenderingModel<TransparentVertex>>& vertexData : idToTransparentInstancedModels) {
-            VulkanVertexBuffer<TransparentVertex>& vertexBuffer = vertexData.second.getModel();
-            VkDeviceSize offsets[] = {0};
+    size_t firstTransparentJob = 0;
 
-            if(vertexBuffer.getBufferSize() > 0) {
-                 VkBuffer buffer = vertexBuffer.getVertexBuffer();
+    if(indirectDrawing) {
+        addIndirectJob(0, 0, 0, 0, vertexPool.get());
+        addIndirectJob(0, 2, 0, 1, wireframeVertexPool.get());
+        addIndirectJob(0, 5, 5, 2, transparentVertexPool.get());
 
-                vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, &buffer, offsets);
+        firstTransparentJob = jobs.size();
 
-                for(std::pair<const std::string, InstanceSetData>& data : vertexData.second.getInstanceSets()) {
-                    VulkanVertexBuffer<InstanceData>& instanceBuffer = data.second.data;
+        addIndirectJob(1, 3, 3, 2, transparentVertexPool.get());
+    }else {
+        VulkanDrawBindings bindings;
+        bindings.dynamicOffset = blockUniformOffset;
 
-                    if(instanceBuffer.getBufferSize() > 0) {
-                        VkBuffer instanceDataBuffer = instanceBuffer.getVertexBuffer();
+        if(modelGpuProfiling) {
+            bindings.queryPool = gpuProfiler->getQueryPool();
+            bindings.firstQuery = gpuProfiler->getFirstQuery(imageIndex);
+        }
 
-                        vkCmdBindVertexBuffers(commandBuffers[i], 1, 1, &instanceDataBuffer, offsets);
+        for(uint32_t pipelineIndex = 0; pipelineIndex < 6; ++pipelineIndex) {
+            std::shared_ptr<VulkanGraphicsPipeline> pipeline = vkEngine->getGraphicsPipeline(pipelineIndex);
+            std::vector<VkDescriptorSet>& descriptorSets = pipeline->getDescriptorSets();
 
-                        vkCmdDraw(commandBuffers[i], vertexBuffer.getBufferSize(), instanceBuffer.getBufferSize(), 0, 0);
-                    }else {
-                        //nothing to draw
-                    }
-                }
-            }else {
-                //nothing to draw
+            bindings.pipelines.push_back(pipeline->getInternalGraphicsPipeline());
+            bindings.pipelineLayouts.push_back(pipeline->getPipelineLayout());
+            bindings.descriptorSets.push_back((imageIndex < descriptorSets.size()) ? descriptorSets[imageIndex] : VK_NULL_HANDLE);
+        }
+
+        //the list is sorted by subpass first, so a job only has to stop at subpass boundaries and after modelsPerRecordJob draws
+        std::vector<VulkanDrawItem>& draws = drawList.getDraws();
+        VulkanDrawList* list = &drawList;
+
+        size_t first = 0;
+
+        while(first < draws.size()) {
+            uint32_t subpass = draws[first].state.subpass;
+            size_t last = first + 1;
+
+            while(last < draws.size() && last - first < modelsPerRecordJob && draws[last].state.subpass == subpass) {
+                ++last;
+            }
+
+            if(subpass == 0) {
+                firstTransparentJob = jobs.size() + 1;
             }
+
+            size_t countsIndex = jobBindCounts.size();
+            jobBindCounts.push_back(VulkanBindCounts());
+
+            VulkanRecordJob job;
+            job.subpass = subpass;
+            job.record = [=, &jobBindCounts](VkCommandBuffer commandBuffer) {
+                list->record(commandBuffer, first, last, bindings, jobBindCounts[countsIndex]);
+            };
+
+            jobs.push_back(job);
+
+            first = last;
         }
+    }
 
-        vkCmdNextSubpass(commandBuffers[i], VK_SUBPASS_CONTENTS_INLINE);
-        
-        vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, vkEngine->getGraphicsPipeline(4)->getInternalGraphicsPipeline());
-        vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, vkEngine->getGraphicsPipeline(4)->getPipelineLayout(), 0, 1, &vkEngine->getGraphicsPipeline(4)->getDescriptorSets()[i], 0, nullptr);
-        
-        //draw for 3nd subpass here
-        VkBuffer compositeVertexBuffer = compositeBuffer.getVertexBuffer();
-        VkDeviceSize offsets[] = {0};
+    size_t firstOverlayJob = jobs.size();
 
-        vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, &compositeVertexBuffer, offsets);
-        vkCmdDraw(commandBuffers[i], compositeBuffer.getBufferSize(), 1, 0, 0);
+    //there is always at least one overlay job, it clears the depth buffer for the overlays
+    for(size_t first = 0; first == 0 || first < overlays.size(); first += modelsPerRecordJob) {
+        size_t last = std::min(first + modelsPerRecordJob, overlays.size());
 
-        vkCmdNextSubpass(commandBuffers[i], VK_SUBPASS_CONTENTS_INLINE);
+        VkPipeline pipeline = vkEngine->getGraphicsPipeline(1)->getInternalGraphicsPipeline();
+        VkPipelineLayout pipelineLayout = vkEngine->getGraphicsPipeline(1)->getPipelineLayout();
+        VkDescriptorSet descriptorSet = vkEngine->getGraphicsPipeline(1)->getDescriptorSets()[imageIndex];
+        VkClearValue depthClearValue = getClearValues().at(1);
 
-        //draw for 4th subpass here
+        size_t countsIndex = jobBindCounts.size();
+        jobBindCounts.push_back(VulkanBindCounts());
 
-        vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, vkEngine->getGraphicsPipeline(1)->getInternalGraphicsPipeline());
+        VulkanRecordJob job;
+        job.subpass = 3;
+        job.record = [=, &overlays, &jobBindCounts](VkCommandBuffer commandBuffer) {
+            VulkanBindCounts& counts = jobBindCounts[countsIndex];
 
-        VkClearRect clearRect = {{{0, 0}, swapChainExtent}, 0, 1};
-        VkClearAttachment clearAttachment = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, clearValues.at(1)};
-        VkClearAttachment clearAttachments[2] = {clearAttachment, clearAttachment};
-        vkCmdClearAttachments(commandBuffers[i], 2, &clearAttachments[0], 1, &clearRect);
-        
-        vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, vkEngine->getGraphicsPipeline(1)->getPipelineLayout(), 0, 1, &vkEngine->getGraphicsPipeline(1)->getDescriptorSets()[i], 0, nullptr);
-        for(std::pair<const std::string, VulkanVertexBuffer<OverlayVertex>>& vertexData : dataIDToVertexOverlayData) {
-            VulkanVertexBuffer<OverlayVertex>& vertexBuffer = vertexData.second;
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            ++counts.pipelineBinds;
+
+            if(first == 0) {
+                VkClearRect clearRect = {{{0, 0}, swapChainExtent}, 0, 1};
+                VkClearAttachment clearAttachment = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, depthClearValue};
+                VkClearAttachment clearAttachments[2] = {clearAttachment, clearAttachment};
+                vkCmdClearAttachments(commandBuffer, 2, &clearAttachments[0], 1, &clearRect);
+            }
+
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 1, &overlayUniformOffset);
+            ++counts.descriptorSetBinds;
 
-            if(vertexBuffer.getBufferSize() > 0) {
-                VkBuffer vertexBuffers[] = {vertexBuffer.getVertexBuffer()};
-                VkDeviceSize offsets[] = {0};
-                vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets);
+            for(size_t j = first; j < last; ++j) {
+                VulkanVertexBuffer<OverlayVertex>& vertexBuffer = *overlays[j];
 
-                vkCmdDraw(commandBuffers[i], vertexBuffer.getBufferSize(), 1, 0, 0);
+                if(vertexBuffer.getBufferSize() > 0) {
+                    VkBuffer vertexBuffers[] = {vertexBuffer.getVertexBuffer()};
+                    VkDeviceSize offsets[] = {0};
+                    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+                    ++counts.vertexBufferBinds;
+
+                    vkCmdDraw(commandBuffer, vertexBuffer.getBufferSize(), 1, 0, 0);
+                    ++counts.draws;
+                }
             }
+        };
+
+        jobs.push_back(job);
+    }
+
+    //the subpasses that are recorded into secondaries get their boundary timestamps from a job of their own at the front
+    if(gpuProfiling) {
+        VkQueryPool queryPool = gpuProfiler->getQueryPool();
+        uint32_t firstQuery = gpuProfiler->getFirstQuery(imageIndex);
+
+        auto makeTimestampJob = [=](uint32_t subpass, uint32_t query) {
+            VulkanRecordJob job;
+            job.subpass = subpass;
+            job.record = [=](VkCommandBuffer commandBuffer) {
+                vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, firstQuery + query);
+            };
+
+            return job;
+        };
+
+        //back to front, so the earlier positions stay where they are
+        jobs.insert(jobs.begin() + firstOverlayJob, makeTimestampJob(3, VulkanGpuProfiler::OVERLAY_BEGIN_QUERY));
+        jobs.insert(jobs.begin() + firstTransparentJob, makeTimestampJob(1, VulkanGpuProfiler::TRANSPARENT_BEGIN_QUERY));
+        jobs.insert(jobs.begin(), makeTimestampJob(0, VulkanGpuProfiler::OPAQUE_BEGIN_QUERY));
+
+        firstTransparentJob += 1;
+        firstOverlayJob += 2;
+    }
+
+    //the indirect jobs bind the culling outputs, so they need their final size before recording
+    if(gpuCulling) {
+        instanceCuller->prepareImage(vkEngine->getDevice(), imageIndex, uniformRing.getUniformBuffer(), sizeof(UniformBuffer), instancePool->getVertexBuffer(), drawLists, getDeletionQueue());
+    }
+
+    RecordedImage& image = recordedImages[imageIndex];
+    image.sceneGeneration = sceneGeneration;
+    image.secondaries = parallelRecorder->record(imageIndex, renderPass, swapChainFramebuffers[imageIndex], jobs);
+    image.firstTransparentJob = firstTransparentJob;
+    image.firstOverlayJob = firstOverlayJob;
+
+    image.timedDrawRuns.clear();
+
+    if(modelGpuProfiling && !indirectDrawing) {
+        for(VulkanTimestampRun& run : drawList.getTimestampRuns()) {
+            RecordedImage::TimedDrawRun timedRun;
+            timedRun.modelID = drawTimingModelIDs.at(run.timingGroup);
+            timedRun.beginQuery = run.beginQuery;
+            image.timedDrawRuns.push_back(timedRun);
         }
-        
+    }
+
+    //the composite draw is recorded inline by every frame
+    image.bindCounts = VulkanBindCounts();
+    image.bindCounts.pipelineBinds = 1;
+    image.bindCounts.descriptorSetBinds = 1;
+    image.bindCounts.vertexBufferBinds = 1;
+    image.bindCounts.draws = 1;
+
+    for(VulkanBindCounts& counts : jobBindCounts) {
+        image.bindCounts.add(counts);
+    }
+}
+
+VkCommandBuffer VKRenderer::recordFrameCommandBuffer(uint32_t imageIndex) {
+    prepareRecording();
+
+    //the camera and everything else that changes per frame goes through the uniform ring, so up to date secondaries can be reused as is
+    if(recordedImages[imageIndex].sceneGeneration != sceneGeneration) {
+        recordImage(imageIndex);
+    }
+
+    RecordedImage& image = recordedImages[imageIndex];
+
+    VkCommandBuffer commandBuffer = vkEngine->getSyncObjects()->acquireFrameCommandBuffer(vkEngine->getDevice(), currentFrame, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    VkFramebuffer framebuffer = vkEngine->getSwapchain()->getInternalFramebuffers()[imageIndex];
+    VkRenderPass& renderPass = vkEngine->getSwapchain()->getInternalRenderPass();
+    VkExtent2D& swapChainExtent = vkEngine->getSwapchain()->getInternalExtent2D();
+
+    uint32_t blockUniformOffset = getBlockUniformOffset(imageIndex);
+
+    std::vector<VkClearValue> clearValues = getClearValues();
+
+    std::vector<VulkanIndirectDrawList*> drawLists = {&opaqueDrawList, &wireframeDrawList, &transparentDrawList};
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = nullptr; // Optional
+
+    if(vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording command buffer!");
+    }
+
+    if(gpuProfiling) {
+        gpuProfiler->recordReset(commandBuffer, imageIndex);
+        gpuProfiler->writeTimestamp(commandBuffer, imageIndex, VulkanGpuProfiler::FRAME_BEGIN_QUERY, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+    }
+
+    //assets uploaded on the transfer queue since the last frame become the graphics queue's here
+    uploadWaitSemaphores.clear();
+    uploadWaitStages.clear();
+    vkEngine->getDevice()->getUploadService()->recordAcquires(commandBuffer, uploadWaitSemaphores, uploadWaitStages);
+
+    //buffer uploads queued since the last frame go first so this frame's draws see them
+    vkEngine->getDevice()->getStagingRing()->recordUploads(commandBuffer, vkEngine->getDevice()->getDeletionQueue()->getRecordingValue());
+
+    //compute can't run inside the render pass
+    if(gpuCulling) {
+        instanceCuller->recordCulling(commandBuffer, imageIndex, blockUniformOffset, drawLists);
+    }
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = renderPass;
+    renderPassInfo.framebuffer = framebuffer;
+
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = swapChainExtent;
+
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.pClearValues = clearValues.data();
+
+    //opaque, wireframe and the opaque part of transparent models
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+    if(image.firstTransparentJob > 0) {
+        vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(image.firstTransparentJob), image.secondaries.data());
+    }
+
+    //transparent accumulation
+    vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+    if(image.firstOverlayJob > image.firstTransparentJob) {
+        vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(image.firstOverlayJob - image.firstTransparentJob), image.secondaries.data() + image.firstTransparentJob);
+    }
+
+    //composite, a single draw so it stays inline
+    vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+
+    if(gpuProfiling) {
+        gpuProfiler->writeTimestamp(commandBuffer, imageIndex, VulkanGpuProfiler::COMPOSITE_BEGIN_QUERY, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+    }
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vkEngine->getGraphicsPipeline(4)->getInternalGraphicsPipeline());
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vkEngine->getGraphicsPipeline(4)->getPipelineLayout(), 0, 1, &vkEngine->getGraphicsPipeline(4)->getDescriptorSets()[imageIndex], 1, &blockUniformOffset);
+
+    VkBuffer compositeVertexBuffer = compositeBuffer.getVertexBuffer();
+    VkDeviceSize offsets[] = {0};
+
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &compositeVertexBuffer, offsets);
+    vkCmdDraw(commandBuffer, compositeBuffer.getBufferSize(), 1, 0, 0);
+
+    //overlays
+    vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+    vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(image.secondaries.size() - image.firstOverlayJob), image.secondaries.data() + image.firstOverlayJob);
+
+    vkCmdEndRenderPass(commandBuffer);
+
+    if(gpuProfiling) {
+        gpuProfiler->writeTimestamp(commandBuffer, imageIndex, VulkanGpuProfiler::FRAME_END_QUERY, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+    }
+
+    if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+
+    return commandBuffer;
+}
+
+void VKRenderer::createParallelRecorder() {
+    //the secondaries of every image might still be executing
+    vkDeviceWaitIdle(vkEngine->getDevice()->getInternalLogicalDevice());
+
+    parallelRecorder->destroyParallelRecorder();
+
+    uint32_t threadCount = recordingThreadCount;
 
-        vkCmdEndRenderPass(commandBuffers[i]);
+    if(threadCount == 0) {
+        threadCount = std::clamp<uint32_t>(std::thread::hardware_concurrency(), 1, 8);
+    }
+
+    parallelRecorder->create(vkEngine->getDevice(), threadCount, static_cast<uint32_t>(vkEngine->getSwapchain()->getSwapchainImageCount()));
+
+    invalidateCommandBuffers();
+}
+
+void VKRenderer::createInstanceCuller() {
+    //every image's culling outputs might still be in use
+    vkDeviceWaitIdle(vkEngine->getDevice()->getInternalLogicalDevice());
+
+    instanceCuller->destroyInstanceCuller(vkEngine->getDevice());
+    instanceCuller->create(vkEngine->getDevice(), static_cast<uint32_t>(vkEngine->getSwapchain()->getSwapchainImageCount()), 3);
+
+    invalidateCommandBuffers();
+}
+
+void VKRenderer::createGpuProfiler() {
+    //the queries of every image might still be written
+    vkDeviceWaitIdle(vkEngine->getDevice()->getInternalLogicalDevice());
+
+    gpuProfiler->destroyGpuProfiler(vkEngine->getDevice());
+
+    uint32_t drawQueryCount = (modelGpuProfiling) ? maxTimedDrawRuns * 2 : 0;
+    gpuProfiler->create(vkEngine->getDevice(), static_cast<uint32_t>(vkEngine->getSwapchain()->getSwapchainImageCount()), drawQueryCount);
+
+    invalidateCommandBuffers();
+}
+
+void VKRenderer::readGpuTimestamps(uint32_t imageIndex) {
+    if(!gpuProfiler->isCreated() || !gpuProfiler->readImage(vkEngine->getDevice(), imageIndex, *vkEngine->getFrameTimer())) {
+        return;
+    }
 
-        if(vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to record command buffer!");
+    if(imageIndex < recordedImages.size()) {
+        for(RecordedImage::TimedDrawRun& run : recordedImages[imageIndex].timedDrawRuns) {
+            run.milliseconds = gpuProfiler->getDrawRunMilliseconds(run.beginQuery);
         }
+
+        lastProfiledImage = imageIndex;
+    }
+}
+
+void VKRenderer::setRecordingThreads(uint32_t threadCount, size_t modelsPerJob) {
+    recordingThreadCount = threadCount;
+    modelsPerRecordJob = std::max<size_t>(modelsPerJob, 1);
+
+    createParallelRecorder();
+}
+
+uint32_t VKRenderer::getRecordingThreadCount() {
+    return parallelRecorder->getThreadCount();
+}
+
+VulkanBindCounts VKRenderer::getFrameBindCounts() {
+    return frameBindCounts;
+}
+
+VulkanFrameStats VKRenderer::getFrameStats() {
+    return vkEngine->getFrameTimer()->getFrameStats();
+}
+
+std::map<std::string, double> VKRenderer::getModelGpuTimes() {
+    std::map<std::string, double> modelTimes = std::map<std::string, double>();
+
+    if(lastProfiledImage >= recordedImages.size()) {
+        return modelTimes;
     }
+
+    //a model has a run per pipeline it draws with
+    for(RecordedImage::TimedDrawRun& run : recordedImages[lastProfiledImage].timedDrawRuns) {
+        modelTimes[run.modelID] += run.milliseconds;
+    }
+
+    return modelTimes;
 }
 
 void VKRenderer::renderFrame() {
+    VulkanFrameTimer& frameTimer = *vkEngine->getFrameTimer();
+    VulkanFrameTimer::ScopedTimer frameScope(frameTimer, PHASE_FRAME);
+
     std::shared_ptr<VulkanDisplay> vkDisplay = vkEngine->getDisplay();
     std::shared_ptr<VulkanDevice> vkDevice = vkEngine->getDevice();
     std::shared_ptr<VulkanSwapchain> vkSwapchain = vkEngine->getSwapchain();
@@ -498,8 +961,6 @@ void VKRenderer::renderFrame() {
 
     std::vector<VkFence>& imagesInFlight = vkSyncObjects->getInternalImagesInFlight();
 
-    std::vector<VkCommandBuffer>& commandBuffers = vkSwapchain->getInternalCommandBuffers();
-
     VkQueue& graphicsQueue = vkDevice->getInternalGraphicsQueue();
     VkQueue& presentQueue = vkDevice->getInternalPresentQueue();
 
@@ -507,12 +968,35 @@ void VKRenderer::renderFrame() {
 
     int MAX_FRAMES_IN_FLIGHT = vkSyncObjects->getMaxFramesInFlight();
 
-    vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    {
+        VulkanFrameTimer::ScopedTimer timer(frameTimer, PHASE_FENCE_WAIT);
+        vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    }
+
+    std::shared_ptr<VulkanDeletionQueue> deletionQueue = vkDevice->getDeletionQueue();
+
+    {
+        VulkanFrameTimer::ScopedTimer timer(frameTimer, PHASE_DELETION);
+
+        //fences of one queue signal in submission order, so everything up to this frame's last submission is done
+        deletionQueue->complete(vkSyncObjects->getFrameTimelineValue(currentFrame));
+
+        vkSyncObjects->resetFrameCommandPool(vkDevice, currentFrame);
+
+        vkDevice->getStagingRing()->releaseSubmissions(vkSyncObjects->getFrameTimelineValue(currentFrame));
+
+        vkDevice->getUploadService()->collect();
+    }
+
+    vkDevice->getMemoryAllocator()->updateBudget();
 
     uint32_t imageIndex;
-    VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    VkResult result;
 
-    updateUniformBuffer(imageIndex);
+    {
+        VulkanFrameTimer::ScopedTimer timer(frameTimer, PHASE_ACQUIRE);
+        result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    }
 
     if(result == VK_ERROR_OUT_OF_DATE_KHR) {
         vkDeviceWaitIdle(device);
@@ -524,24 +1008,43 @@ void VKRenderer::renderFrame() {
     }
 
     if(imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
+        VulkanFrameTimer::ScopedTimer timer(frameTimer, PHASE_IMAGE_WAIT);
         vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
     }
 
-    removeFrameFromDeleteRequirements(currentFrame);
+    //the last frame that rendered to the image is done, so its timestamps are there without waiting
+    readGpuTimestamps(imageIndex);
+
+    //the image's uniform region is only free once the last frame that rendered to it is done
+    {
+        VulkanFrameTimer::ScopedTimer timer(frameTimer, PHASE_UNIFORM_UPDATE);
+        updateUniformBuffer(imageIndex);
+    }
+
+    VkCommandBuffer commandBuffer;
+
+    //only the acquired image's secondaries get re-recorded if they are stale, no other image is waited on
+    {
+        VulkanFrameTimer::ScopedTimer timer(frameTimer, PHASE_RECORDING);
+        commandBuffer = recordFrameCommandBuffer(imageIndex);
+    }
+
+    frameBindCounts = recordedImages[imageIndex].bindCounts;
 
     imagesInFlight[imageIndex] = inFlightFences[currentFrame];
 
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-    VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
+    //the upload semaphores come after the image's, they only hold up the stages that can read uploaded data
+    uploadWaitSemaphores.insert(uploadWaitSemaphores.begin(), imageAvailableSemaphores[currentFrame]);
+    uploadWaitStages.insert(uploadWaitStages.begin(), VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(uploadWaitSemaphores.size());
+    submitInfo.pWaitSemaphores = uploadWaitSemaphores.data();
+    submitInfo.pWaitDstStageMask = uploadWaitStages.data();
 
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+    submitInfo.pCommandBuffers = &commandBuffer;
 
     VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
     submitInfo.signalSemaphoreCount = 1;
@@ -549,10 +1052,16 @@ void VKRenderer::renderFrame() {
 
     vkResetFences(device, 1, &inFlightFences[currentFrame]);
 
-    if(vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
-        throw std::runtime_error("failed to submit draw command buffer!");
+    {
+        VulkanFrameTimer::ScopedTimer timer(frameTimer, PHASE_SUBMIT);
+
+        if(vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit draw command buffer!");
+        }
     }
 
+    vkSyncObjects->setFrameTimelineValue(currentFrame, deletionQueue->submit());
+
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
@@ -566,7 +1075,10 @@ void VKRenderer::renderFrame() {
 
     presentInfo.pResults = nullptr; // Optional
 
-    result = vkQueuePresentKHR(presentQueue, &presentInfo);
+    {
+        VulkanFrameTimer::ScopedTimer timer(frameTimer, PHASE_PRESENT);
+        result = vkQueuePresentKHR(presentQueue, &presentInfo);
+    }
 
     if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || vkDisplay->getFramebufferResized()) {
         vkDisplay->setFramebufferResized(false);
@@ -577,93 +1089,36 @@ void VKRenderer::renderFrame() {
     }
 
     currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+}
 
-    //start delete-thread sync code
+void VKRenderer::destroyUniformBuffers() {
+    uniformRing.destroyUniformRing(vkEngine->getDevice());
+}
 
-    auto textureAccessMutexes = vkEngine->getTextureLoader()->getDeleteThreadAccessMutexes();
-    
-    auto vertexBufferMutexes = VulkanVertexBuffer<Vertex>::getDeleteFunctionMutexes();
-    auto wireframeVertexBufferMutexes = VulkanVertexBuffer<WireframeVertex>::getDeleteFunctionMutexes();
-    auto overlayVertexBufferMutexes = VulkanVertexBuffer<OverlayVertex>::getDeleteFunctionMutexes();
-    auto compositeVertexBufferMutexes = VulkanVertexBuffer<CompositeVertex>::getDeleteFunctionMutexes();
-
-    std::get<0>(textureAccessMutexes)->lock();
-    std::get<1>(textureAccessMutexes)->lock();
-    std::get<2>(textureAccessMutexes)->lock();
-    vertexBufferMutexes.first->lock();
-    wireframeVertexBufferMutexes.first->lock();
-    overlayVertexBufferMutexes.first->lock();
-    vertexBufferMutexes.second->lock();
-    wireframeVertexBufferMutexes.second->lock();
-    overlayVertexBufferMutexes.second->lock();
-    compositeVertexBufferMutexes.first->lock();
-    compositeVertexBufferMutexes.second->lock();
-
-    for(auto iterator = canObjectBeDestroyedMap.begin(); iterator != canObjectBeDestroyedMap.end();) {
-        if(iterator->second.second == nullptr) {
-            std::cout << canObjectBeDestroyedMap.size() << std::endl;
-            std::cout << iterator->first << std::endl;
-            abort();
-        }
-        if(iterator->second.first.size() == 0 && *iterator->second.second == false) {
-            *iterator->second.second = true;
-            iterator->second.first.push_back(-1);
-        }
+void VKRenderer::createUniformBuffers() {
+    uint32_t imageCount = vkEngine->getSwapchain()->getSwapchainImageCount();
 
-        if(iterator->second.first.size() == 1 && *iterator->second.second == false) {
-            if(iterator->second.first.at(0) == -1) {
-                iterator = canObjectBeDestroyedMap.erase(iterator);
-            }else {
-                std::advance(iterator, 1);
-            }
-        }else {
-            std::advance(iterator, 1);
-        }
-    }
-
-    std::get<0>(textureAccessMutexes)->unlock();
-    std::get<1>(textureAccessMutexes)->unlock();
-    std::get<2>(textureAccessMutexes)->unlock();
-    vertexBufferMutexes.first->unlock();
-    wireframeVertexBufferMutexes.first->unlock();
-    overlayVertexBufferMutexes.first->unlock();
-    vertexBufferMutexes.second->unlock();
-    wireframeVertexBufferMutexes.second->unlock();
-    overlayVertexBufferMutexes.second->unlock();
-    compositeVertexBufferMutexes.first->unlock();
-    compositeVertexBufferMutexes.second->unlock();
+    //the ring survives swapchain recreation unless there are suddenly more images than regions, only the descriptors have to be rewritten
+    if(!uniformRing.isCreated() || uniformRing.getRegionCount() < imageCount) {
+        destroyUniformBuffers();
 
-    //end delete-thread sync code
-}
+        VkDeviceSize regionSize = 0;
+        regionSize += uniformRing.alignSize(sizeof(UniformBuffer));
+        regionSize += uniformRing.alignSize(sizeof(OverlayUniformBuffer));
+        regionSize += perDrawUniformBytes;
 
-void VKRenderer::destroyUniformBuffers() {
-    for (size_t i = 0; i < blockUniformBuffers.size(); i++) {
-        blockUniformBuffers.at(i).destroy(vkEngine->getDevice());
+        uniformRing.create(vkEngine->getDevice(), regionSize, imageCount);
     }
 
-    for (size_t i = 0; i < overlayUniformBuffers.size(); i++) {
-        overlayUniformBuffers.at(i).destroy(vkEngine->getDevice());
-    }
+    updateDescriptorSets();
 }
 
-void VKRenderer::createUniformBuffers() {
-    if(blockUniformBuffers.size() > 0) {
-        destroyUniformBuffers();
-    }
-
-    blockUniformBuffers.resize(vkEngine->getSwapchain()->getSwapchainImageCount());
-    overlayUniformBuffers.resize(vkEngine->getSwapchain()->getSwapchainImageCount());
-
-
-    for (size_t i = 0; i < blockUniformBuffers.size(); i++) {
-        blockUniformBuffers.at(i).create(vkEngine->getDevice());
-    }
-
-    for (size_t i = 0; i < blockUniformBuffers.size(); i++) {
-        overlayUniformBuffers.at(i).create(vkEngine->getDevice());
-    }
+uint32_t VKRenderer::getBlockUniformOffset(uint32_t imageIndex) {
+    return uniformRing.getRegionOffset(imageIndex);
+}
 
-    updateDescriptorSets();
+uint32_t VKRenderer::getOverlayUniformOffset(uint32_t imageIndex) {
+    return uniformRing.getRegionOffset(imageIndex) + static_cast<uint32_t>(uniformRing.alignSize(sizeof(UniformBuffer)));
 }
 
 glm::mat3x3 VKRenderer::calculateXRotationMatrix(double xRotation) {
@@ -740,35 +1195,64 @@ void VKRenderer::updateUniformBuffer(uint32_t imageIndex) {
 
     UniformBuffer ubo{};
 
+    glm::mat4x4 modelMatrix = glm::identity<glm::mat4x4>();
+
     if(rotatingBallGoBrrrr) {
         static auto startTime = std::chrono::high_resolution_clock::now();
 
         auto currentTime = std::chrono::high_resolution_clock::now();
         float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
-        ubo.modelMatrix = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-    }else {
-        ubo.modelMatrix = glm::identity<glm::mat4x4>();
+        modelMatrix = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
     }
 
-    ubo.viewMatrix = createViewMatrix(camera, xRotation, yRotation);
-    ubo.tint = screenTint;
-
     /*glm::vec3 direction;
     direction.x = cos(glm::radians(xRotation)) * cos(glm::radians(yRotation));
     direction.y = sin(glm::radians(yRotation));
     direction.z = sin(glm::radians(xRotation)) * cos(glm::radians(yRotation));
     glm::vec3 cameraFront = glm::normalize(direction);
 
-    ubo.viewMatrix = glm::lookAt(camera, camera + cameraFront, glm::vec3(0.0f, 1.0f,  0.0f));*/
+    viewMatrix = glm::lookAt(camera, camera + cameraFront, glm::vec3(0.0f, 1.0f,  0.0f));*/
 
-    ubo.projectionMatrix = glm::perspective(glm::radians(FOV), vkEngine->getSwapchain()->getInternalExtent2D().width / (float) vkEngine->getSwapchain()->getInternalExtent2D().height, near, far);
+    ubo.viewProjection = getViewProjection() * modelMatrix;
+    ubo.tint = screenTint;
+
+    uniformRing.write(getBlockUniformOffset(imageIndex), &ubo, sizeof(UniformBuffer));
+
+    uniformRing.write(getOverlayUniformOffset(imageIndex), &overlayUBO, sizeof(OverlayUniformBuffer));
+
+    //anything pushed for individual draws this frame goes after the two fixed slots
+    uniformRing.beginRegion(imageIndex, uniformRing.alignSize(sizeof(UniformBuffer)) + sizeof(OverlayUniformBuffer));
+}
+
+glm::mat4x4 VKRenderer::createProjectionMatrix(float fov, float aspectRatio, float near, float far) {
+    return glm::perspective(glm::radians(fov), aspectRatio, near, far);
+}
+
+glm::mat4x4 VKRenderer::getViewProjection() {
+    VkExtent2D extent = vkEngine->getSwapchain()->getInternalExtent2D();
+
+    return createProjectionMatrix(FOV, extent.width / (float) extent.height, near, far) * createViewMatrix(camera, xRotation, yRotation);
+}
+
+void VKRenderer::cullInstanceSets() {
+    VulkanFrustum frustum = VulkanChunkCuller::extractFrustum(culledViewProjection);
+
+    std::vector<std::function<void()>> tasks = std::vector<std::function<void()>>();
+
+    addCullingTasks(tasks, models.getValues(), &ModelData::opaque, frustum, chunksPerCullingTask);
+    addCullingTasks(tasks, wireframeModels.getValues(), &WireframeModelData::model, frustum, chunksPerCullingTask);
+    addCullingTasks(tasks, models.getValues(), &ModelData::transparent, frustum, chunksPerCullingTask);
 
-    blockUniformBuffers.at(imageIndex).setVertexData(vkEngine->getDevice(), ubo);
+    parallelRecorder->runTasks(tasks);
 
-    overlayUniformBuffers.at(imageIndex).setVertexData(vkEngine->getDevice(), overlayUBO);
+    collectVisibleRanges(models.getValues(), &ModelData::opaque);
+    collectVisibleRanges(wireframeModels.getValues(), &WireframeModelData::model);
+    collectVisibleRanges(models.getValues(), &ModelData::transparent);
 }
 
 void VKRenderer::updateDescriptorSets() {
+    invalidateCommandBuffers();
+
     bool recreateGraphicsPipelines = false;
 
     while(overlayTextures.size() > MAX_OVERLAY_TEXTURES) {
@@ -783,7 +1267,7 @@ void VKRenderer::updateDescriptorSets() {
 
     for (size_t i = 0; i < vkEngine->getSwapchain()->getSwapchainImageCount(); i++) {
         VkDescriptorBufferInfo bufferInfo{};
-        bufferInfo.buffer = blockUniformBuffers.at(i).getUniformBuffer();
+        bufferInfo.buffer = uniformRing.getUniformBuffer();
         bufferInfo.offset = 0;
         bufferInfo.range = sizeof(UniformBuffer);
 
@@ -833,7 +1317,7 @@ void VKRenderer::updateDescriptorSets() {
         }
         
         VkDescriptorBufferInfo bufferInfoOverlay{};
-        bufferInfoOverlay.buffer = overlayUniformBuffers.at(i).getUniformBuffer();
+        bufferInfoOverlay.buffer = uniformRing.getUniformBuffer();
         bufferInfoOverlay.offset = 0;
         bufferInfoOverlay.range = sizeof(OverlayUniformBuffer);
 
@@ -953,89 +1437,53 @@ glm::vec3& VKRenderer::getCameraPosition() {
 }
 
 void VKRenderer::setOverlayVertices(std::string id, std::vector<OverlayVertex> newVertices) {
+    invalidateCommandBuffers();
+
     if(dataIDToVertexOverlayData.count(id) > 0) {
-        dataIDToVertexOverlayData[id].setVertexData(vkEngine->getDevice(), newVertices);
+        dataIDToVertexOverlayData[id].setVertexData(vkEngine->getDevice(), std::move(newVertices), getDeletionQueue());
         return;
     }
 
-    VulkanVertexBuffer<OverlayVertex> vertexBuffer = VulkanVertexBuffer<OverlayVertex>();
-    vertexBuffer.setVertexData(vkEngine->getDevice(), newVertices);
-
-    dataIDToVertexOverlayData[id] = vertexBuffer;
+    VulkanVertexBuffer<OverlayVertex>& vertexBuffer = dataIDToVertexOverlayData[id];
+    vertexBuffer.setKeepCPUCopy(keepCPUCopies);
+    vertexBuffer.setMemoryTag(VulkanMemoryTag(CATEGORY_OVERLAY, id));
+    vertexBuffer.setVertexData(vkEngine->getDevice(), std::move(newVertices));
 }
 
 std::shared_ptr<VulkanEngine> VKRenderer::getEngine() {
     return vkEngine;
 }
 
-void VKRenderer::addTexture(std::string id, std::string texturePath) {
+VulkanUploadToken VKRenderer::addTexture(std::string id, std::string texturePath) {
 
     if(std::find(overlayTextures.begin(), overlayTextures.end(), id) == overlayTextures.end()) {
         overlayTextures.push_back(id);
-        
-        std::array<bool*, 3> deleteBooleans = std::array<bool*, 3>();
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(std::vector<int>(), new bool(true));
-        deleteBooleans[0] = canObjectBeDestroyedMap[mapCounter].second;
-        ++mapCounter;
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(std::vector<int>(), new bool(true));
-        deleteBooleans[1] = canObjectBeDestroyedMap[mapCounter].second;
-        ++mapCounter;
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(std::vector<int>(), new bool(true));
-        deleteBooleans[2] = canObjectBeDestroyedMap[mapCounter].second;
-        ++mapCounter;
-
-        vkEngine->getTextureLoader()->loadTexture(vkEngine->getDevice(), id, texturePath, deleteBooleans);
-    }else {
-        std::array<bool*, 3> deleteBooleans = std::array<bool*, 3>();
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(std::vector<int>(), new bool(false));
-        deleteBooleans[0] = canObjectBeDestroyedMap[mapCounter].second;
-        ++mapCounter;
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(std::vector<int>(), new bool(false));
-        deleteBooleans[1] = canObjectBeDestroyedMap[mapCounter].second;
-        ++mapCounter;
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(std::vector<int>(), new bool(false));
-        deleteBooleans[2] = canObjectBeDestroyedMap[mapCounter].second;
-        ++mapCounter;
-
-        vkEngine->getTextureLoader()->loadTexture(vkEngine->getDevice(), id, texturePath, deleteBooleans);
     }
 
+    //a texture that was loaded under id before is only destroyed once the frames using it are done
+    VulkanUploadToken uploadToken = vkEngine->getTextureLoader()->loadTexture(vkEngine->getDevice(), id, texturePath, getDeletionQueue());
+
     updateDescriptorSets();
+
+    return uploadToken;
 }
 
-void VKRenderer::addTextTexture(std::string id, std::string text, glm::vec3 color) {
+VulkanUploadToken VKRenderer::addTextTexture(std::string id, std::string text, glm::vec3 color) {
     
     if(std::find(overlayTextures.begin(), overlayTextures.end(), id) == overlayTextures.end()) {
         overlayTextures.push_back(id);
-        
-        std::array<bool*, 3> deleteBooleans = std::array<bool*, 3>();
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(std::vector<int>(), new bool(true));
-        deleteBooleans[0] = canObjectBeDestroyedMap[mapCounter].second;
-        ++mapCounter;
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(std::vector<int>(), new bool(true));
-        deleteBooleans[1] = canObjectBeDestroyedMap[mapCounter].second;
-        ++mapCounter;
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(std::vector<int>(), new bool(true));
-        deleteBooleans[2] = canObjectBeDestroyedMap[mapCounter].second;
-        ++mapCounter;
-
-        vkEngine->getTextureLoader()->loadTextToTexture(vkEngine->getDevice(), id, text, color, deleteBooleans);
-    }else {
-        std::array<bool*, 3> deleteBooleans = std::array<bool*, 3>();
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(std::vector<int>(), new bool(false));
-        deleteBooleans[0] = canObjectBeDestroyedMap[mapCounter].second;
-        ++mapCounter;
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(std::vector<int>(), new bool(false));
-        deleteBooleans[1] = canObjectBeDestroyedMap[mapCounter].second;
-        ++mapCounter;
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(std::vector<int>(), new bool(false));
-        deleteBooleans[2] = canObjectBeDestroyedMap[mapCounter].second;
-        ++mapCounter;
-
-        vkEngine->getTextureLoader()->loadTextToTexture(vkEngine->getDevice(), id, text, color, deleteBooleans);
     }
+
+    //a texture that was loaded under id before is only destroyed once the frames using it are done
+    VulkanUploadToken uploadToken = vkEngine->getTextureLoader()->loadTextToTexture(vkEngine->getDevice(), id, text, color, getDeletionQueue());
     
     updateDescriptorSets();
+
+    return uploadToken;
+}
+
+bool VKRenderer::isUploadComplete(VulkanUploadToken token) {
+    return vkEngine->getDevice()->getUploadService()->isComplete(token);
 }
 
 void VKRenderer::removeTexture(std::string id) {
@@ -1056,6 +1504,8 @@ unsigned int VKRenderer::getTextureID(std::string id) {
 }
 
 void VKRenderer::createGraphicsPipelines() {
+    invalidateCommandBuffers();
+
     std::shared_ptr<VulkanSwapchain> swapchain = vkEngine->getSwapchain();
 
     std::shared_ptr<VulkanGraphicsPipeline> graphicsPipelineBlocks = std::make_shared<VulkanGraphicsPipeline>();
@@ -1065,6 +1515,7 @@ void VKRenderer::createGraphicsPipelines() {
     graphicsPipelineBlocks->setVertexShader("shaders/output/3dvert_instanced_texArray.spv");
     graphicsPipelineBlocks->setFragmentShader("shaders/output/3dfrag_instanced_texArray.spv");
     graphicsPipelineBlocks->addDescriptorSetLayoutBinding(UniformBuffer::getDescriptorSetLayout());
+    graphicsPipelineBlocks->setPushConstantDescriptor(DrawPushConstants::getPushConstantRange());
 
     //texture array binding
     VkDescriptorSetLayoutBinding textureArrayLayoutBinding{};
@@ -1076,7 +1527,7 @@ void VKRenderer::createGraphicsPipelines() {
 
     graphicsPipelineBlocks->addDescriptorSetLayoutBinding(textureArrayLayoutBinding);
 
-    graphicsPipelineBlocks->setDescriptorPoolData(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, swapchain->getSwapchainImageCount());
+    graphicsPipelineBlocks->setDescriptorPoolData(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, swapchain->getSwapchainImageCount());
 
     graphicsPipelineBlocks->setDescriptorPoolData(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, swapchain->getSwapchainImageCount());
     
@@ -1106,7 +1557,7 @@ void VKRenderer::createGraphicsPipelines() {
 
     graphicsPipelineOverlays->addDescriptorSetLayoutBinding(arrayOfTexturesLayoutBinding);
 
-    graphicsPipelineOverlays->setDescriptorPoolData(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, swapchain->getSwapchainImageCount());
+    graphicsPipelineOverlays->setDescriptorPoolData(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, swapchain->getSwapchainImageCount());
 
     graphicsPipelineOverlays->setDescriptorPoolData(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, swapchain->getSwapchainImageCount() * MAX_OVERLAY_TEXTURES);
 
@@ -1122,10 +1573,11 @@ void VKRenderer::createGraphicsPipelines() {
     graphicsPipelineWireframe->setVertexShader("shaders/output/3dvert_instanced_wireframe.spv");
     graphicsPipelineWireframe->setFragmentShader("shaders/output/3dfrag_instanced_wireframe.spv");
     graphicsPipelineWireframe->addDescriptorSetLayoutBinding(UniformBuffer::getDescriptorSetLayout());
+    graphicsPipelineWireframe->setPushConstantDescriptor(DrawPushConstants::getPushConstantRange());
 
     graphicsPipelineWireframe->addDescriptorSetLayoutBinding(textureArrayLayoutBinding);
 
-    graphicsPipelineWireframe->setDescriptorPoolData(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, swapchain->getSwapchainImageCount());
+    graphicsPipelineWireframe->setDescriptorPoolData(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, swapchain->getSwapchainImageCount());
 
     graphicsPipelineWireframe->setDescriptorPoolData(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, swapchain->getSwapchainImageCount());
 
@@ -1142,8 +1594,9 @@ void VKRenderer::createGraphicsPipelines() {
     transparencySubpassTwoPipeline->setVertexShader("shaders/output/3dvert_transparent_subpass2.spv");
     transparencySubpassTwoPipeline->setFragmentShader("shaders/output/3dfrag_transparent_subpass2.spv");
     transparencySubpassTwoPipeline->addDescriptorSetLayoutBinding(UniformBuffer::getDescriptorSetLayout());
+    transparencySubpassTwoPipeline->setPushConstantDescriptor(DrawPushConstants::getPushConstantRange());
 
-    transparencySubpassTwoPipeline->setDescriptorPoolData(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, swapchain->getSwapchainImageCount());
+    transparencySubpassTwoPipeline->setDescriptorPoolData(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, swapchain->getSwapchainImageCount());
     transparencySubpassTwoPipeline->setSubpassIndex(1);
     transparencySubpassTwoPipeline->setCullMode(VK_CULL_MODE_NONE);
     transparencySubpassTwoPipeline->setDepthTestAndWrite(true, false);
@@ -1188,7 +1641,7 @@ void VKRenderer::createGraphicsPipelines() {
     transparencySubpassThreePipeline->setFragmentShader("shaders/output/3dfrag_transparent_subpass3.spv");
     transparencySubpassThreePipeline->addDescriptorSetLayoutBinding(UniformBuffer::getDescriptorSetLayout());
 
-    transparencySubpassThreePipeline->setDescriptorPoolData(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, swapchain->getSwapchainImageCount());
+    transparencySubpassThreePipeline->setDescriptorPoolData(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, swapchain->getSwapchainImageCount());
     transparencySubpassThreePipeline->setDescriptorPoolData(VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, swapchain->getSwapchainImageCount());
     transparencySubpassThreePipeline->setDescriptorPoolData(VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, swapchain->getSwapchainImageCount());
     transparencySubpassThreePipeline->setCullMode(VK_CULL_MODE_NONE);
@@ -1236,7 +1689,7 @@ std::pair<unsigned int, unsigned int> VKRenderer::getTextureArrayDimensions(std:
     return vkEngine->getTextureLoader()->getTextureArrayDimensions(id);
 }
 
-void VKRenderer::loadTextureArray(std::string id, std::vector<std::string> textures) {
+VulkanUploadToken VKRenderer::loadTextureArray(std::string id, std::vector<std::string> textures) {
     std::map<std::string, unsigned int> texturesToIDs;
 
     unsigned int i = 0;
@@ -1246,35 +1699,11 @@ void VKRenderer::loadTextureArray(std::string id, std::vector<std::string> textu
         ++i;
     }   
 
-    if(texureArrayTexturesToIDs.count(id) == 0) {
-        std::array<bool*, 3> deleteBooleans = std::array<bool*, 3>();
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(std::vector<int>(), new bool(true));
-        deleteBooleans[0] = canObjectBeDestroyedMap[mapCounter].second;
-        ++mapCounter;
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(std::vector<int>(), new bool(true));
-        deleteBooleans[1] = canObjectBeDestroyedMap[mapCounter].second;
-        ++mapCounter;
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(std::vector<int>(), new bool(true));
-        deleteBooleans[2] = canObjectBeDestroyedMap[mapCounter].second;
-        ++mapCounter;
-
-        vkEngine->getTextureLoader()->loadTextureArray(vkEngine->getDevice(), textures, id, deleteBooleans);
-    }else {
-        std::array<bool*, 3> deleteBooleans = std::array<bool*, 3>();
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(std::vector<int>(), new bool(false));
-        deleteBooleans[0] = canObjectBeDestroyedMap[mapCounter].second;
-        ++mapCounter;
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(std::vector<int>(), new bool(false));
-        deleteBooleans[1] = canObjectBeDestroyedMap[mapCounter].second;
-        ++mapCounter;
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(std::vector<int>(), new bool(false));
-        deleteBooleans[2] = canObjectBeDestroyedMap[mapCounter].second;
-        ++mapCounter;
-
-        vkEngine->getTextureLoader()->loadTextureArray(vkEngine->getDevice(), textures, id, deleteBooleans);
-    }
+    VulkanUploadToken uploadToken = vkEngine->getTextureLoader()->loadTextureArray(vkEngine->getDevice(), textures, id, getDeletionQueue());
 
     texureArrayTexturesToIDs[id] = texturesToIDs;
+
+    return uploadToken;
 }
 
 unsigned int VKRenderer::getTextureArrayID(std::string arrayID, std::string textureID) {
@@ -1291,14 +1720,16 @@ void VKRenderer::setOverlayBounds(float x, float y, float z) {
 }
 
 void VKRenderer::setClearColor(glm::vec4 rgba) {
+    invalidateCommandBuffers();
+
     this->clearColor = rgba;
 }
 
 void VKRenderer::removeOverlayVertices(std::string id) {
+    invalidateCommandBuffers();
+
     if(dataIDToVertexOverlayData.count(id) > 0) {
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(getCopyOfFFVWithExtraFrame(), new bool(false));
-        dataIDToVertexOverlayData[id].destroy(vkEngine->getDevice(), canObjectBeDestroyedMap[mapCounter].second);
-        ++mapCounter;
+        dataIDToVertexOverlayData[id].destroy(vkEngine->getDevice(), getDeletionQueue());
         dataIDToVertexOverlayData.erase(id);
     }
 }
@@ -1312,26 +1743,33 @@ void VKRenderer::setCameraFar(float f) {
 }
 
 void VKRenderer::clearAllInstances() {
+    invalidateCommandBuffers();
+
     vkDeviceWaitIdle(vkEngine->getDevice()->getInternalLogicalDevice());
-    bool temp = true;
-    for(std::pair<const std::string, InstancedRenderingModel<Vertex>>& vertexData : idToInstancedModels) {
-        vertexData.second.clearInstances(vkEngine->getDevice(), &temp);
-    }
+    for(size_t i = 0; i < models.size(); ++i) {
+        ModelData& modelData = models.getValues()[i];
+        uint32_t modelKey = models.getHandle(i).value;
+
+        removeIndirectDraws(vkEngine->getDevice(), opaqueDrawList, modelKey, modelData.opaque);
+        modelData.opaque.clearInstances(vkEngine->getDevice(), nullptr);
 
-    for(std::pair<const std::string, InstancedRenderingModel<TransparentVertex>>& vertexData : idToTransparentInstancedModels) {
-        vertexData.second.clearInstances(vkEngine->getDevice(), &temp);
+        removeIndirectDraws(vkEngine->getDevice(), transparentDrawList, modelKey, modelData.transparent);
+        modelData.transparent.clearInstances(vkEngine->getDevice(), nullptr);
     }
 }
 
 void VKRenderer::clearAllOverlays() {
+    invalidateCommandBuffers();
+
     vkDeviceWaitIdle(vkEngine->getDevice()->getInternalLogicalDevice());
-    bool temp = true;
     for(std::pair<const std::string, VulkanVertexBuffer<OverlayVertex>>& vertexData : dataIDToVertexOverlayData) {
-        vertexData.second.destroy(vkEngine->getDevice(), &temp);
+        vertexData.second.destroy(vkEngine->getDevice(), nullptr);
     }
 }
 
 void VKRenderer::setWireframeTopology(VkPrimitiveTopology topology) {
+    invalidateCommandBuffers();
+
     wireframeTopology = topology;
 
     vkEngine->getGraphicsPipeline(2)->setPrimitiveTopology(wireframeTopology);
@@ -1340,156 +1778,623 @@ void VKRenderer::setWireframeTopology(VkPrimitiveTopology topology) {
     vkEngine->getGraphicsPipeline(2)->create(vkEngine->getDevice(), vkEngine->getSwapchain());
 }
 
-void VKRenderer::setWireframeModel(std::string modelID, std::vector<WireframeVertex> modelVertices) {
-    if(idToWFInstancedModels.count(modelID) > 0) {
-        idToWFInstancedModels.at(modelID).setModel(vkEngine->getDevice(), modelVertices);
-        return;
+WireframeModelHandle VKRenderer::setWireframeModel(std::string modelID, std::vector<WireframeVertex> modelVertices) {
+    WireframeModelHandle model = getWireframeModelHandle(modelID);
+
+    if(!model.isNull()) {
+        setWireframeModel(model, std::move(modelVertices));
+        return model;
+    }
+
+    invalidateCommandBuffers();
+
+    if(geometryPooling) {
+        model = wireframeModels.insert(WireframeModelData{modelID, InstancedRenderingModel<WireframeVertex>(vkEngine->getDevice(), std::span<const WireframeVertex>(modelVertices), wireframeVertexPool, instancePool, getDeletionQueue())});
+    }else {
+        model = wireframeModels.insert(WireframeModelData{modelID, InstancedRenderingModel<WireframeVertex>(vkEngine->getDevice(), std::move(modelVertices), modelPlacement, instancePlacement, keepCPUCopies, "wireframe/" + modelID)});
     }
 
-    idToWFInstancedModels.insert(std::make_pair(modelID, InstancedRenderingModel<WireframeVertex>(vkEngine->getDevice(), modelVertices)));
+    wireframeModelHandles[modelID] = model;
+
+    return model;
+}
+
+void VKRenderer::setWireframeModel(WireframeModelHandle model, std::vector<WireframeVertex> modelVertices) {
+    invalidateCommandBuffers();
+
+    wireframeModels.at(model).model.setModel(vkEngine->getDevice(), std::move(modelVertices), getDeletionQueue());
+
+    //the model's range in the pool can move, which changes every set's command
+    refreshWireframeIndirectDraws(model);
+}
+
+WireframeModelHandle VKRenderer::getWireframeModelHandle(std::string modelID) {
+    std::unordered_map<std::string, WireframeModelHandle>::iterator model = wireframeModelHandles.find(modelID);
+
+    return (model != wireframeModelHandles.end()) ? model->second : WireframeModelHandle();
+}
+
+InstanceSetHandle VKRenderer::getWireframeInstanceSetHandle(WireframeModelHandle model, std::string instanceVectorID) {
+    return wireframeModels.at(model).model.getInstanceSetHandle(instanceVectorID);
+}
+
+WireframeModelHandle VKRenderer::requireWireframeModelHandle(const std::string& modelID, const std::string& action) {
+    WireframeModelHandle model = getWireframeModelHandle(modelID);
+
+    if(model.isNull()) {
+        throw std::runtime_error(modelID + " hasn't been set yet, so you can't " + action + ".");
+    }
+
+    return model;
 }
 
 void VKRenderer::removeWireframeModel(std::string modelID) {
-    if(idToWFInstancedModels.count(modelID) > 0) {
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(getCopyOfFFVWithExtraFrame(), new bool(false));
-        idToWFInstancedModels.at(modelID).destroy(vkEngine->getDevice(), canObjectBeDestroyedMap[mapCounter].second);
-        ++mapCounter;
-        
-        idToWFInstancedModels.erase(modelID);
+    removeWireframeModel(getWireframeModelHandle(modelID));
+}
+
+void VKRenderer::removeWireframeModel(WireframeModelHandle model) {
+    invalidateCommandBuffers();
+
+    WireframeModelData* modelData = wireframeModels.find(model);
+
+    if(modelData == nullptr) {
+        return;
     }
+
+    removeIndirectDraws(vkEngine->getDevice(), wireframeDrawList, model.value, modelData->model);
+
+    modelData->model.destroy(vkEngine->getDevice(), getDeletionQueue());
+
+    wireframeModelHandles.erase(modelData->id);
+    wireframeModels.erase(model);
+}
+
+InstanceSetHandle VKRenderer::addInstancesToWireframeModel(std::string modelID, std::string instanceVectorID, std::span<const InstanceData> instances) {
+    return addInstancesToWireframeModel(requireWireframeModelHandle(modelID, "set instances for it"), instanceVectorID, instances);
 }
 
-void VKRenderer::addInstancesToWireframeModel(std::string modelID, std::string instanceVectorID, std::vector<InstanceData>& instances) {
-    if(idToWFInstancedModels.count(modelID) == 0) {
-        throw std::runtime_error(modelID + " hasn't been set yet, so you can't set instances for it.");
+InstanceSetHandle VKRenderer::addInstancesToWireframeModel(std::string modelID, std::string instanceVectorID, std::vector<InstanceData>&& instances) {
+    return addInstancesToWireframeModel(requireWireframeModelHandle(modelID, "set instances for it"), instanceVectorID, std::move(instances));
+}
+
+InstanceSetHandle VKRenderer::addInstancesToWireframeModel(WireframeModelHandle model, std::string instanceVectorID, std::span<const InstanceData> instances) {
+    invalidateCommandBuffers();
+
+    InstanceSetHandle set = wireframeModels.at(model).model.addInstancesToModel(vkEngine->getDevice(), instanceVectorID, instances, getDeletionQueue());
+
+    refreshWireframeIndirectDraws(model);
+
+    return set;
+}
+
+InstanceSetHandle VKRenderer::addInstancesToWireframeModel(WireframeModelHandle model, std::string instanceVectorID, std::vector<InstanceData>&& instances) {
+    invalidateCommandBuffers();
+
+    InstanceSetHandle set = wireframeModels.at(model).model.addInstancesToModel(vkEngine->getDevice(), instanceVectorID, std::move(instances), getDeletionQueue());
+
+    refreshWireframeIndirectDraws(model);
+
+    return set;
+}
+
+void VKRenderer::addInstancesToWireframeModel(WireframeModelHandle model, InstanceSetHandle set, std::span<const InstanceData> instances) {
+    invalidateCommandBuffers();
+
+    wireframeModels.at(model).model.addInstancesToModel(vkEngine->getDevice(), set, instances, getDeletionQueue());
+
+    refreshWireframeIndirectDraws(model);
+}
+
+void VKRenderer::updateWireframeInstanceRange(std::string modelID, std::string instanceVectorID, uint32_t offset, std::span<const InstanceData> instances) {
+    WireframeModelHandle model = requireWireframeModelHandle(modelID, "update instances for it");
+
+    updateWireframeInstanceRange(model, getWireframeInstanceSetHandle(model, instanceVectorID), offset, instances);
+}
+
+void VKRenderer::updateWireframeInstanceRange(WireframeModelHandle model, InstanceSetHandle set, uint32_t offset, std::span<const InstanceData> instances) {
+    wireframeModels.at(model).model.updateInstanceRange(vkEngine->getDevice(), set, offset, instances);
+
+    //the chunk bounds may have grown, and the visible ranges baked into the secondaries come from culling them
+    if(cpuCulling) {
+        invalidateCommandBuffers();
     }
+}
 
-    idToWFInstancedModels.at(modelID).addInstancesToModel(vkEngine->getDevice(), instanceVectorID, instances);
+void VKRenderer::updateWireframeModelRange(std::string modelID, uint32_t offset, std::span<const WireframeVertex> modelVertices) {
+    updateWireframeModelRange(requireWireframeModelHandle(modelID, "update its vertices"), offset, modelVertices);
 }
 
-void VKRenderer::removeInstancesFromWireframeModel(std::string modelID, std::string instanceVectorID) {
-    if(idToWFInstancedModels.count(modelID) == 0) {
-        throw std::runtime_error(modelID + " hasn't been set yet, so you can't remove instances for it.");
+void VKRenderer::updateWireframeModelRange(WireframeModelHandle model, uint32_t offset, std::span<const WireframeVertex> modelVertices) {
+    wireframeModels.at(model).model.updateModelRange(vkEngine->getDevice(), offset, modelVertices);
+
+    //the box may have grown, the culling shader reads it from the draw bounds
+    refreshWireframeIndirectDraws(model);
+
+    if(cpuCulling) {
+        invalidateCommandBuffers();
     }
+}
 
-    canObjectBeDestroyedMap[mapCounter] = std::make_pair(getCopyOfFFVWithExtraFrame(), new bool(false));
-    idToWFInstancedModels.at(modelID).removeInstancesFromModel(vkEngine->getDevice(), instanceVectorID, canObjectBeDestroyedMap[mapCounter].second);
-    ++mapCounter;
+void VKRenderer::setWireframeModelDrawParameters(std::string modelID, DrawPushConstants parameters) {
+    setWireframeModelDrawParameters(requireWireframeModelHandle(modelID, "set its draw parameters"), parameters);
 }
 
-void VKRenderer::removeFrameFromDeleteRequirements(size_t frame) {
-    for(auto& pair : canObjectBeDestroyedMap) {
-        if(pair.second.first.size() > 0) {
-            auto it = std::find(pair.second.first.begin(), pair.second.first.end(), frame);
-            if(it != pair.second.first.end()) {
-                pair.second.first.erase(it);
-            } 
+void VKRenderer::setWireframeModelDrawParameters(WireframeModelHandle model, DrawPushConstants parameters) {
+    WireframeModelData& modelData = wireframeModels.at(model);
+
+    if(modelData.drawParameters == parameters) {
+        return;
+    }
+
+    //the values are recorded into the secondaries
+    invalidateCommandBuffers();
+
+    modelData.drawParameters = parameters;
+}
+
+void VKRenderer::removeInstancesFromWireframeModel(std::string modelID, std::string instanceVectorID) {
+    WireframeModelHandle model = requireWireframeModelHandle(modelID, "remove instances for it");
+
+    removeInstancesFromWireframeModel(model, getWireframeInstanceSetHandle(model, instanceVectorID));
+}
+
+void VKRenderer::removeInstancesFromWireframeModel(WireframeModelHandle model, InstanceSetHandle set) {
+    invalidateCommandBuffers();
+
+    InstancedRenderingModel<WireframeVertex>& wireframeModel = wireframeModels.at(model).model;
+
+    wireframeDrawList.removeDraw(vkEngine->getDevice(), VulkanIndirectDrawList::makeKey(model.value, set.value));
+
+    wireframeModel.removeInstancesFromModel(vkEngine->getDevice(), set, getDeletionQueue());
+}
+
+VulkanDeletionQueue* VKRenderer::getDeletionQueue() {
+    return vkEngine->getDevice()->getDeletionQueue().get();
+}
+
+void VKRenderer::defragmentStep() {
+    if(!defragmentationEnabled) {
+        return;
+    }
+
+    std::shared_ptr<VulkanDevice> device = vkEngine->getDevice();
+    std::shared_ptr<VulkanMemoryAllocator> allocator = device->getMemoryAllocator();
+
+    if(!allocator->isDefragmenting()) {
+        ++framesSinceDefragmentationCheck;
+
+        if(framesSinceDefragmentationCheck < defragmentationCheckInterval) {
+            return;
+        }
+
+        framesSinceDefragmentationCheck = 0;
+
+        if(allocator->beginDefragmentation(defragmentationMaxOccupancy) == 0) {
+            return;
+        }
+
+        framesSinceLastRelocation = 0;
+    }
+
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::microseconds((long long) (defragmentationBudgetMilliseconds * 1000.0));
+
+    bool outOfTime = false;
+    bool relocatedAny = false;
+
+    //the budget is checked after every move, so every step moves at least one buffer
+    auto relocate = [&](auto& buffer) {
+        if(outOfTime || !buffer.shouldRelocate(device)) {
+            return;
         }
+
+        buffer.relocate(device, getDeletionQueue());
+        relocatedAny = true;
+
+        outOfTime = std::chrono::steady_clock::now() >= deadline;
+    };
+
+    auto relocateModel = [&](auto& model) {
+        relocate(model.getModel());
+
+        for(InstanceSetData& instanceData : model.getInstanceSets()) {
+            relocate(instanceData.data);
+        }
+    };
+
+    for(ModelData& modelData : models.getValues()) {
+        relocateModel(modelData.opaque);
+        relocateModel(modelData.transparent);
+    }
+
+    for(WireframeModelData& modelData : wireframeModels.getValues()) {
+        relocateModel(modelData.model);
+    }
+
+    for(std::pair<const std::string, VulkanVertexBuffer<OverlayVertex>>& vertexData : dataIDToVertexOverlayData) {
+        relocate(vertexData.second);
+    }
+
+    relocate(compositeBuffer);
+
+    if(geometryPooling) {
+        relocate(vertexPool->getVertexBuffer());
+        relocate(wireframeVertexPool->getVertexBuffer());
+        relocate(transparentVertexPool->getVertexBuffer());
+        relocate(instancePool->getVertexBuffer());
+    }
+
+    for(VulkanIndirectDrawList* drawList : {&opaqueDrawList, &wireframeDrawList, &transparentDrawList}) {
+        relocate(drawList->getCommandVertexBuffer());
+        relocate(drawList->getCountVertexBuffer());
+        relocate(drawList->getBoundsVertexBuffer());
+    }
+
+    if(relocatedAny) {
+        invalidateCommandBuffers();
+        framesSinceLastRelocation = 0;
+    }else {
+        ++framesSinceLastRelocation;
+    }
+
+    /*
+    the old copies are freed once the frames that used them are done, and that is when the evacuated pages get released. anything still left in them
+    after that belongs to something that can't be moved from here (the uniform and staging rings), so those pages go back to normal
+    */
+    if(framesSinceLastRelocation > (uint32_t) vkEngine->getSyncObjects()->getMaxFramesInFlight() + 2) {
+        allocator->endDefragmentation();
     }
 }
 
-std::vector<int> VKRenderer::getCopyOfFFVWithExtraFrame() {
-    std::vector<int> cpy = fullFrameVector;
-    cpy.push_back(currentFrame);
-    return cpy;
+void VKRenderer::invalidateCommandBuffers() {
+    ++sceneGeneration;
 }
 
-bool VKRenderer::hasWireframeModel(std::string id) {
-    if(idToWFInstancedModels.count(id) == 0) {
-        return false;
+uint64_t VKRenderer::getSceneGeneration() {
+    return sceneGeneration;
+}
+
+void VKRenderer::setDefragmentation(bool enabled, double budgetMilliseconds) {
+    defragmentationEnabled = enabled;
+    defragmentationBudgetMilliseconds = budgetMilliseconds;
+
+    if(!defragmentationEnabled) {
+        vkEngine->getDevice()->getMemoryAllocator()->endDefragmentation();
+    }
+}
+
+void VKRenderer::setFramesInFlight(int framesInFlight) {
+    std::shared_ptr<VulkanDevice> device = vkEngine->getDevice();
+
+    vkDeviceWaitIdle(device->getInternalLogicalDevice());
+
+    //the per frame values are about to be lost, but with the device idle every submission so far is done
+    uint64_t lastSubmission = device->getDeletionQueue()->getRecordingValue() - 1;
+    device->getDeletionQueue()->complete(lastSubmission);
+    device->getStagingRing()->releaseSubmissions(lastSubmission);
+
+    vkEngine->getSyncObjects()->setMaxFramesInFlight(device, framesInFlight);
+
+    currentFrame = 0;
+}
+
+int VKRenderer::getFramesInFlight() {
+    return vkEngine->getSyncObjects()->getMaxFramesInFlight();
+}
+
+void VKRenderer::setGpuProfiling(bool enabled, bool perModel) {
+    perModel = enabled && perModel;
+
+    if(enabled == gpuProfiling && perModel == modelGpuProfiling) {
+        return;
     }
 
-    return true;
+    if(enabled && !vkEngine->getDevice()->supportsTimestamps()) {
+        throw std::runtime_error("gpu profiling needs timestamp queries, which the graphics queue of this device doesn't support!");
+    }
+
+    gpuProfiling = enabled;
+    modelGpuProfiling = perModel;
+
+    //the pool is sized for the draw queries, prepareRecording creates it again with the right size
+    vkDeviceWaitIdle(vkEngine->getDevice()->getInternalLogicalDevice());
+    gpuProfiler->destroyGpuProfiler(vkEngine->getDevice());
+
+    invalidateCommandBuffers();
+}
+
+bool VKRenderer::hasWireframeModel(std::string id) {
+    return wireframeModelHandles.count(id) > 0;
+}
+
+bool VKRenderer::hasWireframeModel(WireframeModelHandle model) {
+    return wireframeModels.contains(model);
 }
 
 bool VKRenderer::hasInstanceInWireframeModel(std::string modelID, std::string instanceVectorID) {
-    return idToWFInstancedModels.at(modelID).hasInstanceSet(instanceVectorID);
+    return wireframeModels.at(requireWireframeModelHandle(modelID, "look up its instances")).model.hasInstanceSet(instanceVectorID);
 }
 
-void VKRenderer::setModel(std::string modelID, std::vector<Vertex> modelVerticesOpaque, std::vector<TransparentVertex> modelVerticesTransparent) {
-    if(idToTransparentInstancedModels.count(modelID) > 0) {
-        idToTransparentInstancedModels.at(modelID).setModel(vkEngine->getDevice(), modelVerticesTransparent);
-    }else {
-        idToTransparentInstancedModels.insert(std::make_pair(modelID, InstancedRenderingModel<TransparentVertex>(vkEngine->getDevice(), modelVerticesTransparent)));
+bool VKRenderer::hasInstanceInWireframeModel(WireframeModelHandle model, InstanceSetHandle set) {
+    return wireframeModels.at(model).model.hasInstanceSet(set);
+}
+
+ModelHandle VKRenderer::setModel(std::string modelID, std::vector<Vertex> modelVerticesOpaque, std::vector<TransparentVertex> modelVerticesTransparent) {
+    ModelHandle model = getModelHandle(modelID);
+
+    if(!model.isNull()) {
+        setModel(model, std::move(modelVerticesOpaque), std::move(modelVerticesTransparent));
+        return model;
     }
 
-    if(idToInstancedModels.count(modelID) > 0) {
-        idToInstancedModels.at(modelID).setModel(vkEngine->getDevice(), modelVerticesOpaque);
+    invalidateCommandBuffers();
+
+    if(geometryPooling) {
+        model = models.insert(ModelData{modelID, InstancedRenderingModel<Vertex>(vkEngine->getDevice(), std::span<const Vertex>(modelVerticesOpaque), vertexPool, instancePool, getDeletionQueue()), InstancedRenderingModel<TransparentVertex>(vkEngine->getDevice(), std::span<const TransparentVertex>(modelVerticesTransparent), transparentVertexPool, instancePool, getDeletionQueue())});
     }else {
-        idToInstancedModels.insert(std::make_pair(modelID, InstancedRenderingModel<Vertex>(vkEngine->getDevice(), modelVerticesOpaque)));
+        model = models.insert(ModelData{modelID, InstancedRenderingModel<Vertex>(vkEngine->getDevice(), std::move(modelVerticesOpaque), modelPlacement, instancePlacement, keepCPUCopies, modelID), InstancedRenderingModel<TransparentVertex>(vkEngine->getDevice(), std::move(modelVerticesTransparent), modelPlacement, instancePlacement, keepCPUCopies, modelID)});
     }
+
+    modelHandles[modelID] = model;
+
+    return model;
 }
 
-void VKRenderer::removeModel(std::string modelID) {
-    if(idToInstancedModels.count(modelID) > 0) {
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(getCopyOfFFVWithExtraFrame(), new bool(false));
+void VKRenderer::setModel(ModelHandle model, std::vector<Vertex> modelVerticesOpaque, std::vector<TransparentVertex> modelVerticesTransparent) {
+    invalidateCommandBuffers();
 
-        idToInstancedModels.at(modelID).destroy(vkEngine->getDevice(), canObjectBeDestroyedMap[mapCounter].second);
-        ++mapCounter;
-        
-        idToInstancedModels.erase(modelID);
+    ModelData& modelData = models.at(model);
+
+    modelData.transparent.setModel(vkEngine->getDevice(), std::move(modelVerticesTransparent), getDeletionQueue());
+    modelData.opaque.setModel(vkEngine->getDevice(), std::move(modelVerticesOpaque), getDeletionQueue());
+
+    refreshIndirectDraws(model);
+}
+
+ModelHandle VKRenderer::getModelHandle(std::string modelID) {
+    std::unordered_map<std::string, ModelHandle>::iterator model = modelHandles.find(modelID);
+
+    return (model != modelHandles.end()) ? model->second : ModelHandle();
+}
+
+InstanceSetHandle VKRenderer::getInstanceSetHandle(ModelHandle model, std::string instanceVectorID) {
+    //both halves have the same sets under the same handles
+    return models.at(model).opaque.getInstanceSetHandle(instanceVectorID);
+}
+
+ModelHandle VKRenderer::requireModelHandle(const std::string& modelID, const std::string& action) {
+    ModelHandle model = getModelHandle(modelID);
+
+    if(model.isNull()) {
+        throw std::runtime_error(modelID + " hasn't been set yet, so you can't " + action + ".");
     }
 
-    if(idToTransparentInstancedModels.count(modelID) > 0) {
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(getCopyOfFFVWithExtraFrame(), new bool(false));
+    return model;
+}
 
-        idToTransparentInstancedModels.at(modelID).destroy(vkEngine->getDevice(), canObjectBeDestroyedMap[mapCounter].second);
-        ++mapCounter;
-        
-        idToTransparentInstancedModels.erase(modelID);
+InstanceSetHandle VKRenderer::getOrCreateInstanceSet(ModelData& modelData, const std::string& instanceVectorID) {
+    InstanceSetHandle set = modelData.opaque.createInstanceSet(instanceVectorID);
+
+    //the halves see the same creates and removes in the same order, so this only fails if that stopped being true
+    if(modelData.transparent.createInstanceSet(instanceVectorID) != set) {
+        throw std::runtime_error("the opaque and transparent half of " + modelData.id + " don't agree on the handle of " + instanceVectorID + "!");
     }
+
+    return set;
 }
 
-void VKRenderer::addInstancesToModel(std::string modelID, std::string instanceVectorID, std::vector<InstanceData>& instances) {
-    if(idToInstancedModels.count(modelID) == 0 && idToTransparentInstancedModels.count(modelID) == 0) {
-        throw std::runtime_error(modelID + " hasn't been set yet, so you can't set instances for it.");
+void VKRenderer::removeModel(std::string modelID) {
+    removeModel(getModelHandle(modelID));
+}
+
+void VKRenderer::removeModel(ModelHandle model) {
+    invalidateCommandBuffers();
+
+    ModelData* modelData = models.find(model);
+
+    if(modelData == nullptr) {
+        return;
     }
 
-    if(idToInstancedModels.count(modelID) > 0) {
-        idToInstancedModels.at(modelID).addInstancesToModel(vkEngine->getDevice(), instanceVectorID, instances);
+    removeIndirectDraws(vkEngine->getDevice(), opaqueDrawList, model.value, modelData->opaque);
+    removeIndirectDraws(vkEngine->getDevice(), transparentDrawList, model.value, modelData->transparent);
+
+    modelData->opaque.destroy(vkEngine->getDevice(), getDeletionQueue());
+
+    modelData->transparent.destroy(vkEngine->getDevice(), getDeletionQueue());
+
+    modelHandles.erase(modelData->id);
+    models.erase(model);
+}
+
+InstanceSetHandle VKRenderer::addInstancesToModel(std::string modelID, std::string instanceVectorID, std::span<const InstanceData> instances) {
+    return addInstancesToModel(requireModelHandle(modelID, "set instances for it"), instanceVectorID, instances);
+}
+
+InstanceSetHandle VKRenderer::addInstancesToModel(std::string modelID, std::string instanceVectorID, std::vector<InstanceData>&& instances) {
+    return addInstancesToModel(requireModelHandle(modelID, "set instances for it"), instanceVectorID, std::move(instances));
+}
+
+InstanceSetHandle VKRenderer::addInstancesToModel(ModelHandle model, std::string instanceVectorID, std::span<const InstanceData> instances) {
+    InstanceSetHandle set = getOrCreateInstanceSet(models.at(model), instanceVectorID);
+
+    addInstancesToModel(model, set, instances);
+
+    return set;
+}
+
+InstanceSetHandle VKRenderer::addInstancesToModel(ModelHandle model, std::string instanceVectorID, std::vector<InstanceData>&& instances) {
+    InstanceSetHandle set = getOrCreateInstanceSet(models.at(model), instanceVectorID);
+
+    addInstancesToModel(model, set, std::move(instances));
+
+    return set;
+}
+
+void VKRenderer::addInstancesToModel(ModelHandle model, InstanceSetHandle set, std::span<const InstanceData> instances) {
+    invalidateCommandBuffers();
+
+    ModelData& modelData = models.at(model);
+
+    modelData.opaque.addInstancesToModel(vkEngine->getDevice(), set, instances, getDeletionQueue());
+    modelData.transparent.addInstancesToModel(vkEngine->getDevice(), set, instances, getDeletionQueue());
+
+    refreshIndirectDraws(model);
+}
+
+void VKRenderer::addInstancesToModel(ModelHandle model, InstanceSetHandle set, std::vector<InstanceData>&& instances) {
+    invalidateCommandBuffers();
+
+    ModelData& modelData = models.at(model);
+
+    //only one half can take the vector, the other one gets a copy
+    modelData.transparent.addInstancesToModel(vkEngine->getDevice(), set, std::span<const InstanceData>(instances), getDeletionQueue());
+    modelData.opaque.addInstancesToModel(vkEngine->getDevice(), set, std::move(instances), getDeletionQueue());
+
+    refreshIndirectDraws(model);
+}
+
+std::span<InstanceData> VKRenderer::beginInstanceWrite(std::string modelID, std::string instanceVectorID, uint32_t count) {
+    ModelHandle model = requireModelHandle(modelID, "set instances for it");
+
+    return beginInstanceWrite(model, getOrCreateInstanceSet(models.at(model), instanceVectorID), count);
+}
+
+std::span<InstanceData> VKRenderer::beginInstanceWrite(ModelHandle model, InstanceSetHandle set, uint32_t count) {
+    invalidateCommandBuffers();
+
+    ModelData& modelData = models.at(model);
+
+    //write into whichever half actually has geometry, the other one gets a copy in finishInstanceWrite
+    instanceWriteToTransparent = modelData.opaque.getModelVertexCount() == 0;
+
+    if(instanceWriteToTransparent) {
+        instanceWriteSpan = modelData.transparent.beginInstanceWrite(vkEngine->getDevice(), set, count, getDeletionQueue());
+    }else {
+        instanceWriteSpan = modelData.opaque.beginInstanceWrite(vkEngine->getDevice(), set, count, getDeletionQueue());
     }
 
-    if(idToTransparentInstancedModels.count(modelID) > 0) {
-        idToTransparentInstancedModels.at(modelID).addInstancesToModel(vkEngine->getDevice(), instanceVectorID, instances);
+    return instanceWriteSpan;
+}
+
+void VKRenderer::finishInstanceWrite(std::string modelID, std::string instanceVectorID) {
+    ModelHandle model = requireModelHandle(modelID, "set instances for it");
+
+    finishInstanceWrite(model, getInstanceSetHandle(model, instanceVectorID));
+}
+
+void VKRenderer::finishInstanceWrite(ModelHandle model, InstanceSetHandle set) {
+    ModelData& modelData = models.at(model);
+
+    if(instanceWriteToTransparent) {
+        modelData.transparent.finishInstanceWrite(vkEngine->getDevice(), set);
+    }else {
+        modelData.opaque.finishInstanceWrite(vkEngine->getDevice(), set);
     }
+
+    //the written span can point into the staging ring, which the next upload may move, so copy it out first
+    std::vector<InstanceData> instances = std::vector<InstanceData>(instanceWriteSpan.begin(), instanceWriteSpan.end());
+
+    if(instanceWriteToTransparent) {
+        modelData.opaque.addInstancesToModel(vkEngine->getDevice(), set, std::move(instances), getDeletionQueue());
+    }else {
+        modelData.transparent.addInstancesToModel(vkEngine->getDevice(), set, std::move(instances), getDeletionQueue());
+    }
+
+    instanceWriteSpan = std::span<InstanceData>();
+
+    refreshIndirectDraws(model);
 }
 
-void VKRenderer::removeInstancesFromModel(std::string modelID, std::string instanceVectorID) {
-    if(idToInstancedModels.count(modelID) == 0 && idToTransparentInstancedModels.count(modelID) == 0) {
-        throw std::runtime_error(modelID + " hasn't been set yet, so you can't remove instances for it.");
+void VKRenderer::updateInstanceRange(std::string modelID, std::string instanceVectorID, uint32_t offset, std::span<const InstanceData> instances) {
+    ModelHandle model = requireModelHandle(modelID, "update instances for it");
+
+    updateInstanceRange(model, getInstanceSetHandle(model, instanceVectorID), offset, instances);
+}
+
+void VKRenderer::updateInstanceRange(ModelHandle model, InstanceSetHandle set, uint32_t offset, std::span<const InstanceData> instances) {
+    ModelData& modelData = models.at(model);
+
+    modelData.opaque.updateInstanceRange(vkEngine->getDevice(), set, offset, instances);
+    modelData.transparent.updateInstanceRange(vkEngine->getDevice(), set, offset, instances);
+
+    //the chunk bounds may have grown, and the visible ranges baked into the secondaries come from culling them
+    if(cpuCulling) {
+        invalidateCommandBuffers();
     }
+}
 
-    if(idToTransparentInstancedModels.count(modelID) == 0) {
-        if(!idToInstancedModels.at(modelID).hasInstanceSet(instanceVectorID)) {
-            throw std::runtime_error(instanceVectorID + " hasn't been set yet for model " + modelID + " so you can't remove it");
-        }
+void VKRenderer::updateModelRange(std::string modelID, uint32_t offset, std::span<const Vertex> modelVerticesOpaque) {
+    updateModelRange(requireModelHandle(modelID, "update its vertices"), offset, modelVerticesOpaque);
+}
+
+void VKRenderer::updateModelRange(ModelHandle model, uint32_t offset, std::span<const Vertex> modelVerticesOpaque) {
+    models.at(model).opaque.updateModelRange(vkEngine->getDevice(), offset, modelVerticesOpaque);
+
+    //the box may have grown, the culling shader reads it from the draw bounds
+    refreshIndirectDraws(model);
+
+    if(cpuCulling) {
+        invalidateCommandBuffers();
     }
+}
 
-    if(idToInstancedModels.count(modelID) == 0) {
-        if(!idToTransparentInstancedModels.at(modelID).hasInstanceSet(instanceVectorID)) {
-            throw std::runtime_error(instanceVectorID + " hasn't been set yet for model " + modelID + " so you can't remove it");
-        }
+void VKRenderer::updateModelRange(std::string modelID, uint32_t offset, std::span<const TransparentVertex> modelVerticesTransparent) {
+    updateModelRange(requireModelHandle(modelID, "update its vertices"), offset, modelVerticesTransparent);
+}
+
+void VKRenderer::updateModelRange(ModelHandle model, uint32_t offset, std::span<const TransparentVertex> modelVerticesTransparent) {
+    models.at(model).transparent.updateModelRange(vkEngine->getDevice(), offset, modelVerticesTransparent);
+
+    refreshIndirectDraws(model);
+
+    if(cpuCulling) {
+        invalidateCommandBuffers();
     }
+}
 
-    if(idToInstancedModels.count(modelID) > 0 && idToTransparentInstancedModels.count(modelID) > 0) {
-        if(!idToTransparentInstancedModels.at(modelID).hasInstanceSet(instanceVectorID) && !idToInstancedModels.at(modelID).hasInstanceSet(instanceVectorID)) {
-            throw std::runtime_error(instanceVectorID + " hasn't been set yet for model " + modelID + " so you can't remove it");
-        }
+void VKRenderer::setModelDrawParameters(std::string modelID, DrawPushConstants parameters) {
+    setModelDrawParameters(requireModelHandle(modelID, "set its draw parameters"), parameters);
+}
+
+void VKRenderer::setModelDrawParameters(ModelHandle model, DrawPushConstants parameters) {
+    ModelData& modelData = models.at(model);
+
+    if(modelData.drawParameters == parameters) {
+        return;
     }
 
-    if(idToInstancedModels.count(modelID) > 0) {
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(getCopyOfFFVWithExtraFrame(), new bool(false));
+    //the values are recorded into the secondaries
+    invalidateCommandBuffers();
+
+    modelData.drawParameters = parameters;
+}
 
-        idToInstancedModels.at(modelID).removeInstancesFromModel(vkEngine->getDevice(), instanceVectorID, canObjectBeDestroyedMap[mapCounter].second);
-        ++mapCounter;
+void VKRenderer::removeInstancesFromModel(std::string modelID, std::string instanceVectorID) {
+    ModelHandle model = requireModelHandle(modelID, "remove instances for it");
+    InstanceSetHandle set = getInstanceSetHandle(model, instanceVectorID);
+
+    if(set.isNull()) {
+        throw std::runtime_error(instanceVectorID + " hasn't been set yet for model " + modelID + " so you can't remove it");
     }
 
-    if(idToTransparentInstancedModels.count(modelID) > 0) {
-        canObjectBeDestroyedMap[mapCounter] = std::make_pair(getCopyOfFFVWithExtraFrame(), new bool(false));
+    removeInstancesFromModel(model, set);
+}
+
+void VKRenderer::removeInstancesFromModel(ModelHandle model, InstanceSetHandle set) {
+    invalidateCommandBuffers();
+
+    ModelData& modelData = models.at(model);
 
-        idToTransparentInstancedModels.at(modelID).removeInstancesFromModel(vkEngine->getDevice(), instanceVectorID, canObjectBeDestroyedMap[mapCounter].second);
-        ++mapCounter;
+    if(!modelData.opaque.hasInstanceSet(set)) {
+        throw std::runtime_error("the instance set handle doesn't refer to a set of " + modelData.id + ", so you can't remove it");
     }
+
+    opaqueDrawList.removeDraw(vkEngine->getDevice(), VulkanIndirectDrawList::makeKey(model.value, set.value));
+    transparentDrawList.removeDraw(vkEngine->getDevice(), VulkanIndirectDrawList::makeKey(model.value, set.value));
+
+    modelData.opaque.removeInstancesFromModel(vkEngine->getDevice(), set, getDeletionQueue());
+
+    modelData.transparent.removeInstancesFromModel(vkEngine->getDevice(), set, getDeletionQueue());
 }
 
 void VKRenderer::removeInstancesFromModelSafe(std::string modelID, std::string instanceVectorID) {
@@ -1501,15 +2406,19 @@ void VKRenderer::removeInstancesFromModelSafe(std::string modelID, std::string i
 }
 
 bool VKRenderer::hasModel(std::string id) {
-    if(idToInstancedModels.count(id) == 0 && idToTransparentInstancedModels.count(id) == 0) {
-        return false;
-    }
+    return modelHandles.count(id) > 0;
+}
 
-    return true;
+bool VKRenderer::hasModel(ModelHandle model) {
+    return models.contains(model);
 }
 
 bool VKRenderer::hasInstanceInModel(std::string modelID, std::string instanceVectorID) {
-    return idToInstancedModels.at(modelID).hasInstanceSet(instanceVectorID) || idToTransparentInstancedModels.at(modelID).hasInstanceSet(instanceVectorID);
+    return models.at(requireModelHandle(modelID, "look up its instances")).opaque.hasInstanceSet(instanceVectorID);
+}
+
+bool VKRenderer::hasInstanceInModel(ModelHandle model, InstanceSetHandle set) {
+    return models.at(model).opaque.hasInstanceSet(set);
 }
 
 void VKRenderer::setScreenTint(glm::vec3 tint) {
@@ -1530,4 +2439,172 @@ glm::vec4 VKRenderer::getClearColor() {
 
 glm::vec3 VKRenderer::getScreenTint() {
     return screenTint;
+}
+
+void VKRenderer::setGeometryPlacement(BUFFER_PLACEMENT _modelPlacement, BUFFER_PLACEMENT _instancePlacement) {
+    modelPlacement = _modelPlacement;
+    instancePlacement = _instancePlacement;
+
+    for(ModelData& modelData : models.getValues()) {
+        modelData.opaque.setInstancePlacement(instancePlacement);
+        modelData.transparent.setInstancePlacement(instancePlacement);
+    }
+
+    for(WireframeModelData& modelData : wireframeModels.getValues()) {
+        modelData.model.setInstancePlacement(instancePlacement);
+    }
+}
+
+void VKRenderer::setGeometryPooling(bool enabled) {
+    if(!models.empty() || !wireframeModels.empty()) {
+        throw std::runtime_error("geometry pooling can only be changed before any models are set!");
+    }
+
+    if(enabled == geometryPooling) {
+        return;
+    }
+
+    if(!enabled && indirectDrawing) {
+        throw std::runtime_error("geometry pooling can't be turned off while indirect drawing is on!");
+    }
+
+    geometryPooling = enabled;
+
+    if(geometryPooling) {
+        vertexPool = std::make_shared<VulkanGeometryPool<Vertex>>(modelPlacement, VulkanMemoryTag(CATEGORY_MODEL, "pool/opaque"));
+        wireframeVertexPool = std::make_shared<VulkanGeometryPool<WireframeVertex>>(modelPlacement, VulkanMemoryTag(CATEGORY_MODEL, "pool/wireframe"));
+        transparentVertexPool = std::make_shared<VulkanGeometryPool<TransparentVertex>>(modelPlacement, VulkanMemoryTag(CATEGORY_MODEL, "pool/transparent"));
+        instancePool = std::make_shared<VulkanGeometryPool<InstanceData>>(instancePlacement, VulkanMemoryTag(CATEGORY_INSTANCE_SET, "pool/instances"));
+
+        //read by the culling pass
+        instancePool->getVertexBuffer().setExtraUsage(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    }else {
+        //nothing can be drawing from the pools, there are no models
+        vertexPool->destroy(vkEngine->getDevice(), nullptr);
+        wireframeVertexPool->destroy(vkEngine->getDevice(), nullptr);
+        transparentVertexPool->destroy(vkEngine->getDevice(), nullptr);
+        instancePool->destroy(vkEngine->getDevice(), nullptr);
+
+        vertexPool = nullptr;
+        wireframeVertexPool = nullptr;
+        transparentVertexPool = nullptr;
+        instancePool = nullptr;
+    }
+}
+
+void VKRenderer::setIndirectDrawing(bool enabled) {
+    if(enabled == indirectDrawing) {
+        return;
+    }
+
+    if(enabled && !geometryPooling) {
+        throw std::runtime_error("indirect drawing needs geometry pooling, every draw has to come from the same vertex buffers!");
+    }
+
+    if(enabled && !vkEngine->getDevice()->supportsDrawIndirectFirstInstance()) {
+        throw std::runtime_error("indirect drawing needs drawIndirectFirstInstance, which this device doesn't support!");
+    }
+
+    if(!enabled && gpuCulling) {
+        throw std::runtime_error("indirect drawing can't be turned off while gpu culling is on!");
+    }
+
+    if(enabled && cpuCulling) {
+        throw std::runtime_error("indirect drawing can't be turned on while cpu culling is on, use gpu culling instead!");
+    }
+
+    invalidateCommandBuffers();
+
+    indirectDrawing = enabled;
+
+    if(indirectDrawing) {
+        opaqueDrawList.setMemoryTag(VulkanMemoryTag(CATEGORY_OTHER, "indirect/opaque"));
+        wireframeDrawList.setMemoryTag(VulkanMemoryTag(CATEGORY_OTHER, "indirect/wireframe"));
+        transparentDrawList.setMemoryTag(VulkanMemoryTag(CATEGORY_OTHER, "indirect/transparent"));
+
+        for(size_t i = 0; i < models.size(); ++i) {
+            refreshIndirectDraws(models.getHandle(i));
+        }
+
+        for(size_t i = 0; i < wireframeModels.size(); ++i) {
+            refreshWireframeIndirectDraws(wireframeModels.getHandle(i));
+        }
+    }else {
+        opaqueDrawList.destroy(vkEngine->getDevice(), getDeletionQueue());
+        wireframeDrawList.destroy(vkEngine->getDevice(), getDeletionQueue());
+        transparentDrawList.destroy(vkEngine->getDevice(), getDeletionQueue());
+    }
+}
+
+void VKRenderer::setGpuCulling(bool enabled) {
+    if(enabled == gpuCulling) {
+        return;
+    }
+
+    if(enabled && !indirectDrawing) {
+        throw std::runtime_error("gpu culling works on the indirect draw commands, turn on indirect drawing first!");
+    }
+
+    invalidateCommandBuffers();
+
+    gpuCulling = enabled;
+
+    if(!gpuCulling) {
+        //the outputs are only dropped once nothing can be drawing from them
+        vkDeviceWaitIdle(vkEngine->getDevice()->getInternalLogicalDevice());
+        instanceCuller->destroyInstanceCuller(vkEngine->getDevice());
+    }
+}
+
+void VKRenderer::setCpuCulling(bool enabled) {
+    if(enabled == cpuCulling) {
+        return;
+    }
+
+    if(enabled && indirectDrawing) {
+        throw std::runtime_error("cpu culling can't be combined with indirect drawing, use gpu culling instead!");
+    }
+
+    invalidateCommandBuffers();
+
+    cpuCulling = enabled;
+
+    //forces a cull on the next recording even if the camera hasn't moved
+    culledViewProjection = glm::mat4x4(0.0f);
+}
+
+void VKRenderer::refreshIndirectDraws(ModelHandle model) {
+    if(!indirectDrawing) {
+        return;
+    }
+
+    ModelData& modelData = models.at(model);
+
+    updateIndirectDraws(vkEngine->getDevice(), opaqueDrawList, model.value, modelData.opaque, getDeletionQueue());
+    updateIndirectDraws(vkEngine->getDevice(), transparentDrawList, model.value, modelData.transparent, getDeletionQueue());
+}
+
+void VKRenderer::refreshWireframeIndirectDraws(WireframeModelHandle model) {
+    if(!indirectDrawing) {
+        return;
+    }
+
+    updateIndirectDraws(vkEngine->getDevice(), wireframeDrawList, model.value, wireframeModels.at(model).model, getDeletionQueue());
+}
+
+void VKRenderer::setKeepCPUCopies(bool keep) {
+    keepCPUCopies = keep;
+
+    for(ModelData& modelData : models.getValues()) {
+        modelData.opaque.setKeepCPUCopies(keepCPUCopies);
+        modelData.transparent.setKeepCPUCopies(keepCPUCopies);
+    }
+
+    for(WireframeModelData& modelData : wireframeModels.getValues()) {
+        modelData.model.setKeepCPUCopies(keepCPUCopies);
+    }
+
+    for(std::pair<const std::string, VulkanVertexBuffer<OverlayVertex>>& vertexData : dataIDToVertexOverlayData) {
+        vertexData.second.setKeepCPUCopy(keepCPUCopies);
+    }
 }
\ No newline at end of file
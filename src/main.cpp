@@ -8,6 +8,12 @@
 
 #include <chrono>
 
+#include <thread>
+
+#include <random>
+#include <map>
+#include <algorithm>
+
 #include "ModelLoader.h"
 
 static std::vector<Vertex> triangle = {
@@ -152,7 +158,202 @@ float testChangingOverlayY = 100;
 
 glm::vec4 testChangingClearColor = glm::vec4(0, 0, 0, 1);
 
-int main() {
+//times a full re-record of every command buffer for a scene of 10k models, first on one thread and then on all of them
+static void benchmarkRecording(VKRenderer& renderer) {
+  const int modelCount = 10000;
+  const int iterations = 50;
+
+  for(int i = 0; i < modelCount; ++i) {
+    std::string modelID = "benchmark-model" + std::to_string(i);
+
+    ModelHandle model = renderer.setModel(modelID, cube);
+    renderer.addInstancesToModel(model, "set1", std::vector<InstanceData>{InstanceData({{i % 100, 0, i / 100}})});
+  }
+
+  double singleThreadMilliseconds = 0;
+
+  for(uint32_t threads : {1u, 0u}) {
+    renderer.setRecordingThreads(threads);
+
+    //first recording allocates the secondary command buffers
+    renderer.recordCommandBuffers();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for(int i = 0; i < iterations; ++i) {
+      renderer.invalidateCommandBuffers();
+      renderer.recordCommandBuffers();
+    }
+
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+    if(threads == 1) {
+      singleThreadMilliseconds = milliseconds;
+    }
+
+    std::cout << renderer.getRecordingThreadCount() << " recording thread(s): " << milliseconds << " ms to record all command buffers, "
+              << singleThreadMilliseconds / milliseconds << "x" << std::endl;
+  }
+
+  //one frame so there is a submitted command buffer to report the binds of
+  renderer.renderFrame();
+
+  VulkanBindCounts bindCounts = renderer.getFrameBindCounts();
+
+  std::cout << bindCounts.draws << " draws: " << bindCounts.pipelineBinds << " pipeline binds, " << bindCounts.descriptorSetBinds << " descriptor set binds, "
+            << bindCounts.vertexBufferBinds << " vertex buffer binds, " << bindCounts.pushConstantUpdates << " push constant updates, " << bindCounts.skippedBinds << " redundant binds skipped" << std::endl;
+}
+
+static void printFrameStats(const VulkanFrameStats& stats) {
+  for(size_t phase = 0; phase < FRAME_PHASE_COUNT; ++phase) {
+    const VulkanPhaseStats& phaseStats = stats.phases[phase];
+
+    if(phaseStats.samples == 0) {
+      continue;
+    }
+
+    std::cout << "  " << VulkanFrameTimer::getPhaseName(static_cast<FRAME_PHASE>(phase)) << ": min " << phaseStats.min << " ms, avg " << phaseStats.average
+              << " ms, p99 " << phaseStats.p99 << " ms, max " << phaseStats.max << " ms" << std::endl;
+  }
+}
+
+/*
+renders the same scene with 1, 2 and 3 frames in flight while the cpu spends a fixed time on a stand-in for game logic every frame. renderFrame blocks on
+the gpu when the cpu gets too far ahead, so the less time it takes compared to the frame, the more the cpu and gpu overlapped. vsync caps the frame rate.
+each count also prints where renderFrame's time went, phase by phase, and where the gpu's went if the device has timestamps
+*/
+static void benchmarkFramesInFlight(VKRenderer& renderer) {
+  const int modelCount = 2000;
+  const int frames = 300;
+  const double cpuWorkMilliseconds = 4;
+
+  for(int i = 0; i < modelCount; ++i) {
+    std::string modelID = "benchmark-model" + std::to_string(i);
+
+    ModelHandle model = renderer.setModel(modelID, cube);
+    renderer.addInstancesToModel(model, "set1", std::vector<InstanceData>{InstanceData({{i % 50, 0, i / 50}})});
+  }
+
+  bool gpuProfiling = renderer.getEngine()->getDevice()->supportsTimestamps();
+
+  if(gpuProfiling) {
+    renderer.setGpuProfiling(true, true);
+  }
+
+  for(int framesInFlight : {1, 2, 3}) {
+    renderer.setFramesInFlight(framesInFlight);
+
+    //warm up, so recording the secondaries isn't part of the measurement
+    renderer.renderFrame();
+    renderer.getEngine()->getFrameTimer()->reset();
+
+    double renderFrameMilliseconds = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for(int i = 0; i < frames; ++i) {
+      std::chrono::steady_clock::time_point workStart = std::chrono::steady_clock::now();
+
+      while(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - workStart).count() < cpuWorkMilliseconds) {
+      }
+
+      std::chrono::steady_clock::time_point renderStart = std::chrono::steady_clock::now();
+
+      renderer.renderFrame();
+      glfwPollEvents();
+
+      renderFrameMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - renderStart).count();
+    }
+
+    double frameMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+    renderFrameMilliseconds /= frames;
+
+    std::cout << framesInFlight << " frame(s) in flight: " << frameMilliseconds << " ms per frame, " << renderFrameMilliseconds << " ms in renderFrame, "
+              << cpuWorkMilliseconds << " ms of cpu work" << std::endl;
+
+    printFrameStats(renderer.getFrameStats());
+
+    if(gpuProfiling) {
+      std::map<std::string, double> modelTimes = renderer.getModelGpuTimes();
+
+      std::map<std::string, double>::iterator slowest = std::max_element(modelTimes.begin(), modelTimes.end(), [](auto& a, auto& b) {
+        return a.second < b.second;
+      });
+
+      if(slowest != modelTimes.end()) {
+        std::cout << "  slowest model on the gpu: " << slowest->first << ", " << slowest->second << " ms" << std::endl;
+      }
+    }
+  }
+}
+
+//times VulkanChunkCuller on a million random chunk boxes around the camera, first on one thread and then split over all cores
+static void benchmarkCulling() {
+  const uint32_t chunkCount = 1000000;
+  const int iterations = 100;
+
+  std::mt19937 random = std::mt19937(1);
+  std::uniform_real_distribution<float> position = std::uniform_real_distribution<float>(-500, 500);
+  std::uniform_real_distribution<float> extent = std::uniform_real_distribution<float>(1, 16);
+
+  VulkanChunkBounds chunks;
+  chunks.chunkCount = chunkCount;
+
+  for(uint32_t i = 0; i < chunkCount; ++i) {
+    chunks.centerX.push_back(position(random));
+    chunks.centerY.push_back(position(random));
+    chunks.centerZ.push_back(position(random));
+    chunks.extentX.push_back(extent(random));
+    chunks.extentY.push_back(extent(random));
+    chunks.extentZ.push_back(extent(random));
+  }
+
+  glm::mat4x4 projection = VKRenderer::createProjectionMatrix(90.0f, 16.0f / 9.0f, 0.01f, 1000.0f);
+  VulkanFrustum frustum = VulkanChunkCuller::extractFrustum(projection * VKRenderer::createViewMatrix(glm::vec3(0, 4, 0), 0, 0));
+
+  std::vector<uint8_t> visible = std::vector<uint8_t>(chunkCount);
+
+  uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+  double singleThreadSeconds = 0;
+
+  for(uint32_t threadCount : {1u, hardwareThreads}) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for(int i = 0; i < iterations; ++i) {
+      std::vector<std::thread> threads = std::vector<std::thread>();
+      uint32_t chunksPerThread = (chunkCount + threadCount - 1) / threadCount;
+
+      for(uint32_t t = 1; t < threadCount; ++t) {
+        threads.push_back(std::thread([&, t]() {
+          VulkanChunkCuller::cullChunks(frustum, chunks, glm::vec3(-0.5f), glm::vec3(0.5f), t * chunksPerThread, std::min(chunkCount, (t + 1) * chunksPerThread), visible.data());
+        }));
+      }
+
+      VulkanChunkCuller::cullChunks(frustum, chunks, glm::vec3(-0.5f), glm::vec3(0.5f), 0, std::min(chunkCount, chunksPerThread), visible.data());
+
+      for(std::thread& thread : threads) {
+        thread.join();
+      }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+    if(threadCount == 1) {
+      singleThreadSeconds = seconds;
+    }
+
+    uint32_t visibleCount = 0;
+
+    for(uint8_t chunk : visible) {
+      visibleCount += chunk;
+    }
+
+    std::cout << VulkanChunkCuller::getInstructionSet() << ", " << threadCount << " thread(s): " << chunkCount / seconds / 1000000.0 << " million chunks/sec, "
+              << visibleCount << " of " << chunkCount << " visible, " << singleThreadSeconds / seconds << "x" << std::endl;
+  }
+}
+
+int main(int argc, char** argv) {
   //define variables
   double previousMouseX = -1; //-1 means it hasn't been set yet
   double previousMouseY = -1; //-1 means it hasn't been set yet
@@ -178,9 +379,37 @@ int main() {
   bool flag1 = false;
   bool flag2 = false;
 
+  //doesn't need a window or a device
+  if(argc > 1 && std::string(argv[1]) == "--benchmark-culling") {
+    benchmarkCulling();
+    return 0;
+  }
+
   //init renderer
   VKRenderer renderer = VKRenderer();
 
+  if(argc > 1 && std::string(argv[1]) == "--benchmark-recording") {
+    benchmarkRecording(renderer);
+    return 0;
+  }
+
+  if(argc > 1 && std::string(argv[1]) == "--benchmark-frames-in-flight") {
+    benchmarkFramesInFlight(renderer);
+    return 0;
+  }
+
+  //the cube grids are mostly off screen, so only the visible instances get drawn
+  if(argc > 1 && std::string(argv[1]) == "--gpu-culling") {
+    renderer.setGeometryPooling(true);
+    renderer.setIndirectDrawing(true);
+    renderer.setGpuCulling(true);
+  }
+
+  //the same without indirect draws, culled on the cpu
+  if(argc > 1 && std::string(argv[1]) == "--cpu-culling") {
+    renderer.setCpuCulling(true);
+  }
+
   //setup input callbacks
   std::function<void(GLFWwindow*, double, double)> mouseCallback = [&](GLFWwindow* window, double mouseX, double mouseY) {
     if(previousMouseX != -1) {
@@ -517,8 +746,6 @@ int main() {
       glfwSetWindowShouldClose(renderer.getEngine()->getDisplay()->getInternalWindow(), true);
     }
 
-    renderer.recordCommandBuffers();
-
     renderer.renderFrame(); 
 
     glfwPollEvents();